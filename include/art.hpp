@@ -1,14 +1,26 @@
 #ifndef ART_HPP
 #define ART_HPP
 
+#include "art/allocator.hpp"
 #include "art/art.hpp"
 #include "art/childIt.hpp"
+#include "art/concurrentArt.hpp"
+#include "art/durableArt.hpp"
+#include "art/epoch.hpp"
+#include "art/frozenArt.hpp"
 #include "art/innerNode.hpp"
+#include "art/keyFile.hpp"
+#include "art/keyTraits.hpp"
+#include "art/keyedArt.hpp"
 #include "art/leafNode.hpp"
 #include "art/node.hpp"
 #include "art/node16.hpp"
 #include "art/node256.hpp"
 #include "art/node4.hpp"
 #include "art/node48.hpp"
+#include "art/persistentArt.hpp"
+#include "art/shardedArt.hpp"
+#include "art/threadPool.hpp"
+#include "art/treeIt.hpp"
 
 #endif // ART_HPP
@@ -0,0 +1,293 @@
+#ifndef ART_ALLOCATOR_HPP
+#define ART_ALLOCATOR_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace art {
+
+/**
+ * Size-class slab allocator used for the nodes of a tree.
+ *
+ * Requests up to maxSlotSize bytes are rounded up to a multiple of
+ * slotAlign and served from a pool dedicated to that size class. Each node
+ * type therefore gets its own pool, carved out of large slabs. Freed slots
+ * are kept on a per-class free list and handed out again on the next request
+ * of the same class, e.g. the Node4 released by a grow() is reused by the
+ * next Node4.
+ *
+ * Bigger requests (leaves with long keys) are served individually but still
+ * tracked, so that release() frees everything at once without walking the
+ * tree.
+ */
+class SlabAllocator {
+public:
+  SlabAllocator() = default;
+  SlabAllocator(const SlabAllocator &other) = delete;
+  SlabAllocator &operator=(const SlabAllocator &other) = delete;
+  ~SlabAllocator();
+
+  /**
+   * Allocates a block of at least size bytes aligned on slotAlign.
+   */
+  void *allocate(std::size_t size);
+
+  /**
+   * Returns a block obtained through allocate() with the same size.
+   */
+  void deallocate(void *p, std::size_t size);
+
+  /**
+   * Frees all slabs and large blocks at once. Every block handed out so
+   * far becomes invalid.
+   */
+  void release();
+
+  /**
+   * Takes over all slabs and large blocks of the other allocator, which is
+   * left empty. Blocks obtained from the other allocator are returned to
+   * this one from then on. Used to combine the allocators of subtrees built
+   * in parallel.
+   */
+  void merge(SlabAllocator &other);
+
+  static constexpr std::size_t slotAlign = 16;
+  static constexpr std::size_t maxSlotSize = 4096;
+  static constexpr std::size_t slabSize = 64 * 1024;
+
+private:
+  struct freeSlot {
+    freeSlot *next;
+  };
+
+  struct pool {
+    freeSlot *freeList = nullptr;
+    char *cur = nullptr;
+    char *end = nullptr;
+  };
+
+  /* header in front of every slab and every large block */
+  struct alignas(slotAlign) chunk {
+    chunk *prev;
+    chunk *next;
+  };
+
+  static constexpr std::size_t nPools = maxSlotSize / slotAlign;
+
+  void *newChunk(chunk *&list, std::size_t size);
+
+  pool pools_[nPools];
+  chunk *slabs_ = nullptr;
+  chunk *large_ = nullptr;
+};
+
+/**
+ * Slab allocator that can be shared by threads.
+ *
+ * Threads are spread over nStripes SlabAllocators, each guarded by its own
+ * mutex, so that threads rarely contend for the same one. A slot may be
+ * returned through another stripe than the one it was obtained from, since
+ * all stripes are released together. Large blocks are linked to the
+ * allocator that handed them out and always go through the first stripe.
+ */
+class ConcurrentSlabAllocator {
+public:
+  ConcurrentSlabAllocator() = default;
+  ConcurrentSlabAllocator(const ConcurrentSlabAllocator &other) = delete;
+  ConcurrentSlabAllocator &
+  operator=(const ConcurrentSlabAllocator &other) = delete;
+
+  void *allocate(std::size_t size);
+  void deallocate(void *p, std::size_t size);
+  void release();
+
+  static constexpr std::size_t nStripes = 16;
+
+private:
+  struct alignas(64) stripe {
+    std::mutex mutex;
+    SlabAllocator allocator;
+  };
+
+  /* stripe serving the calling thread for blocks of the given size */
+  stripe &stripeFor(std::size_t size);
+
+  stripe stripes_[nStripes];
+};
+
+/**
+ * Allocates a node of type N from the given allocator and constructs it.
+ */
+template <class N, class Allocator, class... Args>
+N *allocNode(Allocator &alloc, Args &&...args);
+
+/**
+ * Determines if the allocator takes nodes back through retireNode(N *),
+ * which destructs and frees them once no reader can reach them any more,
+ * instead of having freeNode() destruct them right away. Such allocators
+ * set defersDestruction.
+ */
+template <class Allocator, class = void>
+struct defersNodeDestruction : std::false_type {};
+
+template <class Allocator>
+struct defersNodeDestruction<
+    Allocator, std::enable_if_t<Allocator::defersDestruction>>
+    : std::true_type {};
+
+/**
+ * Destructs a node of type N created through allocNode() and returns it to
+ * the allocator.
+ */
+template <class N, class Allocator> void freeNode(Allocator &alloc, N *n);
+
+inline SlabAllocator::~SlabAllocator() { release(); }
+
+inline void *SlabAllocator::allocate(std::size_t size) {
+  if (size > maxSlotSize)
+    return newChunk(large_, size);
+
+  pool &p = pools_[(size - 1) / slotAlign];
+  if (p.freeList != nullptr) {
+    freeSlot *slot = p.freeList;
+    p.freeList = slot->next;
+    return slot;
+  }
+
+  std::size_t slotSize = ((size - 1) / slotAlign + 1) * slotAlign;
+  if (p.cur == nullptr ||
+      p.end - p.cur < static_cast<std::ptrdiff_t>(slotSize)) {
+    p.cur = static_cast<char *>(newChunk(slabs_, slabSize));
+    p.end = p.cur + slabSize;
+  }
+  void *slot = p.cur;
+  p.cur += slotSize;
+  return slot;
+}
+
+inline void SlabAllocator::deallocate(void *p, std::size_t size) {
+  if (p == nullptr)
+    return;
+
+  if (size > maxSlotSize) {
+    chunk *c = static_cast<chunk *>(p) - 1;
+    if (c->prev != nullptr)
+      c->prev->next = c->next;
+    else
+      large_ = c->next;
+    if (c->next != nullptr)
+      c->next->prev = c->prev;
+    ::operator delete(c);
+    return;
+  }
+
+  pool &pl = pools_[(size - 1) / slotAlign];
+  auto slot = static_cast<freeSlot *>(p);
+  slot->next = pl.freeList;
+  pl.freeList = slot;
+}
+
+inline void SlabAllocator::release() {
+  for (chunk *list : {slabs_, large_}) {
+    while (list != nullptr) {
+      chunk *next = list->next;
+      ::operator delete(list);
+      list = next;
+    }
+  }
+  slabs_ = large_ = nullptr;
+  for (pool &p : pools_)
+    p = pool();
+}
+
+inline void SlabAllocator::merge(SlabAllocator &other) {
+  for (auto lists : {std::make_pair(&slabs_, &other.slabs_),
+                     std::make_pair(&large_, &other.large_)}) {
+    chunk *&list = *lists.first, *&otherList = *lists.second;
+    if (otherList == nullptr)
+      continue;
+    chunk *tail = otherList;
+    while (tail->next != nullptr)
+      tail = tail->next;
+    tail->next = list;
+    if (list != nullptr)
+      list->prev = tail;
+    list = std::exchange(otherList, nullptr);
+  }
+
+  for (std::size_t i = 0; i < nPools; ++i) {
+    pool &p = pools_[i], &o = other.pools_[i];
+    if (o.freeList != nullptr) {
+      freeSlot *tail = o.freeList;
+      while (tail->next != nullptr)
+        tail = tail->next;
+      tail->next = p.freeList;
+      p.freeList = o.freeList;
+    }
+    /* keep the bigger of the two partially used slabs */
+    if (o.end - o.cur > p.end - p.cur) {
+      p.cur = o.cur;
+      p.end = o.end;
+    }
+    o = pool();
+  }
+}
+
+inline void *SlabAllocator::newChunk(chunk *&list, std::size_t size) {
+  auto c = static_cast<chunk *>(::operator new(sizeof(chunk) + size));
+  c->prev = nullptr;
+  c->next = list;
+  if (list != nullptr)
+    list->prev = c;
+  list = c;
+  return c + 1;
+}
+
+inline void *ConcurrentSlabAllocator::allocate(std::size_t size) {
+  stripe &s = stripeFor(size);
+  std::lock_guard<std::mutex> lock(s.mutex);
+  return s.allocator.allocate(size);
+}
+
+inline void ConcurrentSlabAllocator::deallocate(void *p, std::size_t size) {
+  stripe &s = stripeFor(size);
+  std::lock_guard<std::mutex> lock(s.mutex);
+  s.allocator.deallocate(p, size);
+}
+
+inline void ConcurrentSlabAllocator::release() {
+  for (stripe &s : stripes_) {
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.allocator.release();
+  }
+}
+
+inline ConcurrentSlabAllocator::stripe &
+ConcurrentSlabAllocator::stripeFor(std::size_t size) {
+  static std::atomic<std::size_t> nThreads{0};
+  thread_local std::size_t index = nThreads++ % nStripes;
+  return stripes_[size > SlabAllocator::maxSlotSize ? 0 : index];
+}
+
+template <class N, class Allocator, class... Args>
+N *allocNode(Allocator &alloc, Args &&...args) {
+  return new (alloc.allocate(sizeof(N))) N(std::forward<Args>(args)...);
+}
+
+template <class N, class Allocator> void freeNode(Allocator &alloc, N *n) {
+  if constexpr (defersNodeDestruction<Allocator>::value) {
+    alloc.retireNode(n);
+  } else {
+    n->~N();
+    alloc.deallocate(n, sizeof(N));
+  }
+}
+
+} // namespace art
+
+#endif // !ART_ALLOCATOR_HPP
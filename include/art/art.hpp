@@ -1,43 +1,182 @@
-#ifndef ART_HPP
-#define ART_HPP
+#ifndef ART_ART_HPP
+#define ART_ART_HPP
 
+#include "allocator.hpp"
 #include "childIt.hpp"
+#include "frozenArt.hpp"
 #include "innerNode.hpp"
 #include "leafNode.hpp"
 #include "node.hpp"
+#include "node16.hpp"
+#include "node256.hpp"
 #include "node4.hpp"
+#include "node48.hpp"
+#include "threadPool.hpp"
 #include "treeIt.hpp"
 #include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
 #include <cstring>
+#include <deque>
+#include <fcntl.h>
 #include <iostream>
+#include <memory>
 #include <numeric>
+#include <queue>
 #include <stack>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
 #include <vector>
 
 namespace art {
 
-template <typename T> class Art {
+template <typename T> class PersistentArt;
+
+/**
+ * Memory use and shape of a tree, see Art::stats().
+ *
+ * Bytes are those requested from the tree's allocator, without its own
+ * overhead. Values embedded in child slots take no allocation of their own.
+ */
+struct ArtStats {
+  struct nodeType {
+    /* number of nodes, bytes they take and children they hold */
+    std::size_t count = 0, bytes = 0, children = 0;
+    /* children a node of the type holds at most */
+    std::size_t capacity = 0;
+
+    /**
+     * Share of the child slots in use, not counting the leaf slots.
+     */
+    double fillFactor() const {
+      return count != 0 ? double(children) / (count * capacity) : 0;
+    }
+  };
+
+  /* inner nodes, indexed by NodeType */
+  nodeType inner[4] = {{0, 0, 0, 4}, {0, 0, 0, 16}, {0, 0, 0, 48},
+                       {0, 0, 0, 256}};
+  /* leaf records and the bytes they take along with their keys */
+  std::size_t leaves = 0, leafBytes = 0;
+  /* values embedded in child slots */
+  std::size_t embedded = 0;
+
+  /* sum of the inner nodes' prefix lengths, and the number of inner nodes
+   * by prefix length; prefixes longer than Node<T>::maxPrefixLen are
+   * compressed optimistically */
+  std::size_t prefixBytes = 0;
+  std::vector<std::size_t> prefixLengths;
+
+  /* number of keys by the number of inner nodes above them */
+  std::vector<std::size_t> leafDepths;
+
+  std::size_t keys() const { return leaves + embedded; }
+
+  std::size_t innerNodes() const {
+    std::size_t n = 0;
+    for (const auto &type : inner)
+      n += type.count;
+    return n;
+  }
+
+  /**
+   * Allocations held by the tree: its inner nodes and leaf records.
+   */
+  std::size_t allocations() const { return innerNodes() + leaves; }
+
+  std::size_t bytes() const {
+    std::size_t n = leafBytes;
+    for (const auto &type : inner)
+      n += type.bytes;
+    return n;
+  }
+
+  double bytesPerKey() const {
+    return keys() != 0 ? double(bytes()) / keys() : 0;
+  }
+};
+
+/**
+ * Adaptive radix tree mapping byte string keys to values of type T.
+ *
+ * Keys are binary safe and passed along with their length, they may contain
+ * null bytes and a key may be a prefix of another one. The overloads taking
+ * a null-terminated string use the bytes up to, but not including, the
+ * terminator as the key.
+ *
+ * Nodes are obtained from an Allocator, which must provide
+ * allocate(size), deallocate(pointer, size) and release(). The default
+ * SlabAllocator keeps one slab pool per node type and recycles freed slots.
+ *
+ * snapshot() freezes the current version of the tree in O(1). Nodes and
+ * leaves are stamped with the generation they were created in; those
+ * created before the newest live snapshot are shared with it and copied on
+ * their first modification, along with the path leading to them, whereas
+ * newer ones are modified in place.
+ *
+ * A tree constructed with countKeys keeps the number of keys below every
+ * inner node up to date, which rank(), select(), count() and size() rely
+ * on. Each set() of a new key and each del() then performs an additional
+ * lookup and updates the nodes on the key's path. A subtree holds at most
+ * 2^32 - 1 keys.
+ */
+template <typename T, class Allocator = SlabAllocator> class Art {
+  struct snapshotState;
+  template <typename> friend class PersistentArt;
+
 public:
+  Art() = default;
+  explicit Art(bool countKeys);
+  Art(const Art &other) = delete;
+  Art &operator=(const Art &other) = delete;
   ~Art();
 
   /**
    * Finds the value associated with the given key.
    *
    * @param key - The key to find.
+   * @param keyLen - The length of the key in bytes.
    * @return the value associated with the key or a default constructed value.
    */
+  T get(const uint8_t *key, std::size_t keyLen) const;
+  T get(std::string_view key) const;
   T get(const char *key) const;
 
+  /**
+   * Finds the values associated with n keys at once.
+   *
+   * The lookups advance in groups of Batch, one level at a time in
+   * round-robin, and prefetch the next node of each lookup. The memory
+   * accesses of a group overlap instead of stalling one after the other.
+   *
+   * @param keys - The keys to find.
+   * @param n - The number of keys.
+   * @param out - Receives the value associated with each key or a default
+   * constructed value.
+   */
+  template <std::size_t Batch = 16>
+  void multiGet(const std::string_view *keys, std::size_t n, T *out) const;
+
   /**
    * Associates the given key with the given value.
    * If another value is already associated with the given key,
    * since the method consumer is the resource owner.
    *
    * @param key - The key to associate with the value.
+   * @param keyLen - The length of the key in bytes.
    * @param value - The value to be associated with the key.
    * @return a nullptr if no other value is associated with they or the
    * previously associated value.
    */
+  T set(const uint8_t *key, std::size_t keyLen, T value);
+  T set(std::string_view key, T value);
   T set(const char *key, T value);
 
   /**
@@ -47,10 +186,139 @@ public:
    * If no value is associated with the given key, nullptr is returned.
    *
    * @param key - The key to delete.
+   * @param keyLen - The length of the key in bytes.
    * @return the values assciated with they key or a nullptr otherwise.
    */
+  T del(const uint8_t *key, std::size_t keyLen);
+  T del(std::string_view key);
   T del(const char *key);
 
+  /**
+   * Fills an empty tree from a range of key/value pairs sorted in ascending
+   * order of their keys, without duplicates. Elements provide the key as
+   * `first`, convertible to std::string_view, and the value as `second`.
+   *
+   * The tree is built top-down in a single pass over the keys: every inner
+   * node is created with its final type and compressed prefix, unlike a
+   * series of set() calls that split prefixes and grow nodes one key at a
+   * time.
+   *
+   * @param first - Iterator on the smallest key.
+   * @param last - Iterator after the biggest key.
+   */
+  template <class RandomIt> void bulkLoad(RandomIt first, RandomIt last);
+
+  /**
+   * Fills an empty tree from a range of key/value pairs in any order,
+   * without duplicate keys, using the given pool.
+   *
+   * The elements are grouped by the first byte of their keys, and the
+   * subtree of every group is sorted and built like in bulkLoad() by a task
+   * of its own, into an allocator of its own. The subtrees are then put
+   * under a common root and their allocators merged into the tree's, which
+   * must provide merge(Allocator &).
+   *
+   * @param first - Iterator on the first element.
+   * @param last - Iterator after the last element.
+   * @param pool - The pool the groups are built on.
+   */
+  template <class RandomIt>
+  void parallelBulkLoad(RandomIt first, RandomIt last, ThreadPool &pool);
+
+  /**
+   * Removes all keys and frees all nodes. No snapshot of the tree may be
+   * alive.
+   *
+   * Nodes are freed along with the allocator's slabs, the tree is only
+   * walked if the values have to be destructed, which the overload taking a
+   * pool does for the subtrees of the root's children in parallel.
+   */
+  void clear();
+  void clear(ThreadPool &pool);
+
+  /**
+   * Calls fn(std::string_view key, const T &value) for the keys in [lo, hi)
+   * in lexicographic order until it returns false.
+   *
+   * The tree is walked depth-first and subtrees are skipped or entered by
+   * comparing their prefixes and partial keys with the bounds, which are
+   * only compared against while the path matches them. The key view
+   * refers to the leaf or to the walk's key buffer and is only valid
+   * during the call.
+   *
+   * @param lo - The smallest key of the range.
+   * @param hi - The key after the range.
+   * @param fn - The function called for every key.
+   * @return false if fn returned false.
+   */
+  template <class Fn>
+  bool scan(std::string_view lo, std::string_view hi, Fn fn) const;
+
+  /**
+   * Calls fn(std::string_view key, const T &value) for the keys starting
+   * with the given prefix in lexicographic order until it returns false,
+   * see scan().
+   *
+   * @return false if fn returned false.
+   */
+  template <class Fn> bool scanPrefix(std::string_view prefix, Fn fn) const;
+
+  /**
+   * Calls fn(std::string_view key, T value) for every key in [lo, hi), or
+   * in the whole tree, using the given pool. The tree must not be modified
+   * during the scan.
+   *
+   * The range is cut at child boundaries of the inner nodes into pieces of
+   * about the same estimated number of keys, several per thread, which are
+   * scanned by tasks of their own so that idle threads steal the remaining
+   * pieces.
+   *
+   * In the unordered mode, fn is called from the pool's threads as the
+   * pieces are scanned and must be safe to call concurrently. In the
+   * ordered mode, the pieces are buffered and fn is called from the calling
+   * thread in lexicographic order of the keys; only a window of pieces
+   * ahead of the one fn is called for is scanned at a time.
+   *
+   * @param lo - The smallest key of the range.
+   * @param hi - The key after the range.
+   * @param fn - The function called for every key.
+   * @param pool - The pool the pieces are scanned on.
+   * @param ordered - Whether fn is called in key order.
+   */
+  template <class Fn>
+  void parallelScan(std::string_view lo, std::string_view hi, Fn fn,
+                    ThreadPool &pool, bool ordered = false) const;
+  template <class Fn>
+  void parallelScan(Fn fn, ThreadPool &pool, bool ordered = false) const;
+
+  /**
+   * Number of keys less than the given key. The tree must count its keys.
+   *
+   * @param key - The key to rank.
+   * @param keyLen - The length of the key in bytes.
+   * @return the position the key has or would have in lexicographic order.
+   */
+  std::size_t rank(const uint8_t *key, std::size_t keyLen) const;
+  std::size_t rank(std::string_view key) const;
+  std::size_t rank(const char *key) const;
+
+  /**
+   * Iterator on the key at the given position in lexicographic order,
+   * starting at 0, or end() if there are not that many keys. The tree must
+   * count its keys.
+   */
+  treeIt<T> select(std::size_t k);
+
+  /**
+   * Number of keys in [lo, hi). The tree must count its keys.
+   */
+  std::size_t count(std::string_view lo, std::string_view hi) const;
+
+  /**
+   * Number of keys in the tree. The tree must count its keys.
+   */
+  std::size_t size() const;
+
   /**
    * Forward iterator that traverses the tree in lexicographic order.
    */
@@ -60,114 +328,956 @@ public:
    * Forward iterator that traverses the tree in lexicographic order starting
    * from the provided key.
    */
+  treeIt<T> begin(const uint8_t *key, std::size_t keyLen);
+  treeIt<T> begin(std::string_view key);
   treeIt<T> begin(const char *key);
 
+  /**
+   * Iterator on the greatest key, which traverses the tree in descending
+   * lexicographic order through operator--() until it reaches end().
+   */
+  treeIt<T> rbegin();
+
+  /**
+   * Iterator on the greatest key less than or equal to the provided key,
+   * see rbegin().
+   */
+  treeIt<T> rbegin(const uint8_t *key, std::size_t keyLen);
+  treeIt<T> rbegin(std::string_view key);
+  treeIt<T> rbegin(const char *key);
+
   /**
    * Iterator to the end of the lexicographic order.
    */
   treeIt<T> end();
 
+  /**
+   * Allocator the tree's nodes are obtained from.
+   */
+  const Allocator &getAllocator() const;
+
+  /**
+   * Walks the tree and reports its node counts and sizes by type, prefix
+   * lengths, fill factors and leaf depths. Nodes shared with snapshots are
+   * counted as part of the tree.
+   */
+  ArtStats stats() const;
+
+  /**
+   * Immutable point-in-time version of the tree, see snapshot().
+   *
+   * A snapshot may be read from another thread than the one modifying the
+   * tree, since the tree never modifies nodes shared with a live snapshot.
+   * Copies share the same version, which is reclaimed by the tree once the
+   * last copy is destroyed. Snapshots must not outlive the tree.
+   */
+  class Snapshot {
+  public:
+    Snapshot(const Snapshot &other);
+    Snapshot &operator=(const Snapshot &other);
+    ~Snapshot();
+
+    /**
+     * Finds the value the given key was associated with.
+     *
+     * @param key - The key to find.
+     * @param keyLen - The length of the key in bytes.
+     * @return the value associated with the key or a default constructed
+     * value.
+     */
+    T get(const uint8_t *key, std::size_t keyLen) const;
+    T get(std::string_view key) const;
+    T get(const char *key) const;
+
+    /**
+     * Forward iterator that traverses the snapshot in lexicographic order,
+     * optionally starting from the provided key. The values must not be
+     * modified through it.
+     */
+    treeIt<T> begin() const;
+    treeIt<T> begin(const uint8_t *key, std::size_t keyLen) const;
+    treeIt<T> begin(std::string_view key) const;
+
+    /**
+     * Iterator that traverses the snapshot in descending lexicographic
+     * order through operator--(), starting from the greatest key or from
+     * the greatest key less than or equal to the provided key.
+     */
+    treeIt<T> rbegin() const;
+    treeIt<T> rbegin(const uint8_t *key, std::size_t keyLen) const;
+    treeIt<T> rbegin(std::string_view key) const;
+
+    /**
+     * Iterator to the end of the lexicographic order.
+     */
+    treeIt<T> end() const;
+
+    /**
+     * Serializes the snapshot into a frozen image, see Art::freeze().
+     */
+    std::vector<char> freeze() const;
+
+  private:
+    friend class Art;
+    explicit Snapshot(snapshotState *state);
+    void release();
+
+    snapshotState *state_;
+  };
+
+  /**
+   * Freezes the current version of the tree in O(1). Subsequent calls to
+   * set() and del() copy the nodes they modify instead of changing the
+   * snapshot's nodes, which are reclaimed once no snapshot refers to them
+   * any more.
+   */
+  Snapshot snapshot();
+
+  /**
+   * Serializes the tree into a contiguous, pointer-free image served by
+   * FrozenArt. T must be trivially copyable.
+   */
+  std::vector<char> freeze() const;
+
+  /**
+   * Writes the frozen image of the tree to the file at the given path. The
+   * image is written to a temporary file next to it which then replaces
+   * the file, so that processes that mapped the previous image keep
+   * reading it. Both the image and the rename are synced to disk before
+   * it returns; it throws std::system_error if writing fails.
+   */
+  void freeze(const char *path) const;
+
 private:
+  struct snapshotState {
+    uint32_t generation;
+    Node<T> *root;
+    std::atomic<int> handles{1};
+    std::atomic<std::size_t> *released;
+  };
+
+  /* node or leaf removed from the tree which snapshots of the generations
+   * [from, to] may still refer to */
+  struct retiredNode {
+    Node<T> *node;
+    uint32_t from, to;
+  };
+
+  /**
+   * Finds the leaf associated with the given key in the tree with the given
+   * root.
+   *
+   * @return the leaf or a null pointer.
+   */
+  static Node<T> *findLeaf(Node<T> *root, const uint8_t *key, int keyLen);
+
+  /**
+   * Determines if the node or leaf record is shared with a live snapshot.
+   */
+  bool isFrozen(Node<T> *node) const;
+
+  /**
+   * Replaces the inner node in the given slot by a copy the tree owns
+   * exclusively if it is shared with a snapshot.
+   */
+  void unshare(Node<T> **slot);
+
+  /**
+   * Frees a node or leaf removed from the tree, or retires it until the
+   * snapshots it is shared with are gone.
+   */
+  void dropNode(Node<T> *node);
+
+  /**
+   * Forgets the snapshots whose last handle was destroyed and frees the
+   * retired nodes no live snapshot refers to.
+   */
+  void reclaimSnapshots();
+
+  /**
+   * Creates a leaf for the given key and value. The value is embedded in the
+   * child slot if requested and T allows it, which is only valid if the path
+   * to the slot spells the whole key without optimistic prefixes.
+   */
+  Node<T> *newLeaf(const uint8_t *key, int keyLen, T value, bool embed);
+  void destroyNode(Node<T> *node);
+
+  /**
+   * Creates an inner node of the smallest type that holds the given number
+   * of children.
+   */
+  innerNode<T> *newInnerNode(int nChildren);
+
+  /**
+   * Builds the subtree for the sorted elements [lo, hi) of a bulk load,
+   * whose keys have their first depth bytes in common with the path to the
+   * slot. lcp holds the length of the common prefix of each key and its
+   * predecessor.
+   */
+  template <class RandomIt>
+  Node<T> *build(RandomIt first, const std::vector<uint32_t> &lcp, int lo,
+                 int hi, int depth, bool pathInline);
+
+  /**
+   * Destructs the values held by the leaf records of the given subtree.
+   */
+  static void destroyValues(Node<T> *node);
+
+  /**
+   * Calls fn for the keys of the given subtree in [lo, hi), or from lo on
+   * if hi is a null pointer, for scan(). The path holds the key bytes
+   * leading to the node, loTight and hiTight whether they are those of lo
+   * and hi, the only case the bounds have to be compared in.
+   *
+   * @return false if fn returned false or the subtree reaches hi.
+   */
+  template <class Fn>
+  static bool scanNode(Node<T> *node, std::string &path, std::string_view lo,
+                       const std::string_view *hi, bool loTight,
+                       bool hiTight, Fn &fn);
+
+  /**
+   * Scans [lo, hi), or from lo on if hi is a null pointer, for
+   * parallelScan().
+   */
+  template <class Fn>
+  void scanPieces(std::string_view lo, const std::string_view *hi, Fn &fn,
+                  ThreadPool &pool, bool ordered) const;
+
+  /**
+   * Determines keys that cut (lo, hi) into about nPieces pieces of the same
+   * estimated number of keys, in ascending order.
+   */
+  std::vector<std::string> splitRange(std::string_view lo,
+                                      const std::string_view *hi,
+                                      std::size_t nPieces) const;
+
+  /**
+   * Estimates the number of keys below the given child of the given node
+   * from the estimate for the node, or counts them if the tree counts its
+   * keys.
+   */
+  double childWeight(const innerNode<T> *node, Node<T> *child,
+                     double weight) const;
+
+  /**
+   * Number of keys in the subtree rooted in the given node or leaf.
+   */
+  static std::size_t keyCount(Node<T> *node);
+
+  /**
+   * Adds the subtree rooted in the given node or leaf, found below depth
+   * inner nodes, to the stats.
+   */
+  static void collectStats(Node<T> *node, std::size_t depth,
+                           ArtStats &stats);
+
+  /**
+   * Throws std::logic_error unless the tree counts its keys.
+   */
+  void requireKeyCounts(const char *operation) const;
+
+  /**
+   * Replaces the node in the given slot, which has a single child or leaf
+   * left, with that child or leaf. The key holds the bytes leading to the
+   * node and through its prefix.
+   */
+  void collapse(Node<T> **slot, int depth, const uint8_t *key);
+
+  /**
+   * Moves the values embedded in the subtree rooted in the node in the given
+   * slot into leaf records. The path holds the key bytes leading to the
+   * node.
+   */
+  void materialize(Node<T> **slot, std::vector<uint8_t> &path);
+
+  /**
+   * Determines the number of matching bytes between the node's full prefix
+   * and the key starting at depth. Bytes of the prefix that are not stored
+   * inline are compared against the key of a leaf below the node.
+   */
+  static int checkPrefix(Node<T> *node, const uint8_t *key, int keyLen,
+                         int depth);
+
   Node<T> *root = nullptr;
+  Allocator allocator_;
+  bool countKeys_ = false;
+
+  /* generation of new nodes, the newest live snapshot's generation or 0 */
+  uint32_t generation_ = 1;
+  uint32_t frozenGeneration_ = 0;
+  std::vector<std::unique_ptr<snapshotState>> snapshots_;
+  std::vector<retiredNode> retired_;
+  /* snapshots released so far, by the tree and by their last handle */
+  std::size_t nReclaimed_ = 0;
+  std::atomic<std::size_t> nReleased_{0};
 };
 
-template <typename T> Art<T>::~Art<T>() {
-  if (root == nullptr)
-    return;
+template <typename T, class Allocator>
+Art<T, Allocator>::Art(bool countKeys) : countKeys_(countKeys) {}
+
+template <typename T, class Allocator> Art<T, Allocator>::~Art() {
+  clear();
+}
+
+template <typename T, class Allocator> void Art<T, Allocator>::clear() {
+  if (root != nullptr)
+    destroyValues(root);
+  for (const retiredNode &r : retired_)
+    destroyNode(r.node);
+  retired_.clear();
+  allocator_.release();
+  root = nullptr;
+}
 
-  std::stack<Node<T> *, std::vector<Node<T>>> nodeStack;
-  nodeStack.push(root);
+template <typename T, class Allocator>
+void Art<T, Allocator>::clear(ThreadPool &pool) {
+  if (root != nullptr && !isLeaf(root) &&
+      !std::is_trivially_destructible<T>::value) {
+    ThreadPool::taskGroup group(pool);
+    auto inner = static_cast<innerNode<T> *>(root);
+    for (auto it = inner->begin(), itEnd = inner->end(); it != itEnd; ++it) {
+      Node<T> *child = it.getChildNode();
+      group.run([child] { destroyValues(child); });
+    }
+    group.wait();
+    root = nullptr;
+  }
+  clear();
+}
+
+template <typename T, class Allocator>
+void Art<T, Allocator>::destroyValues(Node<T> *node) {
+  if (std::is_trivially_destructible<T>::value)
+    return;
+  std::stack<Node<T> *, std::vector<Node<T> *>> nodeStack;
+  nodeStack.push(node);
   Node<T> *currentNode;
   innerNode<T> *currInnerNode;
   childIt<T> it, itEnd;
   while (!nodeStack.empty()) {
     currentNode = nodeStack.top();
     nodeStack.pop();
-    if (!currentNode->isLeaf()) {
+    if (!isLeaf(currentNode)) {
       currInnerNode = static_cast<innerNode<T> *>(currentNode);
       for (it = currInnerNode->begin(), itEnd = currInnerNode->end();
            it != itEnd; ++it) {
-        nodeStack.push(*currInnerNode->findChild(*it));
+        nodeStack.push(it.getChildNode());
       }
+    } else if (!isEmbedded(currentNode)) {
+      asLeaf(currentNode)->~LeafNode<T>();
     }
-    if (currentNode->prefix_ != nullptr)
-      delete[] currentNode->prefix_;
   }
-  delete currentNode;
 }
 
-template <typename T> T Art<T>::get(const char *key) const {
+template <typename T, class Allocator>
+template <class Fn>
+bool Art<T, Allocator>::scan(std::string_view lo, std::string_view hi,
+                             Fn fn) const {
+  if (root == nullptr || !(lo < hi))
+    return true;
+  /* the walk also stops once it reaches hi */
+  bool stopped = false;
+  auto call = [&](std::string_view key, const T &value) {
+    stopped = !fn(key, value);
+    return !stopped;
+  };
+  std::string path;
+  scanNode(root, path, lo, &hi, !lo.empty(), true, call);
+  return !stopped;
+}
 
-  Node<T> *current = root;
-  Node<T> **child;
-  int depth = 0, keyLen = std::strlen(key) + 1;
-  while (current != nullptr) {
-    if (current->prefixLen_ != current->checkPrefix(key, keyLen))
-      // Prefix mismatch
-      return T{};
+template <typename T, class Allocator>
+template <class Fn>
+bool Art<T, Allocator>::scanPrefix(std::string_view prefix, Fn fn) const {
+  if (root == nullptr)
+    return true;
+  /* the keys starting with the prefix are those before its successor,
+   * which does not exist if it only consists of 0xff bytes */
+  std::string successor(prefix);
+  while (!successor.empty() && static_cast<uint8_t>(successor.back()) == 0xff)
+    successor.pop_back();
+  std::string_view hi;
+  if (!successor.empty()) {
+    ++successor.back();
+    hi = successor;
+  }
+  bool stopped = false;
+  auto call = [&](std::string_view key, const T &value) {
+    stopped = !fn(key, value);
+    return !stopped;
+  };
+  std::string path;
+  scanNode(root, path, prefix, successor.empty() ? nullptr : &hi,
+           !prefix.empty(), !successor.empty(), call);
+  return !stopped;
+}
 
-    if (current->prefixLen_ == keyLen - depth) {
-      // Exact Match
-      return current->isLeaf() ? static_cast<LeafNode<T> *>(current)->value
-                               : T{};
+template <typename T, class Allocator>
+template <class Fn>
+bool Art<T, Allocator>::scanNode(Node<T> *node, std::string &path,
+                                 std::string_view lo,
+                                 const std::string_view *hi, bool loTight,
+                                 bool hiTight, Fn &fn) {
+  if (isLeaf(node)) {
+    std::string_view key = path;
+    if (!isEmbedded(node)) {
+      LeafNode<T> *leaf = asLeaf(node);
+      key = std::string_view(reinterpret_cast<const char *>(leaf->key()),
+                             leaf->keyLen_);
+    }
+    if (loTight && key < lo)
+      return true;
+    if (hiTight && key >= *hi)
+      return false;
+    if (isEmbedded(node)) {
+      const T value = leafValue(node);
+      return fn(key, value);
     }
+    return fn(key, static_cast<const T &>(asLeaf(node)->value));
+  }
+
+  auto inner = static_cast<innerNode<T> *>(node);
+  std::size_t depth = path.size();
+  const uint8_t *prefix = inner->prefixLen_ <= Node<T>::maxPrefixLen
+                              ? inner->prefix_
+                              : inner->minLeaf()->key() + depth;
+  path.append(reinterpret_cast<const char *>(prefix), inner->prefixLen_);
+  std::size_t childDepth = path.size();
 
-    child = static_cast<innerNode<T> *>(current)->findChild(
-        key[depth + current->prefixLen_]);
-    depth += (current->prefixLen_ + 1);
-    current = child != nullptr ? *child : nullptr;
+  /* a tight bound is longer than the path leading to the node */
+  if (loTight) {
+    int cmp = path.compare(depth, std::string::npos,
+                           lo.substr(depth, childDepth - depth));
+    if (cmp < 0) {
+      path.resize(depth);
+      return true;
+    }
+    loTight = cmp == 0 && lo.size() > childDepth;
+  }
+  if (hiTight) {
+    int cmp = path.compare(depth, std::string::npos,
+                           hi->substr(depth, childDepth - depth));
+    if (cmp > 0 || (cmp == 0 && hi->size() <= childDepth)) {
+      path.resize(depth);
+      return false;
+    }
+    hiTight = cmp == 0;
+  }
+
+  /* the key ending at the node is smaller than a tight lo */
+  if (inner->leaf_ != nullptr && !loTight &&
+      !scanNode(inner->leaf_, path, lo, hi, false, hiTight, fn)) {
+    path.resize(depth);
+    return false;
+  }
+  uint8_t from = loTight ? static_cast<uint8_t>(lo[childDepth]) : 0;
+  bool more = inner->forEachChild(from, [&](uint8_t partialKey,
+                                            Node<T> *child) {
+    bool childLoTight =
+        loTight && partialKey == from && lo.size() > childDepth + 1;
+    bool childHiTight = false;
+    if (hiTight) {
+      auto bound = static_cast<uint8_t>((*hi)[childDepth]);
+      if (partialKey > bound ||
+          (partialKey == bound && hi->size() == childDepth + 1))
+        return false;
+      childHiTight = partialKey == bound;
+    }
+    path.push_back(static_cast<char>(partialKey));
+    bool childMore =
+        scanNode(child, path, lo, hi, childLoTight, childHiTight, fn);
+    path.resize(childDepth);
+    return childMore;
+  });
+  path.resize(depth);
+  return more;
+}
+
+template <typename T, class Allocator>
+template <class Fn>
+void Art<T, Allocator>::parallelScan(std::string_view lo, std::string_view hi,
+                                     Fn fn, ThreadPool &pool,
+                                     bool ordered) const {
+  if (lo < hi)
+    scanPieces(lo, &hi, fn, pool, ordered);
+}
+
+template <typename T, class Allocator>
+template <class Fn>
+void Art<T, Allocator>::parallelScan(Fn fn, ThreadPool &pool,
+                                     bool ordered) const {
+  scanPieces(std::string_view(), nullptr, fn, pool, ordered);
+}
+
+template <typename T, class Allocator>
+template <class Fn>
+void Art<T, Allocator>::scanPieces(std::string_view lo,
+                                   const std::string_view *hi, Fn &fn,
+                                   ThreadPool &pool, bool ordered) const {
+  if (root == nullptr)
+    return;
+
+  /* piece i is [bounds[i], bounds[i + 1]), the last one ends at hi */
+  std::size_t nWorkers = pool.nThreads() + 1;
+  std::vector<std::string> bounds = splitRange(lo, hi, 8 * nWorkers);
+  bounds.insert(bounds.begin(), std::string(lo));
+  std::size_t nPieces = bounds.size();
+  auto scan = [&](std::size_t i, auto &&emit) {
+    const std::string_view *pieceHi = hi;
+    std::string_view next;
+    if (i + 1 < nPieces) {
+      next = bounds[i + 1];
+      pieceHi = &next;
+    }
+    auto call = [&](std::string_view key, const T &value) {
+      emit(key, value);
+      return true;
+    };
+    std::string path;
+    scanNode(root, path, bounds[i], pieceHi, !bounds[i].empty(),
+             pieceHi != nullptr, call);
+  };
+
+  if (!ordered) {
+    ThreadPool::taskGroup group(pool);
+    for (std::size_t i = 0; i < nPieces; ++i)
+      group.run([&, i] { scan(i, fn); });
+    group.wait();
+    return;
+  }
+
+  /* the entries must outlive the task filling them */
+  struct buffered {
+    std::vector<std::pair<std::string, T>> entries;
+    ThreadPool::taskGroup group;
+    explicit buffered(ThreadPool &pool) : group(pool) {}
+  };
+  std::deque<std::unique_ptr<buffered>> window;
+  std::size_t next = 0;
+  auto spawn = [&] {
+    auto piece = std::make_unique<buffered>(pool);
+    piece->group.run([&scan, i = next, out = &piece->entries] {
+      scan(i, [out](std::string_view key, T value) {
+        out->emplace_back(key, std::move(value));
+      });
+    });
+    window.push_back(std::move(piece));
+    ++next;
+  };
+  while (next < nPieces && window.size() < 2 * nWorkers)
+    spawn();
+  while (!window.empty()) {
+    std::unique_ptr<buffered> piece = std::move(window.front());
+    window.pop_front();
+    if (next < nPieces)
+      spawn();
+    piece->group.wait();
+    for (auto &entry : piece->entries)
+      fn(std::string_view(entry.first), entry.second);
   }
-  return T{};
 }
 
-template <typename T> T Art<T>::set(const char *key, T value) {
-  int keyLen = std::strlen(key) + 1, depth = 0, prefixMatchLen;
+template <typename T, class Allocator>
+std::vector<std::string>
+Art<T, Allocator>::splitRange(std::string_view lo, const std::string_view *hi,
+                              std::size_t nPieces) const {
+  /* subtree reached through the key bytes of path, biggest first */
+  struct piece {
+    double weight;
+    const innerNode<T> *node;
+    std::string path;
+    bool operator<(const piece &other) const { return weight < other.weight; }
+  };
+  std::priority_queue<piece> pieces;
+  std::vector<std::string> starts;
+  if (root != nullptr && !isLeaf(root))
+    pieces.push({1.0, static_cast<innerNode<T> *>(root), std::string()});
+
+  /* the smallest key of a child is at least its path, so the paths of the
+   * children of the biggest piece split it further */
+  while (!pieces.empty() && pieces.size() + starts.size() < nPieces) {
+    piece p = pieces.top();
+    pieces.pop();
+    auto node = const_cast<innerNode<T> *>(p.node);
+    const uint8_t *prefix = node->prefixLen_ <= Node<T>::maxPrefixLen
+                                ? node->prefix_
+                                : node->minLeaf()->key() + p.path.size();
+    p.path.append(reinterpret_cast<const char *>(prefix), node->prefixLen_);
+    for (auto it = node->begin(), itEnd = node->end(); it != itEnd; ++it) {
+      if (it.isLeafSlot())
+        continue;
+      std::string path = p.path;
+      path.push_back(static_cast<char>(it.getPartialKey()));
+      /* skip children whose keys are all out of the range */
+      if ((hi != nullptr && path >= *hi) ||
+          (path < lo && lo.compare(0, path.size(), path) != 0))
+        continue;
+      Node<T> *child = it.getChildNode();
+      if (isLeaf(child)) {
+        starts.push_back(std::move(path));
+      } else {
+        pieces.push({childWeight(node, child, p.weight),
+                     static_cast<innerNode<T> *>(child), std::move(path)});
+      }
+    }
+  }
+  for (; !pieces.empty(); pieces.pop())
+    starts.push_back(pieces.top().path);
+
+  starts.erase(std::remove_if(starts.begin(), starts.end(),
+                              [&](const std::string &start) {
+                                return start <= lo ||
+                                       (hi != nullptr && start >= *hi);
+                              }),
+               starts.end());
+  std::sort(starts.begin(), starts.end());
+  return starts;
+}
+
+template <typename T, class Allocator>
+double Art<T, Allocator>::childWeight(const innerNode<T> *node,
+                                      Node<T> *child, double weight) const {
+  if (countKeys_)
+    return keyCount(child);
+  /* without key counts, the keys are assumed to be spread evenly */
+  return weight / std::max<int>(1, node->nChildren_);
+}
+
+template <typename T, class Allocator>
+std::size_t Art<T, Allocator>::keyCount(Node<T> *node) {
+  if (node == nullptr)
+    return 0;
+  return isLeaf(node) ? 1 : node->keyCount();
+}
+
+template <typename T, class Allocator>
+void Art<T, Allocator>::collectStats(Node<T> *node, std::size_t depth,
+                                     ArtStats &stats) {
+  if (isLeaf(node)) {
+    if (isEmbedded(node)) {
+      ++stats.embedded;
+    } else {
+      ++stats.leaves;
+      stats.leafBytes += asLeaf(node)->nodeSize();
+    }
+    if (stats.leafDepths.size() <= depth)
+      stats.leafDepths.resize(depth + 1);
+    ++stats.leafDepths[depth];
+    return;
+  }
+
+  auto inner = static_cast<innerNode<T> *>(node);
+  auto &type = stats.inner[static_cast<int>(inner->type_)];
+  ++type.count;
+  type.bytes += inner->nodeSize();
+  type.children += inner->nChildren();
+  stats.prefixBytes += inner->prefixLen_;
+  if (stats.prefixLengths.size() <= inner->prefixLen_)
+    stats.prefixLengths.resize(inner->prefixLen_ + 1);
+  ++stats.prefixLengths[inner->prefixLen_];
+
+  if (inner->leaf_ != nullptr)
+    collectStats(inner->leaf_, depth + 1, stats);
+  inner->forEachChild(0, [&](uint8_t, Node<T> *child) {
+    collectStats(child, depth + 1, stats);
+    return true;
+  });
+}
+
+template <typename T, class Allocator>
+void Art<T, Allocator>::requireKeyCounts(const char *operation) const {
+  if (!countKeys_) {
+    throw std::logic_error(std::string(operation) +
+                           " requires a tree counting its keys");
+  }
+}
+
+template <typename T, class Allocator>
+std::size_t Art<T, Allocator>::rank(const uint8_t *key,
+                                    std::size_t keyLen) const {
+  requireKeyCounts("rank");
+  std::size_t rank = 0, depth = 0;
+  Node<T> *node = root;
+  while (node != nullptr) {
+    if (isLeaf(node)) {
+      /* an embedded value's key is the path, which the key extends */
+      if (isEmbedded(node))
+        return rank + (depth < keyLen);
+      LeafNode<T> *leaf = asLeaf(node);
+      return rank + std::lexicographical_compare(
+                        leaf->key(), leaf->key() + leaf->keyLen_, key,
+                        key + keyLen);
+    }
+
+    auto inner = static_cast<innerNode<T> *>(node);
+    const uint8_t *prefix = inner->prefixLen_ <= Node<T>::maxPrefixLen
+                                ? inner->prefix_
+                                : inner->minLeaf()->key() + depth;
+    std::size_t matchLen = 0;
+    while (matchLen < inner->prefixLen_ && depth + matchLen < keyLen &&
+           key[depth + matchLen] == prefix[matchLen])
+      ++matchLen;
+    if (matchLen < inner->prefixLen_) {
+      /* the key is either less or greater than the whole subtree */
+      if (depth + matchLen < keyLen && key[depth + matchLen] > prefix[matchLen])
+        rank += inner->keyCount();
+      return rank;
+    }
+
+    /* the key ending at the node is the one in the leaf slot, the children
+     * with a smaller partial key hold smaller keys */
+    depth += inner->prefixLen_;
+    if (depth == keyLen)
+      return rank;
+    rank += inner->leaf_ != nullptr;
+    uint8_t partialKey = key[depth];
+    Node<T> *next = nullptr;
+    inner->forEachChild(0, [&](uint8_t childPartialKey, Node<T> *child) {
+      if (childPartialKey >= partialKey) {
+        next = childPartialKey == partialKey ? child : nullptr;
+        return false;
+      }
+      rank += keyCount(child);
+      return true;
+    });
+    node = next;
+    depth += 1;
+  }
+  return rank;
+}
+
+template <typename T, class Allocator>
+std::size_t Art<T, Allocator>::rank(std::string_view key) const {
+  return rank(reinterpret_cast<const uint8_t *>(key.data()), key.size());
+}
+
+template <typename T, class Allocator>
+std::size_t Art<T, Allocator>::rank(const char *key) const {
+  return rank(std::string_view(key));
+}
+
+template <typename T, class Allocator>
+treeIt<T> Art<T, Allocator>::select(std::size_t k) {
+  requireKeyCounts("select");
+  if (k >= keyCount(root))
+    return end();
+
+  /* the key of an embedded value is spelled by the path, there are no
+   * optimistic prefixes above it */
+  std::string path;
+  Node<T> *node = root;
+  while (!isLeaf(node)) {
+    auto inner = static_cast<innerNode<T> *>(node);
+    path.append(reinterpret_cast<const char *>(inner->prefix_),
+                std::min(inner->prefixLen_, Node<T>::maxPrefixLen));
+    if (inner->leaf_ != nullptr) {
+      if (k == 0) {
+        node = inner->leaf_;
+        break;
+      }
+      --k;
+    }
+    inner->forEachChild(0, [&](uint8_t partialKey, Node<T> *child) {
+      std::size_t n = keyCount(child);
+      if (k < n) {
+        path.push_back(static_cast<char>(partialKey));
+        node = child;
+        return false;
+      }
+      k -= n;
+      return true;
+    });
+  }
+
+  if (isEmbedded(node))
+    return begin(path);
+  return begin(asLeaf(node)->key(), asLeaf(node)->keyLen_);
+}
+
+template <typename T, class Allocator>
+std::size_t Art<T, Allocator>::count(std::string_view lo,
+                                     std::string_view hi) const {
+  requireKeyCounts("count");
+  return lo < hi ? rank(hi) - rank(lo) : 0;
+}
+
+template <typename T, class Allocator>
+std::size_t Art<T, Allocator>::size() const {
+  requireKeyCounts("size");
+  return keyCount(root);
+}
+
+template <typename T, class Allocator>
+T Art<T, Allocator>::get(const uint8_t *key, std::size_t keyLen) const {
+  Node<T> *leaf = findLeaf(root, key, keyLen);
+  return leaf != nullptr ? leafValue(leaf) : T{};
+}
+
+template <typename T, class Allocator>
+T Art<T, Allocator>::get(std::string_view key) const {
+  return get(reinterpret_cast<const uint8_t *>(key.data()), key.size());
+}
+
+template <typename T, class Allocator>
+T Art<T, Allocator>::get(const char *key) const {
+  return get(std::string_view(key));
+}
+
+template <typename T, class Allocator>
+template <std::size_t Batch>
+void Art<T, Allocator>::multiGet(const std::string_view *keys, std::size_t n,
+                                 T *out) const {
+  /* lookups in flight, finished ones are replaced by the last one */
+  struct lookup {
+    Node<T> *node;
+    int depth;
+    std::size_t index;
+  };
+  lookup group[Batch];
+
+  for (std::size_t base = 0; base < n; base += Batch) {
+    std::size_t nActive = std::min(Batch, n - base);
+    for (std::size_t i = 0; i < nActive; ++i)
+      group[i] = {root, 0, base + i};
+
+    while (nActive > 0) {
+      for (std::size_t i = 0; i < nActive;) {
+        lookup &l = group[i];
+        auto key = reinterpret_cast<const uint8_t *>(keys[l.index].data());
+        int keyLen = keys[l.index].size();
+
+        if (l.node != nullptr && !isLeaf(l.node)) {
+          /* advance by one level and fetch the next node while the other
+           * lookups of the group advance */
+          l.node = descend(l.node, key, keyLen, l.depth);
+          if (l.node != nullptr && !isEmbedded(l.node))
+            __builtin_prefetch(isLeaf(l.node)
+                                   ? static_cast<const void *>(asLeaf(l.node))
+                                   : l.node);
+          ++i;
+          continue;
+        }
+
+        out[l.index] =
+            l.node != nullptr && leafMatches(l.node, key, keyLen, l.depth)
+                ? leafValue(l.node)
+                : T{};
+        l = group[--nActive];
+      }
+    }
+  }
+}
+
+template <typename T, class Allocator>
+T Art<T, Allocator>::set(const uint8_t *key, std::size_t keyLen, T value) {
+  int depth = 0, prefixMatchLen;
+  reclaimSnapshots();
   if (root == nullptr) {
-    root = new LeafNode<T>(value);
-    root->prefix_ = new char[keyLen];
-    std::copy(key, keyLen + 1, root->prefix_);
-    root->prefixLen_ = keyLen;
+    root = newLeaf(key, keyLen, value, false);
     return T{};
   }
 
+  /* the nodes on the path to a new key count it */
+  bool counting = countKeys_ && findLeaf(root, key, keyLen) == nullptr;
+
   Node<T> **currentNode = &root;
   Node<T> **child;
-  innerNode<T> currentInner;
-  char childPartialKey;
-  bool isPrefixMatch;
+  innerNode<T> *currentInner;
+  uint8_t childPartialKey;
+  /* true as long as no prefix on the path was compressed optimistically */
+  bool pathInline = true;
 
   while (true) {
-    /* number of bytes of the current node's prefix that match the key */
-    prefixMatchLen = (**currentNode).checkPrefix(key + depth, keyLen - depth);
-    /* true if the current node's prefix matches with a part of the key */
-    isPrefixMatch = (std::min<int>((**currentNode).prefixLen_,
-                                   keyLen - depth)) == prefixMatchLen;
-
-    if (isPrefixMatch && (**currentNode).prefixLen_ == keyLen - depth) {
-      /* exact match:
-       * => "replace"
-       * => replace value of current node.
-       * => return old value to caller to handle.
-       *        _                             _
-       *        |                             |
-       *       (aa)                          (aa)
-       *    a /    \ b     +[aaaaa,v3]    a /    \ b
-       *     /      \      ==========>     /      \
-       * *(aa)->v1  ()->v2             *(aa)->v3  ()->v2
+    if (isLeaf(*currentNode)) {
+      if (leafMatches(*currentNode, key, keyLen, depth)) {
+        /* exact match:
+         * => "replace"
+         * => replace value of current node.
+         * => return old value to caller to handle.
+         *        _                             _
+         *        |                             |
+         *       (aa)                          (aa)
+         *    a /    \ b     +[aaaaa,v3]    a /    \ b
+         *     /      \      ==========>     /      \
+         * *(aa)->v1  ()->v2             *(aa)->v3  ()->v2
+         *
+         */
+        T oldValue = leafValue(*currentNode);
+        if constexpr (isEmbeddable<T>::value) {
+          if (isEmbedded(*currentNode)) {
+            *currentNode = embedValue(value);
+            return oldValue;
+          }
+        }
+        if (isFrozen(*currentNode)) {
+          /* the snapshot keeps the old leaf */
+          dropNode(*currentNode);
+          *currentNode = newLeaf(key, keyLen, value, false);
+          return oldValue;
+        }
+        asLeaf(*currentNode)->value = value;
+        return oldValue;
+      }
+
+      /* leaf holding another key:
+       * => new parent node with the part both keys have in common.
+       * => leaf and new leaf with value to insert become its children, a
+       *    key ending at the new parent goes to its leaf slot.
        *
+       *        |                        |
+       *    *[aab]->v1                +(a)->Ø
+       *                  +[ab,v2]  a /   \ b
+       *                  =======>   /     \
+       *                       [aab]->v1  +[ab]->v2
        */
+      /* an embedded value's key is spelled by the path, which the key to
+       * insert extends */
+      const uint8_t *leafKey = key;
+      int leafKeyLen = depth;
+      if (!isEmbedded(*currentNode)) {
+        leafKey = asLeaf(*currentNode)->key();
+        leafKeyLen = asLeaf(*currentNode)->keyLen_;
+      }
+      int matchLen = 0;
+      while (depth + matchLen < leafKeyLen &&
+             static_cast<std::size_t>(depth + matchLen) < keyLen &&
+             key[depth + matchLen] == leafKey[depth + matchLen])
+        ++matchLen;
 
-      // CurrentNode must be a leaf
-      auto currentLeaf = static_cast<LeafNode<T> *>(*currentNode);
-      T oldValue = currentLeaf->value;
-      currentLeaf->value = value;
-      return oldValue;
+      auto newParent = allocNode<Node4<T>>(allocator_);
+      newParent->setGeneration(generation_);
+      newParent->setKeyCount(2);
+      newParent->setPrefix(key + depth, matchLen);
+      int childDepth = depth + matchLen;
+      bool embed = pathInline && newParent->prefixLen_ <= Node<T>::maxPrefixLen;
+      if (childDepth == leafKeyLen)
+        newParent->leaf_ = *currentNode;
+      else
+        newParent->setChild(leafKey[childDepth], *currentNode);
+      if (static_cast<std::size_t>(childDepth) == keyLen)
+        newParent->leaf_ = newLeaf(key, keyLen, value, embed);
+      else
+        newParent->setChild(
+            key[childDepth],
+            newLeaf(key, keyLen, value,
+                    embed && static_cast<std::size_t>(childDepth) + 1 ==
+                                 keyLen));
+      *currentNode = newParent;
+      return T{};
     }
 
-    if (!isPrefixMatch) {
+    /* the node is modified below, or one of its child slots is */
+    unshare(currentNode);
+
+    /* number of bytes of the current node's prefix that match the key */
+    prefixMatchLen = checkPrefix(*currentNode, key, keyLen, depth);
+
+    if (static_cast<uint32_t>(prefixMatchLen) != (**currentNode).prefixLen_) {
       /* prefix mismatch:
        * => new parent node with common prefix and no associated value.
-       * => new node with value to insert.
+       * => new node with value to insert, in the new parent's leaf slot if
+       *    the key ends within the prefix.
        * => current and new node become children of new parent node.
        *
        *        |                        |
@@ -180,36 +1290,58 @@ template <typename T> T Art<T>::set(const char *key, T value) {
        *                        (aa)->v1 ()->v2
        *                        /|\      /|\
        */
-      auto newParent = Node4<T>();
-      newParent.prefix_ = new char[prefixMatchLen];
-      std::copy((**currentNode)->prefix_,
-                (**currentNode)->prefix_ + prefixMatchLen, newParent.prefix_);
-      newParent.prefixLen_ = prefixMatchLen;
-      newParent.setChild((**currentNode).prefix_[prefixMatchLen], *currentNode);
-
-      auto oldPrefix = (**currentNode).prefix_;
-      auto oldPrefixLength = (**currentNode).prefixLen_;
-      (**currentNode).prefix = new char[oldPrefixLength - prefixMatchLen - 1];
-      (**currentNode).prefixLen_ = oldPrefixLength - prefixMatchLen - 1;
-
-      std::copy(oldPrefix + prefixMatchLen + 1, oldPrefix + oldPrefixLength,
-                (**currentNode).prefix_);
-      delete oldPrefix;
-
-      auto newNode = LeafNode<T>(value);
-      newNode.prefix_ = new char[keyLen - depth - prefixMatchLen - 1];
-      std::copy(key + depth + prefixMatchLen + 1, key + keyLen,
-                newNode.prefix_);
-      newNode.prefixLen_ = keyLen - depth - prefixMatchLen - 1;
-      newParent.setChild(key[depth + prefixMatchLen + 1], &newNode);
+      auto newParent = allocNode<Node4<T>>(allocator_);
+      newParent->setGeneration(generation_);
+      newParent->setKeyCount(std::size_t{(**currentNode).keyCount()} + 1);
+      newParent->setPrefix(key + depth, prefixMatchLen);
+
+      /* the bytes of the old prefix past the mismatch are only stored inline
+       * as long as it is not longer than maxPrefixLen */
+      const uint8_t *oldPrefix =
+          (**currentNode).prefixLen_ <= Node<T>::maxPrefixLen
+              ? (**currentNode).prefix_
+              : static_cast<innerNode<T> *>(*currentNode)->minLeaf()->key() +
+                    depth;
+      newParent->setChild(oldPrefix[prefixMatchLen], *currentNode);
+      (**currentNode)
+          .setPrefix(oldPrefix + prefixMatchLen + 1,
+                     (**currentNode).prefixLen_ - prefixMatchLen - 1);
 
+      int childDepth = depth + prefixMatchLen;
+      bool embed = pathInline && newParent->prefixLen_ <= Node<T>::maxPrefixLen;
+      if (static_cast<std::size_t>(childDepth) == keyLen)
+        newParent->leaf_ = newLeaf(key, keyLen, value, embed);
+      else
+        newParent->setChild(
+            key[childDepth],
+            newLeaf(key, keyLen, value,
+                    embed && static_cast<std::size_t>(childDepth) + 1 ==
+                                 keyLen));
       *currentNode = newParent;
       return T{};
     }
 
-    currentInner = reinterpret_cast<innerNode<T> **>(currentInner);
-    childPartialKey = key[depth + (**currentNode).prefixLen_];
-    child = (**currentInner).findChild(childPartialKey);
+    currentInner = static_cast<innerNode<T> *>(*currentNode);
+    if (counting)
+      currentInner->setKeyCount(std::size_t{currentInner->keyCount()} + 1);
+    pathInline =
+        pathInline && currentInner->prefixLen_ <= Node<T>::maxPrefixLen;
+    depth += currentInner->prefixLen_;
+
+    if (static_cast<std::size_t>(depth) == keyLen) {
+      /* key ends at the current node:
+       * => the key belongs into the node's leaf slot.
+       */
+      if (currentInner->leaf_ == nullptr) {
+        currentInner->leaf_ = newLeaf(key, keyLen, value, pathInline);
+        return T{};
+      }
+      currentNode = &currentInner->leaf_;
+      continue;
+    }
+
+    childPartialKey = key[depth];
+    child = currentInner->findChild(childPartialKey);
 
     if (child == nullptr) {
       /*
@@ -222,16 +1354,17 @@ template <typename T> T Art<T>::set(const char *key, T value) {
        *     /         ========>   /      \
        *   (a)->v1               (a)->v1 +()->v2
        */
-      if ((**currentNode).isFull())
-        *currentInner = (**currentInner).grow();
-
-      LeafNode<T> newNode = LeafNode<T>(value);
-      newNode.prefix_ =
-          new char[keyLen - depth - (**currentNode).prefixLen_ - 1];
-      newNode.prefixLen_ = keyLen - depth - (**currentNode).prefixLen_ - 1;
-      std::copy(key + depth + (**currentNode).prefixLen_ + 1, key + keyLen,
-                newNode.prefix_);
-      (**currentNode).setChild(childPartialKey, newNode);
+      if (currentInner->isFull()) {
+        uint32_t keyCount = currentInner->keyCount();
+        *currentNode = currentInner = currentInner->grow(allocator_);
+        currentInner->setGeneration(generation_);
+        currentInner->setKeyCount(keyCount);
+      }
+
+      currentInner->setChild(
+          childPartialKey,
+          newLeaf(key, keyLen, value,
+                  pathInline && static_cast<std::size_t>(depth) + 1 == keyLen));
       return T{};
     }
 
@@ -243,42 +1376,56 @@ template <typename T> T Art<T>::set(const char *key, T value) {
      *  (a)->v1  ()->v2           (a)->v1 *()->v2
      */
 
-    depth += (**currentNode).prefixLen_ + 1;
+    depth += 1;
     currentNode = child;
   }
 }
 
-template <class T> T Art<T>::del(const char *key) {
-  int depth = 0, key_len = std::strlen(key) + 1;
+template <typename T, class Allocator>
+T Art<T, Allocator>::set(std::string_view key, T value) {
+  return set(reinterpret_cast<const uint8_t *>(key.data()), key.size(),
+             value);
+}
+
+template <typename T, class Allocator>
+T Art<T, Allocator>::set(const char *key, T value) {
+  return set(std::string_view(key), value);
+}
+
+template <typename T, class Allocator>
+T Art<T, Allocator>::del(const uint8_t *key, std::size_t keyLen) {
+  int depth = 0;
+  reclaimSnapshots();
 
   if (root == nullptr) {
     return T{};
   }
 
-  /* pointer to parent, current and child node */
-  Node<T> **cur = &root;
-  innerNode<T> **par = nullptr;
-
-  /* partial key of current and child node */
-  char cur_partial_key = 0;
+  /* a missing key must not copy the path shared with a snapshot, nor
+   * change the key counts on its path */
+  if ((frozenGeneration_ != 0 || countKeys_) &&
+      findLeaf(root, key, keyLen) == nullptr) {
+    return T{};
+  }
 
-  while (cur != nullptr) {
-    if ((**cur).prefix_len_ !=
-        (**cur).check_prefix(key + depth, key_len - depth)) {
-      /* prefix mismatch => key doesn't exist */
+  /* pointer to parent and current node */
+  Node<T> **cur = &root;
+  Node<T> **par = nullptr;
 
-      return T{};
-    }
+  /* partial key of current node, depth at which the parent's prefix starts */
+  uint8_t curPartialKey = 0;
+  int parDepth = 0;
 
-    if (key_len == depth + (**cur).prefix_len_) {
-      /* exact match */
-      if (!(**cur).is_leaf()) {
+  while (cur != nullptr && *cur != nullptr) {
+    if (isLeaf(*cur)) {
+      if (!leafMatches(*cur, key, keyLen, depth)) {
+        /* key doesn't exist */
         return T{};
       }
-      auto value = static_cast<LeafNode<T> *>(*cur)->value_;
-      auto n_siblings = par != nullptr ? (**par).n_children() - 1 : 0;
 
-      if (n_siblings == 0) {
+      /* exact match */
+      T value = leafValue(*cur);
+      if (par == nullptr) {
         /*
          * => must be root node
          * => delete root node
@@ -290,13 +1437,20 @@ template <class T> T Art<T>::del(const char *key) {
          *   *(aa)->v2
          */
 
-        if ((**cur).prefix_ != nullptr) {
-          delete[] (**cur).prefix_;
-        }
-        delete (*cur);
+        dropNode(*cur);
         *cur = nullptr;
+        return value;
+      }
 
-      } else if (n_siblings == 1) {
+      auto parInner = static_cast<innerNode<T> *>(*par);
+      dropNode(*cur);
+      if (cur == &parInner->leaf_) {
+        parInner->leaf_ = nullptr;
+      } else {
+        parInner->delChild(curPartialKey);
+      }
+
+      if (parInner->nChildren() + (parInner->leaf_ != nullptr) == 1) {
         /* => delete leaf node
          * => replace parent with sibling
          *
@@ -308,40 +1462,8 @@ template <class T> T Art<T>::del(const char *key) {
          *  (aa)->v1 *()->v2             (aaaaa)->v1
          *  /|\                            /|\
          */
-
-        /* find sibling */
-        auto sibling_partial_key = (**par).next_partial_key(0);
-        if (sibling_partial_key == cur_partial_key) {
-          sibling_partial_key = (**par).next_partial_key(cur_partial_key + 1);
-        }
-        auto sibling = *(**par).find_child(sibling_partial_key);
-
-        auto old_prefix = sibling->prefix_;
-        auto old_prefix_len = sibling->prefix_len_;
-
-        sibling->prefix_ = new char[(**par).prefix_len_ + 1 + old_prefix_len];
-        sibling->prefix_len_ = (**par).prefix_len_ + 1 + old_prefix_len;
-        std::copy((**par).prefix_, (**par).prefix_ + (**par).prefix_len_,
-                  sibling->prefix_);
-        sibling->prefix_[(**par).prefix_len_] = sibling_partial_key;
-        std::copy(old_prefix, old_prefix + old_prefix_len,
-                  sibling->prefix_ + (**par).prefix_len_ + 1);
-        if (old_prefix != nullptr) {
-          delete[] old_prefix;
-        }
-        if ((**cur).prefix_ != nullptr) {
-          delete[] (**cur).prefix_;
-        }
-        delete (*cur);
-        if ((**par).prefix_ != nullptr) {
-          delete[] (**par).prefix_;
-        }
-        delete (*par);
-
-        /* this looks crazy, but I know what I'm doing */
-        *par = static_cast<innerNode<T> *>(sibling);
-
-      } else /* if (n_siblings > 1) */ {
+        collapse(par, parDepth, key);
+      } else if (parInner->isUnderfull()) {
         /* => delete leaf node
          *
          *        |a                         |a
@@ -351,39 +1473,674 @@ template <class T> T Art<T>::del(const char *key) {
          *     /  |   \                   /  |
          *           *()->v1
          */
-
-        if ((**cur).prefix_ != nullptr) {
-          delete[] (**cur).prefix_;
-        }
-        delete (*cur);
-        (**par).del_child(cur_partial_key);
-        if ((**par).is_underfull()) {
-          *par = (**par).shrink();
-        }
+        uint32_t keyCount = parInner->keyCount();
+        *par = parInner->shrink(allocator_);
+        (**par).setGeneration(generation_);
+        (**par).setKeyCount(keyCount);
       }
 
       return value;
     }
 
+    unshare(cur);
+    if (std::min((**cur).prefixLen_, Node<T>::maxPrefixLen) !=
+        static_cast<uint32_t>(
+            (**cur).checkPrefix(key + depth, keyLen - depth))) {
+      /* prefix mismatch => key doesn't exist */
+
+      return T{};
+    }
+
     /* propagate down and repeat */
-    cur_partial_key = key[depth + (**cur).prefix_len_];
-    depth += (**cur).prefix_len_ + 1;
-    par = reinterpret_cast<innerNode<T> **>(cur);
-    cur = (**par).find_child(cur_partial_key);
+    if (countKeys_)
+      (**cur).setKeyCount((**cur).keyCount() - 1);
+    parDepth = depth;
+    depth += (**cur).prefixLen_;
+    par = cur;
+    if (static_cast<std::size_t>(depth) >= keyLen) {
+      /* the key ends at the node, it can only be the one in the leaf slot */
+      cur = static_cast<std::size_t>(depth) == keyLen ? &(**par).leaf_
+                                                      : nullptr;
+      continue;
+    }
+    curPartialKey = key[depth];
+    depth += 1;
+    cur = static_cast<innerNode<T> *>(*par)->findChild(curPartialKey);
   }
   return T{};
 }
 
-template <class T> treeIt<T> Art<T>::begin() {
+template <typename T, class Allocator>
+T Art<T, Allocator>::del(std::string_view key) {
+  return del(reinterpret_cast<const uint8_t *>(key.data()), key.size());
+}
+
+template <typename T, class Allocator>
+T Art<T, Allocator>::del(const char *key) {
+  return del(std::string_view(key));
+}
+
+template <typename T, class Allocator>
+template <class RandomIt>
+void Art<T, Allocator>::bulkLoad(RandomIt first, RandomIt last) {
+  if (root != nullptr) {
+    throw std::logic_error("bulkLoad requires an empty tree");
+  }
+  int n = last - first;
+  if (n == 0) {
+    return;
+  }
+
+  /* common prefix of each key with its predecessor */
+  std::vector<uint32_t> lcp(n, 0);
+  for (int i = 1; i < n; ++i) {
+    std::string_view prev = first[i - 1].first, cur = first[i].first;
+    std::size_t len = std::min(prev.size(), cur.size()), match = 0;
+    while (match < len && prev[match] == cur[match])
+      ++match;
+    if (match == cur.size() ||
+        (match < prev.size() && static_cast<uint8_t>(prev[match]) >
+                                    static_cast<uint8_t>(cur[match]))) {
+      throw std::invalid_argument(
+          "bulkLoad requires keys in strictly ascending order");
+    }
+    lcp[i] = match;
+  }
+
+  root = build(first, lcp, 0, n, 0, true);
+}
+
+template <typename T, class Allocator>
+template <class RandomIt>
+void Art<T, Allocator>::parallelBulkLoad(RandomIt first, RandomIt last,
+                                         ThreadPool &pool) {
+  if (root != nullptr) {
+    throw std::logic_error("parallelBulkLoad requires an empty tree");
+  }
+  std::size_t n = last - first;
+  if (n == 0) {
+    return;
+  }
+
+  /* elements in the order they are built in, viewed through build() */
+  struct ordered {
+    RandomIt first;
+    const uint32_t *order;
+    decltype(auto) operator[](std::size_t i) const { return first[order[i]]; }
+  };
+  auto keyOf = [&](std::size_t i) {
+    return std::string_view(first[i].first);
+  };
+
+  /* group the elements by the first byte of their keys, the empty key
+   * goes first */
+  std::vector<uint32_t> order(n);
+  std::size_t groupStart[258] = {};
+  auto groupOf = [&](std::size_t i) {
+    std::string_view key = keyOf(i);
+    return key.empty() ? 0 : static_cast<uint8_t>(key[0]) + 1;
+  };
+  for (std::size_t i = 0; i < n; ++i)
+    ++groupStart[groupOf(i) + 1];
+  std::partial_sum(groupStart, groupStart + 258, groupStart);
+  {
+    std::vector<std::size_t> pos(groupStart, groupStart + 257);
+    for (std::size_t i = 0; i < n; ++i)
+      order[pos[groupOf(i)]++] = i;
+  }
+  if (groupStart[1] > 1) {
+    throw std::invalid_argument("parallelBulkLoad requires unique keys");
+  }
+
+  /* a single group needs no common root, its keys share the first byte */
+  int nGroups = 0;
+  for (int g = 1; g < 257; ++g)
+    nGroups += groupStart[g + 1] > groupStart[g];
+  bool single = nGroups + (groupStart[1] > 0) == 1;
+
+  std::vector<std::unique_ptr<Art>> parts(257);
+  Node<T> *children[257] = {};
+  ThreadPool::taskGroup group(pool);
+  for (int g = single ? 0 : 1; g < 257; ++g) {
+    std::size_t lo = groupStart[g], hi = groupStart[g + 1];
+    if (lo == hi)
+      continue;
+    parts[g] = std::make_unique<Art>(countKeys_);
+    parts[g]->generation_ = generation_;
+    group.run([&, g, lo, hi, single] {
+      auto byKey = [&](uint32_t a, uint32_t b) { return keyOf(a) < keyOf(b); };
+      if (!std::is_sorted(order.begin() + lo, order.begin() + hi, byKey))
+        std::sort(order.begin() + lo, order.begin() + hi, byKey);
+
+      std::vector<uint32_t> lcp(hi - lo, 0);
+      for (std::size_t i = lo + 1; i < hi; ++i) {
+        std::string_view prev = keyOf(order[i - 1]), cur = keyOf(order[i]);
+        std::size_t len = std::min(prev.size(), cur.size()), match = 0;
+        while (match < len && prev[match] == cur[match])
+          ++match;
+        if (match == cur.size()) {
+          throw std::invalid_argument("parallelBulkLoad requires unique keys");
+        }
+        lcp[i - lo] = match;
+      }
+      children[g] = parts[g]->build(ordered{first, order.data() + lo}, lcp, 0,
+                                    hi - lo, single ? 0 : 1, true);
+      parts[g]->root = children[g];
+    });
+  }
+  group.wait();
+
+  /* the parts hand their nodes over to the tree */
+  for (auto &part : parts) {
+    if (part != nullptr) {
+      allocator_.merge(part->allocator_);
+      part->root = nullptr;
+    }
+  }
+  if (single) {
+    root = children[0] != nullptr ? children[0]
+                                  : *std::find_if(children + 1, children + 257,
+                                                  [](Node<T> *child) {
+                                                    return child != nullptr;
+                                                  });
+    return;
+  }
+
+  innerNode<T> *node = newInnerNode(nGroups);
+  node->setKeyCount(n);
+  if (groupStart[1] > 0) {
+    std::size_t i = order[0];
+    node->leaf_ = newLeaf(nullptr, 0, first[i].second, true);
+  }
+  for (int g = 1; g < 257; ++g) {
+    if (children[g] != nullptr)
+      node->setChild(g - 1, children[g]);
+  }
+  root = node;
+}
+
+template <typename T, class Allocator>
+template <class RandomIt>
+Node<T> *Art<T, Allocator>::build(RandomIt first,
+                                  const std::vector<uint32_t> &lcp, int lo,
+                                  int hi, int depth, bool pathInline) {
+  std::string_view loKey = first[lo].first;
+  auto keyOf = [&](std::string_view key) {
+    return reinterpret_cast<const uint8_t *>(key.data());
+  };
+
+  if (hi - lo == 1) {
+    bool embed =
+        pathInline && loKey.size() == static_cast<std::size_t>(depth);
+    return newLeaf(keyOf(loKey), loKey.size(), first[lo].second, embed);
+  }
+
+  /* the keys' common prefix ends where they branch first, each key sharing
+   * no more than that with its predecessor starts a new child */
+  uint32_t nodeDepth = lcp[lo + 1];
+  int nBranches = 0;
+  for (int i = lo + 1; i < hi; ++i) {
+    if (lcp[i] < nodeDepth) {
+      nodeDepth = lcp[i];
+      nBranches = 0;
+    }
+    nBranches += lcp[i] == nodeDepth;
+  }
+
+  /* a key ending at the node goes to the leaf slot, the other keys are
+   * grouped by their byte at nodeDepth */
+  bool hasLeaf = loKey.size() == nodeDepth;
+  int childLo = lo + hasLeaf;
+  int nChildren = nBranches + 1 - hasLeaf;
+
+  innerNode<T> *node = newInnerNode(nChildren);
+  node->setKeyCount(hi - lo);
+  node->setPrefix(keyOf(loKey) + depth, nodeDepth - depth);
+  pathInline = pathInline && node->prefixLen_ <= Node<T>::maxPrefixLen;
+
+  if (hasLeaf) {
+    node->leaf_ = newLeaf(keyOf(loKey), loKey.size(), first[lo].second,
+                          pathInline);
+  }
+  for (int childHi = childLo + 1; childLo < hi; ++childHi) {
+    if (childHi == hi || lcp[childHi] == nodeDepth) {
+      node->setChild(static_cast<uint8_t>(first[childLo].first[nodeDepth]),
+                     build(first, lcp, childLo, childHi, nodeDepth + 1,
+                           pathInline));
+      childLo = childHi;
+    }
+  }
+  return node;
+}
+
+template <typename T, class Allocator> treeIt<T> Art<T, Allocator>::begin() {
   return treeIt<T>::min(this->root);
 }
 
-template <class T> treeIt<T> Art<T>::begin(const char *key) {
-  return tree_it<T>::greater_equal(this->root, key);
+template <typename T, class Allocator>
+treeIt<T> Art<T, Allocator>::begin(const uint8_t *key, std::size_t keyLen) {
+  return treeIt<T>::greaterEqual(this->root, key, keyLen);
+}
+
+template <typename T, class Allocator>
+treeIt<T> Art<T, Allocator>::begin(std::string_view key) {
+  return begin(reinterpret_cast<const uint8_t *>(key.data()), key.size());
+}
+
+template <typename T, class Allocator>
+treeIt<T> Art<T, Allocator>::begin(const char *key) {
+  return begin(std::string_view(key));
+}
+
+template <typename T, class Allocator> treeIt<T> Art<T, Allocator>::rbegin() {
+  return treeIt<T>::max(this->root);
+}
+
+template <typename T, class Allocator>
+treeIt<T> Art<T, Allocator>::rbegin(const uint8_t *key, std::size_t keyLen) {
+  return treeIt<T>::lessEqual(this->root, key, keyLen);
+}
+
+template <typename T, class Allocator>
+treeIt<T> Art<T, Allocator>::rbegin(std::string_view key) {
+  return rbegin(reinterpret_cast<const uint8_t *>(key.data()), key.size());
+}
+
+template <typename T, class Allocator>
+treeIt<T> Art<T, Allocator>::rbegin(const char *key) {
+  return rbegin(std::string_view(key));
 }
 
-template <class T> treeIt<T> Art<T>::end() { return treeIt<T>(); }
+template <typename T, class Allocator> treeIt<T> Art<T, Allocator>::end() {
+  return treeIt<T>();
+}
+
+template <typename T, class Allocator>
+const Allocator &Art<T, Allocator>::getAllocator() const {
+  return allocator_;
+}
+
+template <typename T, class Allocator>
+ArtStats Art<T, Allocator>::stats() const {
+  ArtStats stats;
+  if (root != nullptr)
+    collectStats(root, 0, stats);
+  return stats;
+}
+
+template <typename T, class Allocator>
+Node<T> *Art<T, Allocator>::newLeaf(const uint8_t *key, int keyLen, T value,
+                                    bool embed) {
+  if constexpr (isEmbeddable<T>::value) {
+    if (embed)
+      return embedValue(value);
+  }
+  auto leaf = new (allocator_.allocate(LeafNode<T>::size(keyLen)))
+      LeafNode<T>(value, key, keyLen);
+  leaf->generation_ = generation_;
+  return tagLeaf(leaf);
+}
+
+template <typename T, class Allocator>
+void Art<T, Allocator>::destroyNode(Node<T> *node) {
+  if (isEmbedded(node))
+    return;
+  if (isLeaf(node)) {
+    LeafNode<T> *leaf = asLeaf(node);
+    std::size_t size = leaf->nodeSize();
+    leaf->~LeafNode<T>();
+    allocator_.deallocate(leaf, size);
+  } else {
+    allocator_.deallocate(node, node->nodeSize());
+  }
+}
+
+template <typename T, class Allocator>
+innerNode<T> *Art<T, Allocator>::newInnerNode(int nChildren) {
+  innerNode<T> *node;
+  if (nChildren <= 4)
+    node = allocNode<Node4<T>>(allocator_);
+  else if (nChildren <= 16)
+    node = allocNode<Node16<T>>(allocator_);
+  else if (nChildren <= 48)
+    node = allocNode<Node48<T>>(allocator_);
+  else
+    node = allocNode<Node256<T>>(allocator_);
+  node->setGeneration(generation_);
+  return node;
+}
+
+template <typename T, class Allocator>
+void Art<T, Allocator>::collapse(Node<T> **slot, int depth,
+                                 const uint8_t *key) {
+  auto node = static_cast<innerNode<T> *>(*slot);
+  int childDepth = depth + node->prefixLen_;
+  Node<T> *child = node->leaf_;
+
+  if (child != nullptr) {
+    if (isEmbedded(child)) {
+      /* an embedded value is only identified by its position, so it has
+       * to be moved into a leaf record */
+      child = newLeaf(key, childDepth, leafValue(child), false);
+    }
+  } else {
+    /* find the remaining child */
+    uint8_t childPartialKey = node->nextPartialKey(0);
+    child = *node->findChild(childPartialKey);
+    childDepth += 1;
+
+    if (!isLeaf(child)) {
+      unshare(&child);
+      /* parent prefix, partial key and child prefix become the new
+       * prefix, the key holds the parent prefix bytes that might not
+       * have been stored inline */
+      uint8_t prefix[Node<T>::maxPrefixLen];
+      uint32_t len = 0,
+               newPrefixLen = node->prefixLen_ + 1 + child->prefixLen_;
+      for (; len < node->prefixLen_ && len < Node<T>::maxPrefixLen; ++len)
+        prefix[len] = key[depth + len];
+      if (len < Node<T>::maxPrefixLen)
+        prefix[len++] = childPartialKey;
+      std::copy(child->prefix_,
+                child->prefix_ + std::min(Node<T>::maxPrefixLen - len,
+                                          child->prefixLen_),
+                prefix + len);
+
+      if (newPrefixLen > Node<T>::maxPrefixLen &&
+          child->prefixLen_ <= Node<T>::maxPrefixLen) {
+        /* the child's prefix becomes compressed optimistically, values
+         * embedded below it are moved into leaf records */
+        /* the key may end at the node, its last byte isn't read */
+        std::vector<uint8_t> path(key, key + childDepth - 1);
+        path.push_back(childPartialKey);
+        materialize(&child, path);
+      }
+      child->setPrefix(prefix, newPrefixLen);
+    } else if (isEmbedded(child)) {
+      std::vector<uint8_t> path(key, key + childDepth - 1);
+      path.push_back(childPartialKey);
+      child = newLeaf(path.data(), childDepth, leafValue(child), false);
+    }
+  }
+
+  dropNode(node);
+  *slot = child;
+}
+
+template <typename T, class Allocator>
+void Art<T, Allocator>::materialize(Node<T> **slot,
+                                    std::vector<uint8_t> &path) {
+  if constexpr (isEmbeddable<T>::value) {
+    unshare(slot);
+    auto inner = static_cast<innerNode<T> *>(*slot);
+    std::size_t depth = path.size();
+    path.insert(path.end(), inner->prefix_,
+                inner->prefix_ + inner->prefixLen_);
+    if (inner->leaf_ != nullptr && isEmbedded(inner->leaf_))
+      inner->leaf_ = newLeaf(path.data(), path.size(),
+                             embeddedValue(inner->leaf_), false);
+    for (auto it = inner->begin(), itEnd = inner->end(); it != itEnd; ++it) {
+      if (it.isLeafSlot())
+        continue;
+      Node<T> **child = inner->findChild(*it);
+      path.push_back(*it);
+      if (isEmbedded(*child))
+        *child = newLeaf(path.data(), path.size(), embeddedValue(*child),
+                         false);
+      else if (!isLeaf(*child) &&
+               (**child).prefixLen_ <= Node<T>::maxPrefixLen)
+        /* there is nothing embedded below optimistic prefixes */
+        materialize(child, path);
+      path.pop_back();
+    }
+    path.resize(depth);
+  }
+}
+
+template <typename T, class Allocator>
+Node<T> *Art<T, Allocator>::findLeaf(Node<T> *root, const uint8_t *key,
+                                    int keyLen) {
+  Node<T> *current = root;
+  int depth = 0;
+  while (current != nullptr && !isLeaf(current))
+    current = descend(current, key, keyLen, depth);
+  return current != nullptr && leafMatches(current, key, keyLen, depth)
+             ? current
+             : nullptr;
+}
+
+template <typename T, class Allocator>
+bool Art<T, Allocator>::isFrozen(Node<T> *node) const {
+  if (isEmbedded(node))
+    return false;
+  uint32_t generation =
+      isLeaf(node) ? asLeaf(node)->generation_ : node->generation();
+  return generation <= frozenGeneration_;
+}
+
+template <typename T, class Allocator>
+void Art<T, Allocator>::unshare(Node<T> **slot) {
+  if (isLeaf(*slot) || !isFrozen(*slot))
+    return;
+  innerNode<T> *copy = static_cast<innerNode<T> *>(*slot)->copy(allocator_);
+  copy->setGeneration(generation_);
+  copy->setKeyCount((**slot).keyCount());
+  dropNode(*slot);
+  *slot = copy;
+}
+
+template <typename T, class Allocator>
+void Art<T, Allocator>::dropNode(Node<T> *node) {
+  if (isFrozen(node)) {
+    uint32_t generation =
+        isLeaf(node) ? asLeaf(node)->generation_ : node->generation();
+    retired_.push_back({node, generation, generation_ - 1});
+    return;
+  }
+  destroyNode(node);
+}
+
+template <typename T, class Allocator>
+void Art<T, Allocator>::reclaimSnapshots() {
+  std::size_t nReleased = nReleased_.load(std::memory_order_acquire);
+  if (nReleased == nReclaimed_)
+    return;
+  nReclaimed_ = nReleased;
+
+  snapshots_.erase(std::remove_if(snapshots_.begin(), snapshots_.end(),
+                                  [](const auto &snapshot) {
+                                    return snapshot->handles.load(
+                                               std::memory_order_acquire) ==
+                                           0;
+                                  }),
+                   snapshots_.end());
+  frozenGeneration_ =
+      snapshots_.empty() ? 0 : snapshots_.back()->generation;
+
+  /* the snapshots are ordered by generation */
+  auto isUnreachable = [&](const retiredNode &r) {
+    auto it = std::lower_bound(snapshots_.begin(), snapshots_.end(), r.from,
+                               [](const auto &snapshot, uint32_t generation) {
+                                 return snapshot->generation < generation;
+                               });
+    return it == snapshots_.end() || (**it).generation > r.to;
+  };
+  auto it = std::partition(retired_.begin(), retired_.end(),
+                           [&](const retiredNode &r) {
+                             return !isUnreachable(r);
+                           });
+  for (auto r = it; r != retired_.end(); ++r)
+    destroyNode(r->node);
+  retired_.erase(it, retired_.end());
+}
+
+template <typename T, class Allocator>
+typename Art<T, Allocator>::Snapshot Art<T, Allocator>::snapshot() {
+  reclaimSnapshots();
+  auto state = std::make_unique<snapshotState>();
+  state->generation = generation_;
+  state->root = root;
+  state->released = &nReleased_;
+  frozenGeneration_ = generation_++;
+  snapshots_.push_back(std::move(state));
+  return Snapshot(snapshots_.back().get());
+}
+
+template <typename T, class Allocator>
+std::vector<char> Art<T, Allocator>::freeze() const {
+  return FrozenArt<T>::write(root);
+}
+
+template <typename T, class Allocator>
+void Art<T, Allocator>::freeze(const char *path) const {
+  std::vector<char> image = freeze();
+  std::string tmpPath = std::string(path) + ".tmp";
+  int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    throw std::system_error(errno, std::generic_category(), tmpPath);
+
+  /* the image reaches the disk before it replaces the file, and the
+   * rename once the directory is synced */
+  int error = 0;
+  for (const char *data = image.data(), *end = data + image.size();
+       data < end && error == 0;) {
+    ssize_t written = ::write(fd, data, end - data);
+    if (written >= 0)
+      data += written;
+    else if (errno != EINTR)
+      error = errno;
+  }
+  if (error == 0 && ::fsync(fd) != 0)
+    error = errno;
+  ::close(fd);
+  if (error == 0 && std::rename(tmpPath.c_str(), path) != 0)
+    error = errno;
+  if (error != 0) {
+    std::remove(tmpPath.c_str());
+    throw std::system_error(error, std::generic_category(), path);
+  }
+
+  std::string dir(path);
+  std::size_t slash = dir.rfind('/');
+  dir = slash == std::string::npos ? "." : dir.substr(0, slash);
+  fd = ::open(dir.empty() ? "/" : dir.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::system_error(errno, std::generic_category(), dir);
+  int result = ::fsync(fd);
+  error = errno;
+  ::close(fd);
+  if (result != 0)
+    throw std::system_error(error, std::generic_category(), dir);
+}
+
+template <typename T, class Allocator>
+Art<T, Allocator>::Snapshot::Snapshot(snapshotState *state) : state_(state) {}
+
+template <typename T, class Allocator>
+Art<T, Allocator>::Snapshot::Snapshot(const Snapshot &other)
+    : state_(other.state_) {
+  state_->handles.fetch_add(1, std::memory_order_relaxed);
+}
+
+template <typename T, class Allocator>
+typename Art<T, Allocator>::Snapshot &
+Art<T, Allocator>::Snapshot::operator=(const Snapshot &other) {
+  other.state_->handles.fetch_add(1, std::memory_order_relaxed);
+  release();
+  state_ = other.state_;
+  return *this;
+}
+
+template <typename T, class Allocator>
+Art<T, Allocator>::Snapshot::~Snapshot() {
+  release();
+}
+
+template <typename T, class Allocator>
+void Art<T, Allocator>::Snapshot::release() {
+  /* the tree reclaims the version on its next modification, and may free
+   * the state as soon as the last handle is dropped */
+  std::atomic<std::size_t> *released = state_->released;
+  if (state_->handles.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    released->fetch_add(1, std::memory_order_release);
+}
+
+template <typename T, class Allocator>
+T Art<T, Allocator>::Snapshot::get(const uint8_t *key,
+                                   std::size_t keyLen) const {
+  Node<T> *leaf = findLeaf(state_->root, key, keyLen);
+  return leaf != nullptr ? leafValue(leaf) : T{};
+}
+
+template <typename T, class Allocator>
+T Art<T, Allocator>::Snapshot::get(std::string_view key) const {
+  return get(reinterpret_cast<const uint8_t *>(key.data()), key.size());
+}
+
+template <typename T, class Allocator>
+T Art<T, Allocator>::Snapshot::get(const char *key) const {
+  return get(std::string_view(key));
+}
+
+template <typename T, class Allocator>
+treeIt<T> Art<T, Allocator>::Snapshot::begin() const {
+  return treeIt<T>::min(state_->root);
+}
+
+template <typename T, class Allocator>
+treeIt<T> Art<T, Allocator>::Snapshot::begin(const uint8_t *key,
+                                             std::size_t keyLen) const {
+  return treeIt<T>::greaterEqual(state_->root, key, keyLen);
+}
+
+template <typename T, class Allocator>
+treeIt<T> Art<T, Allocator>::Snapshot::begin(std::string_view key) const {
+  return begin(reinterpret_cast<const uint8_t *>(key.data()), key.size());
+}
+
+template <typename T, class Allocator>
+treeIt<T> Art<T, Allocator>::Snapshot::rbegin() const {
+  return treeIt<T>::max(state_->root);
+}
+
+template <typename T, class Allocator>
+treeIt<T> Art<T, Allocator>::Snapshot::rbegin(const uint8_t *key,
+                                              std::size_t keyLen) const {
+  return treeIt<T>::lessEqual(state_->root, key, keyLen);
+}
+
+template <typename T, class Allocator>
+treeIt<T> Art<T, Allocator>::Snapshot::rbegin(std::string_view key) const {
+  return rbegin(reinterpret_cast<const uint8_t *>(key.data()), key.size());
+}
+
+template <typename T, class Allocator>
+treeIt<T> Art<T, Allocator>::Snapshot::end() const {
+  return treeIt<T>();
+}
+
+template <typename T, class Allocator>
+std::vector<char> Art<T, Allocator>::Snapshot::freeze() const {
+  return FrozenArt<T>::write(state_->root);
+}
+
+template <typename T, class Allocator>
+int Art<T, Allocator>::checkPrefix(Node<T> *node, const uint8_t *key,
+                                   int keyLen, int depth) {
+  int matchLen = node->checkPrefix(key + depth, keyLen - depth);
+  if (node->prefixLen_ <= Node<T>::maxPrefixLen ||
+      static_cast<uint32_t>(matchLen) < Node<T>::maxPrefixLen)
+    return matchLen;
+
+  /* all leaves below the node share its prefix, use any of them to compare
+   * the bytes that are not stored inline */
+  const uint8_t *leafKey = static_cast<innerNode<T> *>(node)->minLeaf()->key();
+  int len = std::min<int>(node->prefixLen_, keyLen - depth);
+  while (matchLen < len && key[depth + matchLen] == leafKey[depth + matchLen])
+    ++matchLen;
+  return matchLen;
+}
 
 } // namespace art
 
-#endif // ART_HPP
+#endif // ART_ART_HPP
@@ -2,12 +2,19 @@
 #define ART_CHILDIT_HPP
 
 #include "node.hpp"
+#include <cassert>
+#include <cstdint>
 #include <iterator>
 #include <stdexcept>
 
 namespace art {
 template <class T> class innerNode;
 
+/**
+ * Bidirectional iterator on the children of an inner node in ascending order
+ * of their partial keys. If the node has a leaf slot, the iterator visits it
+ * first; the leaf slot has no partial key, see isLeafSlot().
+ */
 template <class T> class childIt {
 public:
   childIt() = default;
@@ -19,7 +26,7 @@ public:
   childIt<T> &operator=(childIt<T> &&other) noexcept = default;
 
   using iterator_category = std::bidirectional_iterator_tag;
-  using value_type = const char;
+  using value_type = const uint8_t;
   using difference_type = int;
   using pointer = value_type *;
   using reference = value_type &;
@@ -37,12 +44,20 @@ public:
   bool operator<=(const childIt &rhs) const;
   bool operator>=(const childIt &rhs) const;
 
-  char getPartialKeys() const;
+  uint8_t getPartialKey() const;
   Node<T> *getChildNode() const;
 
+  /**
+   * Determines if the iterator is on the node's leaf slot.
+   */
+  bool isLeafSlot() const;
+
 private:
+  /* index among the children with a partial key */
+  int childIndex() const;
+
   innerNode<T> *node = nullptr;
-  char curPartialKey = -128;
+  uint8_t curPartialKey = 0;
   int relativeIndex = 0;
 };
 
@@ -51,35 +66,36 @@ template <class T> childIt<T>::childIt(innerNode<T> *n) : childIt<T>(n, 0) {}
 template <class T>
 childIt<T>::childIt(innerNode<T> *n, int relativeIndex)
     : node(n), curPartialKey(0), relativeIndex(relativeIndex) {
-  if (relativeIndex < 0) {
+  if (node == nullptr) {
     return;
   }
 
-  if (relativeIndex >= node->nChildren()) {
+  int index = childIndex();
+  if (index < 0 || index >= node->nChildren()) {
     return;
   }
 
-  if (relativeIndex == node->nChildren() - 1) {
-    curPartialKey = node->prevPartialKey(127);
+  if (index == node->nChildren() - 1) {
+    curPartialKey = node->prevPartialKey(255);
     return;
   }
 
-  curPartialKey = node->nextPartialKey(-128);
-  for (int i = 0; i < relativeIndex; ++i)
+  curPartialKey = node->nextPartialKey(0);
+  for (int i = 0; i < index; ++i)
     curPartialKey = node->nextPartialKey(curPartialKey + 1);
 }
 
 template <class T>
 typename childIt<T>::reference childIt<T>::operator*() const {
-  if (relativeIndex < 0 || relativeIndex >= node->nChildren()) {
+  if (childIndex() < 0 || childIndex() >= node->nChildren()) {
     throw std::out_of_range("Child iterator out of range");
   }
 
-  return &curPartialKey;
+  return curPartialKey;
 }
 
 template <class T> typename childIt<T>::pointer childIt<T>::operator->() const {
-  if (relativeIndex < 0 || relativeIndex >= node->n_children()) {
+  if (childIndex() < 0 || childIndex() >= node->nChildren()) {
     throw std::out_of_range("child iterator is out of range");
   }
 
@@ -88,11 +104,16 @@ template <class T> typename childIt<T>::pointer childIt<T>::operator->() const {
 
 template <class T> childIt<T> &childIt<T>::operator++() {
   ++relativeIndex;
-  if (relativeIndex < 0) {
+  if (node == nullptr) {
     return *this;
-  } else if (relativeIndex == 0) {
-    curPartialKey = node->nextPartialKey(-128);
-  } else if (relativeIndex < node->n_children()) {
+  }
+
+  int index = childIndex();
+  if (index < 0) {
+    return *this;
+  } else if (index == 0) {
+    curPartialKey = node->nextPartialKey(0);
+  } else if (index < node->nChildren()) {
     curPartialKey = node->nextPartialKey(curPartialKey + 1);
   }
   return *this;
@@ -106,11 +127,16 @@ template <class T> childIt<T> childIt<T>::operator++(int) {
 
 template <class T> childIt<T> &childIt<T>::operator--() {
   --relativeIndex;
-  if (relativeIndex > node->nChildren() - 1) {
+  if (node == nullptr) {
     return *this;
-  } else if (relativeIndex == node->nChildren() - 1) {
-    curPartialKey = node->prevPartialKey(127);
-  } else if (relativeIndex >= 0) {
+  }
+
+  int index = childIndex();
+  if (index > node->nChildren() - 1) {
+    return *this;
+  } else if (index == node->nChildren() - 1) {
+    curPartialKey = node->prevPartialKey(255);
+  } else if (index >= 0) {
     curPartialKey = node->prevPartialKey(curPartialKey - 1);
   }
   return *this;
@@ -146,15 +172,26 @@ template <class T> bool childIt<T>::operator>(const childIt<T> &rhs) const {
   return (rhs < (*this));
 }
 
-template <class T> char childIt<T>::getPartialKeys() const {
+template <class T> uint8_t childIt<T>::getPartialKey() const {
   return curPartialKey;
 }
 
 template <class T> Node<T> *childIt<T>::getChildNode() const {
-  assert(0 <= relativeIndex && relativeIndex < node->nChildren());
+  assert(0 <= relativeIndex && childIndex() < node->nChildren());
+  if (isLeafSlot()) {
+    return node->leaf_;
+  }
   return *node->findChild(curPartialKey);
 }
 
+template <class T> bool childIt<T>::isLeafSlot() const {
+  return node != nullptr && node->leaf_ != nullptr && relativeIndex == 0;
+}
+
+template <class T> int childIt<T>::childIndex() const {
+  return relativeIndex - (node->leaf_ != nullptr);
+}
+
 } // namespace art
 
 #endif // !ART_CHILDIT_HPP
@@ -0,0 +1,745 @@
+#ifndef ART_CONCURRENT_ART_HPP
+#define ART_CONCURRENT_ART_HPP
+
+#include "allocator.hpp"
+#include "epoch.hpp"
+#include "innerNode.hpp"
+#include "leafNode.hpp"
+#include "node.hpp"
+#include "node16.hpp"
+#include "node256.hpp"
+#include "node4.hpp"
+#include "node48.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace art {
+
+/**
+ * Adaptive radix tree that can be read and modified by several threads at
+ * once, synchronized through optimistic lock coupling (Leis et al., "The ART
+ * of Practical Synchronization").
+ *
+ * Readers take no locks: they validate the version of every inner node they
+ * read and restart from the root if a writer modified it in the meantime.
+ * Writers lock only the nodes they modify, i.e. a single node for most
+ * insertions and deletions, and the parent as well when a node is replaced
+ * by grow(), shrink() or a prefix split.
+ *
+ * Since readers may still be reading a node that was removed from the
+ * tree, removed nodes and leaves are retired to an EpochManager and freed
+ * once no operation that started before their removal is running any more.
+ * With a single writer, this makes the tree a many-reader structure whose
+ * get() and forEach() never lock or wait.
+ *
+ * Leaves are always leaf records and are never modified once published: a
+ * new value replaces the whole leaf.
+ */
+template <typename T> class ConcurrentArt {
+public:
+  ConcurrentArt();
+  ConcurrentArt(const ConcurrentArt &other) = delete;
+  ConcurrentArt &operator=(const ConcurrentArt &other) = delete;
+  ~ConcurrentArt();
+
+  /**
+   * Finds the value associated with the given key.
+   *
+   * @param key - The key to find.
+   * @param keyLen - The length of the key in bytes.
+   * @return the value associated with the key or a default constructed value.
+   */
+  T get(const uint8_t *key, std::size_t keyLen) const;
+  T get(std::string_view key) const;
+
+  /**
+   * Associates the given key with the given value.
+   *
+   * @param key - The key to associate with the value.
+   * @param keyLen - The length of the key in bytes.
+   * @param value - The value to be associated with the key.
+   * @return the previously associated value or a default constructed value.
+   */
+  T set(const uint8_t *key, std::size_t keyLen, T value);
+  T set(std::string_view key, T value);
+
+  /**
+   * Deletes the given key and returns its associated value.
+   *
+   * @param key - The key to delete.
+   * @param keyLen - The length of the key in bytes.
+   * @return the value associated with the key or a default constructed value.
+   */
+  T del(const uint8_t *key, std::size_t keyLen);
+  T del(std::string_view key);
+
+  /**
+   * Calls fn(std::string_view key, T value) for every key in lexicographic
+   * order without locking. Each key is looked up as the successor of the
+   * previous one, so keys set or deleted during the walk may or may not be
+   * visited, but every key present throughout the walk is visited once.
+   */
+  template <class Fn> void forEach(Fn fn) const;
+
+private:
+  /**
+   * Allocator handed to grow() and shrink(), which retires the node they
+   * replace instead of freeing it.
+   */
+  class retiringAllocator {
+  public:
+    explicit retiringAllocator(ConcurrentArt<T> *tree) : tree_(tree) {}
+    void *allocate(std::size_t size) {
+      return tree_->allocator_.allocate(size);
+    }
+    /* nodes replaced by grow() or shrink() stay alive for the readers
+     * still on them */
+    static constexpr bool defersDestruction = true;
+    template <class N> void retireNode(N *node) {
+      tree_->retire(node, sizeof(N));
+    }
+
+  private:
+    ConcurrentArt<T> *tree_;
+  };
+
+  /*
+   * Single attempts of the operations, which return false if they have to
+   * be restarted.
+   */
+  bool tryGet(const uint8_t *key, int keyLen, T &value) const;
+  bool trySet(const uint8_t *key, int keyLen, T value, T &oldValue);
+  bool tryDel(const uint8_t *key, int keyLen, T &value);
+
+  /**
+   * Finds the full prefix of the node at the given depth and version. The
+   * bytes that are not stored inline are taken from a leaf below the node.
+   *
+   * @return the prefix or a null pointer if the caller has to restart.
+   */
+  const uint8_t *fullPrefix(Node<T> *node, uint64_t version, int depth) const;
+
+  /**
+   * Finds the smallest leaf below the node with the given version.
+   *
+   * @return the leaf or a null pointer if the subtree is empty or the caller
+   * has to restart, which is signaled through restart.
+   */
+  const LeafNode<T> *minLeaf(Node<T> *node, uint64_t version,
+                             bool &restart) const;
+
+  /**
+   * Finds the smallest leaf below the node whose key is greater than the
+   * given one, the node's prefix starts at depth.
+   */
+  const LeafNode<T> *successor(Node<T> *node, uint64_t version, int depth,
+                               const uint8_t *key, int keyLen,
+                               bool &restart) const;
+
+  Node<T> *newLeaf(const uint8_t *key, int keyLen, T value);
+
+  /**
+   * Replaces the node in the slot of the given, write-locked parent.
+   */
+  static void replaceChild(Node<T> *parent, uint8_t partialKey,
+                           Node<T> *node);
+
+  /**
+   * Hands a node or leaf that was removed from the tree to the epoch
+   * manager, which frees it once no reader can reach it any more.
+   */
+  void retire(Node<T> *node);
+  void retire(Node<T> *node, std::size_t size);
+  static void reclaimNode(void *tree, void *node, std::size_t size);
+
+  ConcurrentSlabAllocator allocator_;
+  retiringAllocator retiring_{this};
+  /* never replaced, so that there always is a node to lock */
+  Node256<T> *root_;
+  mutable EpochManager epochs_;
+};
+
+template <typename T>
+ConcurrentArt<T>::ConcurrentArt()
+    : root_(allocNode<Node256<T>>(allocator_)) {}
+
+template <typename T> ConcurrentArt<T>::~ConcurrentArt() {
+  /* nodes are freed along with the allocator's slabs, the tree
+   * only needs to be walked if the values have to be destructed */
+  if (!std::is_trivially_destructible<T>::value) {
+    std::vector<Node<T> *> nodeStack{root_};
+    while (!nodeStack.empty()) {
+      Node<T> *node = nodeStack.back();
+      nodeStack.pop_back();
+      if (!isLeaf(node)) {
+        auto inner = static_cast<innerNode<T> *>(node);
+        for (auto it = inner->begin(), itEnd = inner->end(); it != itEnd;
+             ++it) {
+          nodeStack.push_back(it.getChildNode());
+        }
+      } else {
+        asLeaf(node)->~LeafNode<T>();
+      }
+    }
+  }
+  epochs_.release();
+  allocator_.release();
+}
+
+template <typename T>
+T ConcurrentArt<T>::get(const uint8_t *key, std::size_t keyLen) const {
+  auto guard = epochs_.pin();
+  T value;
+  while (!tryGet(key, keyLen, value)) {
+  }
+  return value;
+}
+
+template <typename T> T ConcurrentArt<T>::get(std::string_view key) const {
+  return get(reinterpret_cast<const uint8_t *>(key.data()), key.size());
+}
+
+template <typename T>
+T ConcurrentArt<T>::set(const uint8_t *key, std::size_t keyLen, T value) {
+  auto guard = epochs_.pin();
+  T oldValue;
+  while (!trySet(key, keyLen, value, oldValue)) {
+  }
+  return oldValue;
+}
+
+template <typename T>
+T ConcurrentArt<T>::set(std::string_view key, T value) {
+  return set(reinterpret_cast<const uint8_t *>(key.data()), key.size(),
+             value);
+}
+
+template <typename T>
+T ConcurrentArt<T>::del(const uint8_t *key, std::size_t keyLen) {
+  auto guard = epochs_.pin();
+  T value;
+  while (!tryDel(key, keyLen, value)) {
+  }
+  return value;
+}
+
+template <typename T> T ConcurrentArt<T>::del(std::string_view key) {
+  return del(reinterpret_cast<const uint8_t *>(key.data()), key.size());
+}
+
+template <typename T>
+bool ConcurrentArt<T>::tryGet(const uint8_t *key, int keyLen,
+                              T &value) const {
+  Node<T> *node = root_;
+  uint64_t version;
+  int depth = 0;
+  if (!node->readLock(version))
+    return false;
+
+  while (true) {
+    Node<T> *next = descend(node, key, keyLen, depth);
+    if (!node->validate(version))
+      return false;
+
+    if (next == nullptr || isLeaf(next)) {
+      /* leaves are immutable and outlive the readers */
+      value = next != nullptr && leafMatches(next, key, keyLen, depth)
+                  ? leafValue(next)
+                  : T{};
+      return true;
+    }
+
+    /* the parent must still point to the child once its version is read,
+     * otherwise the child might have been moved */
+    uint64_t nextVersion;
+    if (!next->readLock(nextVersion) || !node->validate(version))
+      return false;
+    node = next;
+    version = nextVersion;
+  }
+}
+
+template <typename T>
+bool ConcurrentArt<T>::trySet(const uint8_t *key, int keyLen, T value,
+                              T &oldValue) {
+  Node<T> *parent = nullptr;
+  uint64_t parentVersion = 0;
+  uint8_t parentPartialKey = 0;
+
+  Node<T> *node = root_;
+  uint64_t version;
+  int depth = 0;
+  if (!node->readLock(version))
+    return false;
+
+  oldValue = T{};
+  while (true) {
+    auto inner = static_cast<innerNode<T> *>(node);
+    const uint8_t *prefix = fullPrefix(node, version, depth);
+    if (prefix == nullptr)
+      return false;
+
+    int prefixLen = std::min<int>(node->prefixLen_, keyLen - depth);
+    int prefixMatchLen =
+        std::mismatch(prefix, prefix + prefixLen, key + depth).first - prefix;
+
+    if (static_cast<uint32_t>(prefixMatchLen) != node->prefixLen_) {
+      /* prefix mismatch, see Art::set(), the root has no prefix */
+      if (!parent->upgradeToWriteLock(parentVersion))
+        return false;
+      if (!node->upgradeToWriteLock(version)) {
+        parent->writeUnlock();
+        return false;
+      }
+
+      auto newParent = allocNode<Node4<T>>(allocator_);
+      newParent->setPrefix(key + depth, prefixMatchLen);
+      newParent->setChild(prefix[prefixMatchLen], node);
+      node->setPrefix(prefix + prefixMatchLen + 1,
+                      node->prefixLen_ - prefixMatchLen - 1);
+
+      int childDepth = depth + prefixMatchLen;
+      if (childDepth == keyLen)
+        newParent->leaf_ = newLeaf(key, keyLen, value);
+      else
+        newParent->setChild(key[childDepth], newLeaf(key, keyLen, value));
+
+      replaceChild(parent, parentPartialKey, newParent);
+      node->writeUnlock();
+      parent->writeUnlock();
+      return true;
+    }
+
+    depth += node->prefixLen_;
+    if (depth == keyLen) {
+      /* key ends at the node, it belongs into the leaf slot */
+      if (!node->upgradeToWriteLock(version))
+        return false;
+      if (parent != nullptr && !parent->validate(parentVersion)) {
+        node->writeUnlock();
+        return false;
+      }
+      if (node->leaf_ != nullptr) {
+        oldValue = leafValue(node->leaf_);
+        retire(node->leaf_);
+      }
+      node->leaf_ = newLeaf(key, keyLen, value);
+      node->writeUnlock();
+      return true;
+    }
+
+    Node<T> **child = inner->findChild(key[depth]);
+    Node<T> *next = child != nullptr ? *child : nullptr;
+    if (!node->validate(version))
+      return false;
+
+    if (next == nullptr) {
+      if (inner->isFull()) {
+        /* the grown node replaces the current one in its parent, the root
+         * is a Node256 and never full */
+        if (!parent->upgradeToWriteLock(parentVersion))
+          return false;
+        if (!node->upgradeToWriteLock(version)) {
+          parent->writeUnlock();
+          return false;
+        }
+        /* readers on the node restart once it is obsolete, it is retired
+         * by grow() and stays readable until they are done */
+        node->writeUnlockObsolete();
+        innerNode<T> *grown = inner->grow(retiring_);
+        grown->setChild(key[depth], newLeaf(key, keyLen, value));
+        replaceChild(parent, parentPartialKey, grown);
+        parent->writeUnlock();
+        return true;
+      }
+
+      if (!node->upgradeToWriteLock(version))
+        return false;
+      if (parent != nullptr && !parent->validate(parentVersion)) {
+        node->writeUnlock();
+        return false;
+      }
+      inner->setChild(key[depth], newLeaf(key, keyLen, value));
+      node->writeUnlock();
+      return true;
+    }
+
+    if (parent != nullptr && !parent->validate(parentVersion))
+      return false;
+
+    if (isLeaf(next)) {
+      if (!node->upgradeToWriteLock(version))
+        return false;
+      Node<T> **slot = inner->findChild(key[depth]);
+      LeafNode<T> *leaf = asLeaf(next);
+
+      if (leaf->matches(key, keyLen)) {
+        /* exact match, the leaf is replaced */
+        oldValue = leaf->value;
+        *slot = newLeaf(key, keyLen, value);
+        retire(next);
+        node->writeUnlock();
+        return true;
+      }
+
+      /* leaf holding another key, see Art::set() */
+      const uint8_t *leafKey = leaf->key();
+      int leafKeyLen = leaf->keyLen_;
+      int leafDepth = depth + 1, matchLen = 0;
+      while (leafDepth + matchLen < leafKeyLen &&
+             leafDepth + matchLen < keyLen &&
+             key[leafDepth + matchLen] == leafKey[leafDepth + matchLen])
+        ++matchLen;
+
+      auto newParent = allocNode<Node4<T>>(allocator_);
+      newParent->setPrefix(key + leafDepth, matchLen);
+      int childDepth = leafDepth + matchLen;
+      if (childDepth == leafKeyLen)
+        newParent->leaf_ = next;
+      else
+        newParent->setChild(leafKey[childDepth], next);
+      if (childDepth == keyLen)
+        newParent->leaf_ = newLeaf(key, keyLen, value);
+      else
+        newParent->setChild(key[childDepth], newLeaf(key, keyLen, value));
+      *slot = newParent;
+      node->writeUnlock();
+      return true;
+    }
+
+    uint64_t nextVersion;
+    if (!next->readLock(nextVersion) || !node->validate(version))
+      return false;
+    parent = node;
+    parentVersion = version;
+    parentPartialKey = key[depth];
+    node = next;
+    version = nextVersion;
+    depth += 1;
+  }
+}
+
+template <typename T>
+bool ConcurrentArt<T>::tryDel(const uint8_t *key, int keyLen, T &value) {
+  Node<T> *parent = nullptr;
+  uint64_t parentVersion = 0;
+  uint8_t parentPartialKey = 0;
+
+  Node<T> *node = root_;
+  uint64_t version;
+  int depth = 0;
+  if (!node->readLock(version))
+    return false;
+
+  value = T{};
+  while (true) {
+    auto inner = static_cast<innerNode<T> *>(node);
+    int nodeDepth = depth;
+    Node<T> *next = descend(node, key, keyLen, depth);
+    bool leafSlot = nodeDepth + node->prefixLen_ ==
+                    static_cast<uint32_t>(keyLen);
+    if (!node->validate(version))
+      return false;
+
+    if (next == nullptr)
+      return true;
+    uint8_t partialKey = leafSlot ? 0 : key[depth - 1];
+
+    if (!isLeaf(next)) {
+      uint64_t nextVersion;
+      if (!next->readLock(nextVersion) || !node->validate(version))
+        return false;
+      parent = node;
+      parentVersion = version;
+      parentPartialKey = partialKey;
+      node = next;
+      version = nextVersion;
+      continue;
+    }
+
+    if (!asLeaf(next)->matches(key, keyLen))
+      return true;
+
+    int nRemaining = inner->nChildren() + (inner->leaf_ != nullptr) - 1;
+    if (parent != nullptr && nRemaining == 1) {
+      /* the node is replaced by its remaining child or leaf, see
+       * Art::collapse() */
+      if (!parent->upgradeToWriteLock(parentVersion))
+        return false;
+      if (!node->upgradeToWriteLock(version)) {
+        parent->writeUnlock();
+        return false;
+      }
+
+      /* the remaining entry is the first one that is not deleted */
+      auto it = inner->begin();
+      if (leafSlot ? it.isLeafSlot() : it.getChildNode() == next)
+        ++it;
+      Node<T> *replacement = it.getChildNode();
+      if (!isLeaf(replacement)) {
+        /* the child's prefix grows by the node's prefix and partial key */
+        if (!replacement->writeLock()) {
+          node->writeUnlock();
+          parent->writeUnlock();
+          return false;
+        }
+        uint8_t prefix[Node<T>::maxPrefixLen];
+        uint32_t len = 0;
+        uint32_t newPrefixLen = node->prefixLen_ + 1 + replacement->prefixLen_;
+        for (; len < node->prefixLen_ && len < Node<T>::maxPrefixLen; ++len)
+          prefix[len] = key[nodeDepth + len];
+        if (len < Node<T>::maxPrefixLen)
+          prefix[len++] = it.getPartialKey();
+        std::copy(replacement->prefix_,
+                  replacement->prefix_ +
+                      std::min(Node<T>::maxPrefixLen - len,
+                               replacement->prefixLen_),
+                  prefix + len);
+        replacement->setPrefix(prefix, newPrefixLen);
+        replacement->writeUnlock();
+      }
+
+      replaceChild(parent, parentPartialKey, replacement);
+      node->writeUnlockObsolete();
+      parent->writeUnlock();
+      value = asLeaf(next)->value;
+      retire(next);
+      retire(node);
+      return true;
+    }
+
+    if (!node->upgradeToWriteLock(version))
+      return false;
+    if (parent != nullptr && !parent->validate(parentVersion)) {
+      node->writeUnlock();
+      return false;
+    }
+
+    if (leafSlot)
+      node->leaf_ = nullptr;
+    else
+      inner->delChild(partialKey);
+    value = asLeaf(next)->value;
+    retire(next);
+
+    /* shrinking is only worth it as long as no one else holds the parent,
+     * the node stays valid either way and a later deletion shrinks it */
+    if (parent != nullptr && inner->isUnderfull() &&
+        parent->upgradeToWriteLock(parentVersion)) {
+      node->writeUnlockObsolete();
+      replaceChild(parent, parentPartialKey, inner->shrink(retiring_));
+      parent->writeUnlock();
+      return true;
+    }
+    node->writeUnlock();
+    return true;
+  }
+}
+
+template <typename T>
+const uint8_t *ConcurrentArt<T>::fullPrefix(Node<T> *node, uint64_t version,
+                                            int depth) const {
+  if (node->prefixLen_ <= Node<T>::maxPrefixLen)
+    return node->prefix_;
+
+  /* all leaves below the node share its prefix, take any of them */
+  bool restart = false;
+  const LeafNode<T> *leaf = minLeaf(node, version, restart);
+  if (leaf == nullptr || !node->validate(version))
+    return nullptr;
+  return leaf->key() + depth;
+}
+
+template <typename T>
+const LeafNode<T> *ConcurrentArt<T>::minLeaf(Node<T> *node, uint64_t version,
+                                             bool &restart) const {
+  while (!isLeaf(node)) {
+    auto inner = static_cast<innerNode<T> *>(node);
+    Node<T> *next = inner->leaf_;
+    if (next == nullptr && inner->nChildren() > 0) {
+      try {
+        Node<T> **child = inner->findChild(inner->nextPartialKey(0));
+        next = child != nullptr ? *child : nullptr;
+      } catch (const std::out_of_range &) {
+        /* a writer emptied the node while it was read */
+      }
+    }
+    if (!node->validate(version)) {
+      restart = true;
+      return nullptr;
+    }
+    /* only the root can be empty */
+    if (next == nullptr)
+      return nullptr;
+    if (!isLeaf(next) && !next->readLock(version)) {
+      restart = true;
+      return nullptr;
+    }
+    node = next;
+  }
+  return asLeaf(node);
+}
+
+template <typename T>
+const LeafNode<T> *
+ConcurrentArt<T>::successor(Node<T> *node, uint64_t version, int depth,
+                            const uint8_t *key, int keyLen,
+                            bool &restart) const {
+  auto inner = static_cast<innerNode<T> *>(node);
+  const uint8_t *prefix = fullPrefix(node, version, depth);
+  if (prefix == nullptr) {
+    restart = true;
+    return nullptr;
+  }
+
+  /* the whole subtree is either bigger or smaller than the key unless the
+   * key continues beyond the prefix */
+  int prefixLen = node->prefixLen_;
+  int cmpLen = std::min(prefixLen, keyLen - depth);
+  int cmp = cmpLen > 0 ? std::memcmp(prefix, key + depth, cmpLen) : 0;
+  if (!node->validate(version)) {
+    restart = true;
+    return nullptr;
+  }
+  if (cmp > 0 || (cmp == 0 && prefixLen > keyLen - depth))
+    return minLeaf(node, version, restart);
+  if (cmp < 0)
+    return nullptr;
+
+  /* the leaf slot holds a key not bigger than the given one */
+  depth += prefixLen;
+  int from = 0;
+  if (depth < keyLen) {
+    uint8_t partialKey = key[depth];
+    Node<T> **child = inner->findChild(partialKey);
+    Node<T> *next = child != nullptr ? *child : nullptr;
+    if (!node->validate(version)) {
+      restart = true;
+      return nullptr;
+    }
+    if (next != nullptr) {
+      if (isLeaf(next)) {
+        const LeafNode<T> *leaf = asLeaf(next);
+        if (std::lexicographical_compare(key, key + keyLen, leaf->key(),
+                                         leaf->key() + leaf->keyLen_))
+          return leaf;
+      } else {
+        uint64_t nextVersion;
+        if (!next->readLock(nextVersion) || !node->validate(version)) {
+          restart = true;
+          return nullptr;
+        }
+        const LeafNode<T> *leaf = successor(next, nextVersion, depth + 1,
+                                            key, keyLen, restart);
+        if (leaf != nullptr || restart)
+          return leaf;
+      }
+    }
+    if (partialKey == 255)
+      return nullptr;
+    from = partialKey + 1;
+  }
+
+  /* smallest leaf of the first child after the key */
+  Node<T> *next = nullptr;
+  try {
+    Node<T> **child = inner->findChild(inner->nextPartialKey(from));
+    next = child != nullptr ? *child : nullptr;
+  } catch (const std::out_of_range &) {
+    /* no child left */
+  }
+  if (!node->validate(version)) {
+    restart = true;
+    return nullptr;
+  }
+  if (next == nullptr)
+    return nullptr;
+  if (isLeaf(next))
+    return asLeaf(next);
+  uint64_t nextVersion;
+  if (!next->readLock(nextVersion) || !node->validate(version)) {
+    restart = true;
+    return nullptr;
+  }
+  return minLeaf(next, nextVersion, restart);
+}
+
+template <typename T>
+template <class Fn>
+void ConcurrentArt<T>::forEach(Fn fn) const {
+  std::vector<uint8_t> key;
+  bool first = true;
+  while (true) {
+    const LeafNode<T> *leaf = nullptr;
+    T value;
+    {
+      auto guard = epochs_.pin();
+      bool restart;
+      do {
+        restart = false;
+        uint64_t version;
+        if (!root_->readLock(version)) {
+          restart = true;
+          continue;
+        }
+        leaf = first ? minLeaf(root_, version, restart)
+                     : successor(root_, version, 0, key.data(), key.size(),
+                                 restart);
+      } while (restart);
+      if (leaf == nullptr)
+        return;
+      key.assign(leaf->key(), leaf->key() + leaf->keyLen_);
+      value = leaf->value;
+    }
+    /* the callback runs unpinned, it may take arbitrarily long */
+    first = false;
+    fn(std::string_view(reinterpret_cast<const char *>(key.data()),
+                        key.size()),
+       value);
+  }
+}
+
+template <typename T>
+Node<T> *ConcurrentArt<T>::newLeaf(const uint8_t *key, int keyLen, T value) {
+  return tagLeaf(new (allocator_.allocate(LeafNode<T>::size(keyLen)))
+                     LeafNode<T>(value, key, keyLen));
+}
+
+template <typename T>
+void ConcurrentArt<T>::replaceChild(Node<T> *parent, uint8_t partialKey,
+                                    Node<T> *node) {
+  *static_cast<innerNode<T> *>(parent)->findChild(partialKey) = node;
+}
+
+template <typename T> void ConcurrentArt<T>::retire(Node<T> *node) {
+  retire(node, isLeaf(node) ? asLeaf(node)->nodeSize() : node->nodeSize());
+}
+
+template <typename T>
+void ConcurrentArt<T>::retire(Node<T> *node, std::size_t size) {
+  epochs_.retire(node, size, reclaimNode, this);
+}
+
+template <typename T>
+void ConcurrentArt<T>::reclaimNode(void *tree, void *node, std::size_t size) {
+  auto &allocator = static_cast<ConcurrentArt<T> *>(tree)->allocator_;
+  if (isLeaf(static_cast<Node<T> *>(node))) {
+    LeafNode<T> *leaf = asLeaf(static_cast<Node<T> *>(node));
+    leaf->~LeafNode<T>();
+    allocator.deallocate(leaf, size);
+  } else {
+    /* inner nodes are trivially destructible, see Art::destroyNode() */
+    static_assert(std::is_trivially_destructible<Node256<T>>::value,
+                  "inner nodes are freed without being destructed");
+    allocator.deallocate(node, size);
+  }
+}
+
+} // namespace art
+
+#endif // !ART_CONCURRENT_ART_HPP
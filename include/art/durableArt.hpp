@@ -0,0 +1,674 @@
+#ifndef ART_DURABLE_ART_HPP
+#define ART_DURABLE_ART_HPP
+
+#include "art.hpp"
+#include "frozenArt.hpp"
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace art {
+
+/**
+ * Settings of the write-ahead log of a DurableArt.
+ */
+struct WalOptions {
+  /* whether set() and del() only return once their record is on disk */
+  bool syncCommit = true;
+
+  /* without syncCommit, the buffered records are written and synced once
+   * they take up this many bytes, or on sync() */
+  std::size_t syncBytes = 1 << 20;
+
+  /* log bytes after which a modification takes a checkpoint, 0 for none */
+  std::size_t checkpointBytes = 64 << 20;
+};
+
+/**
+ * Art whose modifications survive a crash, for any number of threads.
+ *
+ * set() and del() modify the tree and append a checksummed record to a
+ * write-ahead log. With syncCommit, they wait for their record to be
+ * written and synced with fdatasync(). The writers waiting at the same time
+ * share that work through group commit: one of them writes the records
+ * buffered by all of them and syncs the log once, while the others wait for
+ * it. Without syncCommit, the records are synced in batches of syncBytes,
+ * and a crash loses at most the last batch.
+ *
+ * checkpoint() takes a snapshot of the tree, switches the log to a new
+ * segment and writes the snapshot as a frozen image, see Art::freeze(),
+ * while the tree keeps being modified. The log segments the checkpoint
+ * covers are deleted once the image is on disk. Opening the tree loads the
+ * last checkpoint through bulkLoad() and replays the log segments written
+ * since, up to the first torn or corrupt record.
+ *
+ * Once writing or syncing the log fails, the log no longer holds all of the
+ * modifications made to the tree: set(), del(), sync() and checkpoint()
+ * throw std::system_error from then on, and the tree has to be reopened,
+ * which recovers the modifications whose records reached the disk.
+ *
+ * The files are the checkpoint at path + ".checkpoint" and the log segments
+ * at path + ".wal." followed by their number. T must be trivially copyable.
+ *
+ *   art::DurableArt<uint64_t> index("index");
+ *   index.set(key, row);
+ */
+template <typename T> class DurableArt {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "logged values are stored byte by byte");
+
+public:
+  /**
+   * Opens the tree stored at the given path, recovering it from its last
+   * checkpoint and log, or creates it.
+   */
+  explicit DurableArt(const char *path, WalOptions options = WalOptions());
+  DurableArt(const DurableArt &other) = delete;
+  DurableArt &operator=(const DurableArt &other) = delete;
+
+  /**
+   * Syncs the log and closes it.
+   */
+  ~DurableArt();
+
+  /**
+   * Finds the value associated with the given key.
+   *
+   * @param key - The key to find.
+   * @param keyLen - The length of the key in bytes.
+   * @return the value associated with the key or a default constructed value.
+   */
+  T get(const uint8_t *key, std::size_t keyLen) const;
+  T get(std::string_view key) const;
+  T get(const char *key) const;
+
+  /**
+   * Associates the given key with the given value and logs it.
+   *
+   * @param key - The key to associate with the value.
+   * @param keyLen - The length of the key in bytes.
+   * @param value - The value to be associated with the key.
+   * @return the previously associated value or a default constructed value.
+   */
+  T set(const uint8_t *key, std::size_t keyLen, T value);
+  T set(std::string_view key, T value);
+  T set(const char *key, T value);
+
+  /**
+   * Deletes the given key and logs it.
+   *
+   * @param key - The key to delete.
+   * @param keyLen - The length of the key in bytes.
+   * @return the value associated with the key or a default constructed value.
+   */
+  T del(const uint8_t *key, std::size_t keyLen);
+  T del(std::string_view key);
+  T del(const char *key);
+
+  /**
+   * Immutable point-in-time version of the tree, to iterate it while it is
+   * being modified, see Art::snapshot().
+   */
+  typename Art<T>::Snapshot snapshot();
+
+  /**
+   * Writes and syncs the records of all modifications so far.
+   */
+  void sync();
+
+  /**
+   * Writes a checkpoint of the current version of the tree and deletes the
+   * log segments it covers.
+   */
+  void checkpoint();
+
+private:
+  enum : uint8_t { setRecord = 1, delRecord = 2 };
+
+  enum replayResult { segmentMissing, segmentComplete, logEnd };
+
+  /* records are made of the checksum of the rest of the record, the key
+   * length, the log sequence number, the type, the key and for set records
+   * the value */
+  static constexpr std::size_t recordHeaderSize = 17;
+
+  /* start of the checkpoint file, followed by a frozen image */
+  struct checkpointHeader {
+    char magic[8];
+    uint64_t lsn;
+    uint64_t firstSegment;
+  };
+
+  static constexpr char checkpointMagic[8] = {'A', 'R', 'T', 'C',
+                                              'K', 'P', 'T', '1'};
+
+  /**
+   * CRC-32C of the given bytes.
+   */
+  static uint32_t crc32c(const char *data, std::size_t size);
+
+  static void writeAll(int fd, const char *data, std::size_t size);
+
+  std::string segmentPath(uint64_t segment) const;
+
+  /**
+   * Loads the checkpoint and replays the log.
+   */
+  void recover();
+
+  /**
+   * Applies the records of the given segment to the tree. The log ends
+   * with the first torn or corrupt record, or the first record whose log
+   * sequence number does not follow the previous one, and the segment is
+   * truncated before it.
+   *
+   * @return whether the segment exists and the log may go on in the next.
+   */
+  replayResult replay(uint64_t segment);
+
+  /**
+   * Creates the given segment and appends to it from then on, closing the
+   * current one. If creating it fails, the current one stays open.
+   */
+  void openSegment(uint64_t segment);
+
+  /**
+   * Syncs the directory holding the tree's files after entries were added
+   * to or removed from it.
+   */
+  void syncDirectory() const;
+
+  /**
+   * Throws std::system_error if writing or syncing the log failed before.
+   */
+  void checkFailed() const;
+
+  /**
+   * Appends a record to the buffer, the tree must be locked.
+   *
+   * @return the record's log sequence number.
+   */
+  uint64_t append(uint8_t type, const uint8_t *key, std::size_t keyLen,
+                  const T *value);
+
+  /**
+   * Makes the record with the given log sequence number durable as
+   * configured and takes a checkpoint if the log has grown big enough.
+   */
+  void commit(uint64_t lsn);
+
+  /**
+   * Waits until the records up to the given log sequence number are synced,
+   * writing and syncing the buffered records unless another thread does.
+   */
+  void flush(uint64_t lsn);
+
+  std::string path_;
+  WalOptions options_;
+
+  Art<T> tree_;
+  mutable std::shared_mutex treeMutex_;
+
+  /* records not written yet, guarded by treeMutex_ */
+  std::string buffer_;
+  uint64_t lastLsn_ = 0;
+  std::atomic<std::size_t> bufferedBytes_{0};
+  std::atomic<std::size_t> logBytes_{0};
+
+  /* group commit: the writer that syncs the log, if any, swaps the buffer
+   * with writing_ and writes it to the current segment */
+  std::mutex syncMutex_;
+  std::condition_variable synced_;
+  bool syncing_ = false;
+  uint64_t durableLsn_ = 0;
+  std::string writing_;
+  /* error that made the log lose records, or 0 */
+  std::atomic<int> failed_{0};
+  int fd_ = -1;
+  uint64_t segment_ = 0;
+
+  /* oldest segment still on disk */
+  uint64_t firstSegment_ = 0;
+  std::mutex checkpointMutex_;
+};
+
+template <typename T>
+DurableArt<T>::DurableArt(const char *path, WalOptions options)
+    : path_(path), options_(options) {
+  recover();
+}
+
+template <typename T> DurableArt<T>::~DurableArt() {
+  try {
+    sync();
+  } catch (...) {
+    /* the records that were not synced are lost, as in a crash */
+  }
+  ::close(fd_);
+}
+
+template <typename T>
+uint32_t DurableArt<T>::crc32c(const char *data, std::size_t size) {
+  static const std::array<uint32_t, 256> table = [] {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t crc = i;
+      for (int bit = 0; bit < 8; ++bit)
+        crc = crc & 1 ? (crc >> 1) ^ 0x82f63b78 : crc >> 1;
+      table[i] = crc;
+    }
+    return table;
+  }();
+  uint32_t crc = ~0u;
+  for (std::size_t i = 0; i < size; ++i)
+    crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xff] ^ (crc >> 8);
+  return ~crc;
+}
+
+template <typename T>
+void DurableArt<T>::writeAll(int fd, const char *data, std::size_t size) {
+  while (size > 0) {
+    ssize_t written = ::write(fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      throw std::system_error(errno, std::generic_category(), "write");
+    }
+    data += written;
+    size -= written;
+  }
+}
+
+template <typename T>
+std::string DurableArt<T>::segmentPath(uint64_t segment) const {
+  return path_ + ".wal." + std::to_string(segment);
+}
+
+template <typename T> void DurableArt<T>::recover() {
+  uint64_t fromLsn = 0;
+  uint64_t segment = 0;
+  std::ifstream file(path_ + ".checkpoint", std::ios::binary);
+  if (file) {
+    std::vector<char> data((std::istreambuf_iterator<char>(file)),
+                           std::istreambuf_iterator<char>());
+    checkpointHeader h;
+    if (data.size() < sizeof(h))
+      throw std::invalid_argument("not a checkpoint of a durable tree");
+    std::memcpy(&h, data.data(), sizeof(h));
+    if (std::memcmp(h.magic, checkpointMagic, sizeof(checkpointMagic)) != 0)
+      throw std::invalid_argument("not a checkpoint of a durable tree");
+    fromLsn = h.lsn;
+    segment = h.firstSegment;
+
+    FrozenArt<T> frozen(std::vector<char>(data.begin() + sizeof(h),
+                                          data.end()));
+    std::vector<std::pair<std::string, T>> entries;
+    entries.reserve(frozen.size());
+    for (auto it = frozen.begin(), itEnd = frozen.end(); it != itEnd; ++it)
+      entries.emplace_back(it.key(), *it);
+    tree_.bulkLoad(entries.begin(), entries.end());
+  }
+  file.close();
+
+  /* segments a checkpoint covers may be left over by a crash */
+  for (uint64_t s = segment; s-- > 0;) {
+    if (std::remove(segmentPath(s).c_str()) != 0)
+      break;
+  }
+
+  firstSegment_ = segment;
+  lastLsn_ = fromLsn;
+  for (replayResult result; (result = replay(segment)) != segmentMissing;) {
+    ++segment;
+    if (result == logEnd) {
+      /* segments after the end of the log follow a gap in it */
+      for (uint64_t s = segment;
+           std::remove(segmentPath(s).c_str()) == 0; ++s) {
+      }
+      break;
+    }
+  }
+  durableLsn_ = lastLsn_;
+  openSegment(segment);
+}
+
+template <typename T>
+typename DurableArt<T>::replayResult DurableArt<T>::replay(uint64_t segment) {
+  std::ifstream file(segmentPath(segment), std::ios::binary);
+  if (!file)
+    return segmentMissing;
+  std::string data((std::istreambuf_iterator<char>(file)),
+                   std::istreambuf_iterator<char>());
+
+  std::size_t pos = 0;
+  while (data.size() - pos >= recordHeaderSize) {
+    const char *record = data.data() + pos;
+    uint32_t checksum, keyLen;
+    uint64_t lsn;
+    uint8_t type;
+    std::memcpy(&checksum, record, 4);
+    std::memcpy(&keyLen, record + 4, 4);
+    std::memcpy(&lsn, record + 8, 8);
+    std::memcpy(&type, record + 16, 1);
+    std::size_t size =
+        recordHeaderSize + keyLen + (type == setRecord ? sizeof(T) : 0);
+    /* the log ends with the first torn or corrupt record, the segments
+     * after a checkpoint start right after its log sequence number */
+    if ((type != setRecord && type != delRecord) ||
+        size > data.size() - pos ||
+        crc32c(record + 4, size - 4) != checksum || lsn != lastLsn_ + 1)
+      break;
+
+    const auto *key =
+        reinterpret_cast<const uint8_t *>(record + recordHeaderSize);
+    if (type == setRecord) {
+      T value;
+      std::memcpy(&value, record + recordHeaderSize + keyLen, sizeof(T));
+      tree_.set(key, keyLen, value);
+    } else {
+      tree_.del(key, keyLen);
+    }
+    lastLsn_ = lsn;
+    logBytes_ += size;
+    pos += size;
+  }
+  if (pos == data.size())
+    return segmentComplete;
+
+  /* the records appended after reopening go to the next segment, which
+   * must not follow the rest of this one */
+  std::string path = segmentPath(segment);
+  int fd = ::open(path.c_str(), O_WRONLY);
+  if (fd < 0)
+    throw std::system_error(errno, std::generic_category(), path);
+  int error = 0;
+  if (::ftruncate(fd, pos) != 0 || ::fsync(fd) != 0)
+    error = errno;
+  ::close(fd);
+  if (error != 0)
+    throw std::system_error(error, std::generic_category(), path);
+  return logEnd;
+}
+
+template <typename T> void DurableArt<T>::openSegment(uint64_t segment) {
+  int fd = ::open(segmentPath(segment).c_str(),
+                  O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+  if (fd < 0)
+    throw std::system_error(errno, std::generic_category(),
+                            segmentPath(segment));
+  try {
+    syncDirectory();
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+  if (fd_ >= 0)
+    ::close(fd_);
+  fd_ = fd;
+  segment_ = segment;
+}
+
+template <typename T> void DurableArt<T>::syncDirectory() const {
+  std::size_t slash = path_.rfind('/');
+  std::string dir = slash == std::string::npos ? "." : path_.substr(0, slash);
+  int fd = ::open(dir.empty() ? "/" : dir.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::system_error(errno, std::generic_category(), dir);
+  int result = ::fsync(fd);
+  int error = errno;
+  ::close(fd);
+  if (result != 0)
+    throw std::system_error(error, std::generic_category(), dir);
+}
+
+template <typename T> void DurableArt<T>::checkFailed() const {
+  if (int error = failed_.load())
+    throw std::system_error(error, std::generic_category(), "wal");
+}
+
+template <typename T>
+uint64_t DurableArt<T>::append(uint8_t type, const uint8_t *key,
+                               std::size_t keyLen, const T *value) {
+  uint64_t lsn = ++lastLsn_;
+  uint32_t len = keyLen;
+  std::size_t start = buffer_.size();
+  std::size_t size = recordHeaderSize + keyLen + (value ? sizeof(T) : 0);
+  buffer_.resize(start + size);
+  char *record = &buffer_[start];
+  std::memcpy(record + 4, &len, 4);
+  std::memcpy(record + 8, &lsn, 8);
+  std::memcpy(record + 16, &type, 1);
+  std::memcpy(record + recordHeaderSize, key, keyLen);
+  if (value != nullptr)
+    std::memcpy(record + recordHeaderSize + keyLen, value, sizeof(T));
+  uint32_t checksum = crc32c(record + 4, size - 4);
+  std::memcpy(record, &checksum, 4);
+  bufferedBytes_.store(buffer_.size(), std::memory_order_relaxed);
+  logBytes_.fetch_add(size, std::memory_order_relaxed);
+  return lsn;
+}
+
+template <typename T> void DurableArt<T>::commit(uint64_t lsn) {
+  if (options_.syncCommit ||
+      bufferedBytes_.load(std::memory_order_relaxed) >= options_.syncBytes)
+    flush(lsn);
+  if (options_.checkpointBytes != 0 &&
+      logBytes_.load(std::memory_order_relaxed) >= options_.checkpointBytes) {
+    /* one of the writers takes it, the others go on */
+    std::unique_lock<std::mutex> lock(checkpointMutex_, std::try_to_lock);
+    if (lock.owns_lock() &&
+        logBytes_.load(std::memory_order_relaxed) >= options_.checkpointBytes) {
+      lock.unlock();
+      checkpoint();
+    }
+  }
+}
+
+template <typename T> void DurableArt<T>::flush(uint64_t lsn) {
+  std::unique_lock<std::mutex> lock(syncMutex_);
+  while (durableLsn_ < lsn) {
+    checkFailed();
+    if (syncing_) {
+      synced_.wait(lock);
+      continue;
+    }
+
+    /* write the records of all waiting writers at once */
+    syncing_ = true;
+    uint64_t upTo;
+    {
+      std::unique_lock<std::shared_mutex> treeLock(treeMutex_);
+      writing_.clear();
+      writing_.swap(buffer_);
+      bufferedBytes_.store(0, std::memory_order_relaxed);
+      upTo = lastLsn_;
+    }
+    lock.unlock();
+    int error = 0;
+    try {
+      writeAll(fd_, writing_.data(), writing_.size());
+      if (::fdatasync(fd_) != 0)
+        error = errno;
+    } catch (const std::system_error &e) {
+      error = e.code().value();
+    }
+    lock.lock();
+    syncing_ = false;
+    if (error == 0) {
+      durableLsn_ = upTo;
+    } else {
+      /* the records may be partly written, the log can't go on without
+       * leaving them out */
+      failed_.store(error);
+    }
+    synced_.notify_all();
+    checkFailed();
+  }
+}
+
+template <typename T>
+T DurableArt<T>::get(const uint8_t *key, std::size_t keyLen) const {
+  std::shared_lock<std::shared_mutex> lock(treeMutex_);
+  return tree_.get(key, keyLen);
+}
+
+template <typename T> T DurableArt<T>::get(std::string_view key) const {
+  return get(reinterpret_cast<const uint8_t *>(key.data()), key.size());
+}
+
+template <typename T> T DurableArt<T>::get(const char *key) const {
+  return get(std::string_view(key));
+}
+
+template <typename T>
+T DurableArt<T>::set(const uint8_t *key, std::size_t keyLen, T value) {
+  T oldValue;
+  uint64_t lsn;
+  {
+    std::unique_lock<std::shared_mutex> lock(treeMutex_);
+    checkFailed();
+    oldValue = tree_.set(key, keyLen, value);
+    lsn = append(setRecord, key, keyLen, &value);
+  }
+  commit(lsn);
+  return oldValue;
+}
+
+template <typename T> T DurableArt<T>::set(std::string_view key, T value) {
+  return set(reinterpret_cast<const uint8_t *>(key.data()), key.size(),
+             value);
+}
+
+template <typename T> T DurableArt<T>::set(const char *key, T value) {
+  return set(std::string_view(key), value);
+}
+
+template <typename T>
+T DurableArt<T>::del(const uint8_t *key, std::size_t keyLen) {
+  T oldValue;
+  uint64_t lsn;
+  {
+    std::unique_lock<std::shared_mutex> lock(treeMutex_);
+    checkFailed();
+    oldValue = tree_.del(key, keyLen);
+    lsn = append(delRecord, key, keyLen, nullptr);
+  }
+  commit(lsn);
+  return oldValue;
+}
+
+template <typename T> T DurableArt<T>::del(std::string_view key) {
+  return del(reinterpret_cast<const uint8_t *>(key.data()), key.size());
+}
+
+template <typename T> T DurableArt<T>::del(const char *key) {
+  return del(std::string_view(key));
+}
+
+template <typename T> typename Art<T>::Snapshot DurableArt<T>::snapshot() {
+  std::unique_lock<std::shared_mutex> lock(treeMutex_);
+  return tree_.snapshot();
+}
+
+template <typename T> void DurableArt<T>::sync() {
+  uint64_t lsn;
+  {
+    std::shared_lock<std::shared_mutex> lock(treeMutex_);
+    lsn = lastLsn_;
+  }
+  flush(lsn);
+}
+
+template <typename T> void DurableArt<T>::checkpoint() {
+  std::lock_guard<std::mutex> checkpointLock(checkpointMutex_);
+  std::optional<typename Art<T>::Snapshot> snapshot;
+  uint64_t lsn;
+  uint64_t oldSegment;
+  {
+    /* the records up to the snapshot go to the current segment, the
+     * following ones to a new one */
+    std::unique_lock<std::mutex> lock(syncMutex_);
+    synced_.wait(lock, [this] { return !syncing_; });
+    std::unique_lock<std::shared_mutex> treeLock(treeMutex_);
+    checkFailed();
+    int error = 0;
+    try {
+      writeAll(fd_, buffer_.data(), buffer_.size());
+      if (::fdatasync(fd_) != 0)
+        error = errno;
+    } catch (const std::system_error &e) {
+      error = e.code().value();
+    }
+    if (error != 0) {
+      failed_.store(error);
+      checkFailed();
+    }
+    buffer_.clear();
+    bufferedBytes_.store(0, std::memory_order_relaxed);
+    lsn = durableLsn_ = lastLsn_;
+    /* the log goes on in the current segment if the new one can't be
+     * created */
+    oldSegment = segment_;
+    openSegment(segment_ + 1);
+    logBytes_.store(0, std::memory_order_relaxed);
+    snapshot.emplace(tree_.snapshot());
+  }
+  synced_.notify_all();
+
+  /* the tree is only read through the snapshot from here on */
+  std::vector<char> image = snapshot->freeze();
+  snapshot.reset();
+  checkpointHeader h{};
+  std::memcpy(h.magic, checkpointMagic, sizeof(checkpointMagic));
+  h.lsn = lsn;
+  h.firstSegment = oldSegment + 1;
+
+  std::string checkpointPath = path_ + ".checkpoint";
+  std::string tmpPath = checkpointPath + ".tmp";
+  int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    throw std::system_error(errno, std::generic_category(), tmpPath);
+  int error = 0;
+  try {
+    writeAll(fd, reinterpret_cast<const char *>(&h), sizeof(h));
+    writeAll(fd, image.data(), image.size());
+    if (::fsync(fd) != 0)
+      error = errno;
+  } catch (const std::system_error &e) {
+    error = e.code().value();
+  }
+  ::close(fd);
+  if (error == 0 && std::rename(tmpPath.c_str(), checkpointPath.c_str()) != 0)
+    error = errno;
+  if (error != 0) {
+    std::remove(tmpPath.c_str());
+    throw std::system_error(error, std::generic_category(), checkpointPath);
+  }
+  syncDirectory();
+
+  for (; firstSegment_ <= oldSegment; ++firstSegment_)
+    std::remove(segmentPath(firstSegment_).c_str());
+}
+
+} // namespace art
+
+#endif // !ART_DURABLE_ART_HPP
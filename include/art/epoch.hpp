@@ -0,0 +1,234 @@
+#ifndef ART_EPOCH_HPP
+#define ART_EPOCH_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <thread>
+
+namespace art {
+
+/**
+ * Epoch-based reclamation of memory that lock-free readers may still be
+ * reading.
+ *
+ * Every thread pins the manager for the duration of an operation on the
+ * shared structure, which publishes the global epoch it observed. Memory
+ * removed from the structure is retired onto the calling thread's limbo
+ * list instead of being freed, tagged with the global epoch read after it
+ * was unlinked. The global epoch only advances once every pinned thread has
+ * observed it: a thread that could still reach a block retired with tag e
+ * is pinned to an epoch of at most e, so the global epoch can't reach
+ * e + 2 before that thread unpins. The retiring thread reclaims the block
+ * the next time it pins once the global epoch is at least e + 2.
+ *
+ *   auto guard = epochs.pin();
+ *   ... unlink node ...
+ *   epochs.retire(node, size, reclaimNode, tree);
+ *
+ * Memory retired by a thread that never pins again, as well as everything
+ * else still in limbo, is reclaimed by release() or the destructor.
+ */
+class EpochManager {
+public:
+  /**
+   * Frees the given retired block, owner is the pointer passed to retire().
+   */
+  using reclaimFn = void (*)(void *owner, void *p, std::size_t size);
+
+  /**
+   * Keeps the calling thread pinned while alive. Guards may be nested.
+   */
+  class guard {
+  public:
+    explicit guard(EpochManager *manager);
+    guard(guard &&other) noexcept;
+    guard(const guard &other) = delete;
+    guard &operator=(const guard &other) = delete;
+    ~guard();
+
+  private:
+    EpochManager *manager_;
+  };
+
+  EpochManager();
+  EpochManager(const EpochManager &other) = delete;
+  EpochManager &operator=(const EpochManager &other) = delete;
+  ~EpochManager();
+
+  /**
+   * Pins the calling thread to the current epoch.
+   */
+  guard pin();
+
+  /**
+   * Defers reclaiming a block removed from the shared structure until no
+   * pinned thread can reach it any more. The calling thread must be pinned.
+   */
+  void retire(void *p, std::size_t size, reclaimFn reclaim, void *owner);
+
+  /**
+   * Reclaims everything in limbo right away. No thread may be pinned.
+   */
+  void release();
+
+  /* retirements between two attempts to advance the global epoch */
+  static constexpr std::size_t advanceInterval = 64;
+
+private:
+  struct retired {
+    void *p;
+    std::size_t size;
+    reclaimFn reclaim;
+    void *owner;
+    /* global epoch when the block was retired */
+    uint64_t epoch;
+  };
+
+  /* per-thread state, only written by its thread except for epoch */
+  struct alignas(64) participant {
+    /* epoch the thread is pinned to, 0 while not pinned */
+    std::atomic<uint64_t> epoch{0};
+    int nesting = 0;
+    std::size_t nRetired = 0;
+    /* retired blocks in the order of their epochs */
+    std::deque<retired> limbo;
+    std::thread::id owner;
+    participant *next = nullptr;
+  };
+
+  participant &local();
+  void enter(participant &p);
+  void exit(participant &p);
+  void tryAdvance();
+  /**
+   * Reclaims the blocks retired before the given epoch, all of them by
+   * default.
+   */
+  static void reclaim(std::deque<retired> &limbo,
+                      uint64_t before = UINT64_MAX);
+
+  /* distinguishes managers in the threads' caches */
+  uint64_t id_;
+  std::atomic<uint64_t> epoch_{1};
+  std::atomic<participant *> participants_{nullptr};
+};
+
+inline EpochManager::guard::guard(EpochManager *manager)
+    : manager_(manager) {
+  manager_->enter(manager_->local());
+}
+
+inline EpochManager::guard::guard(guard &&other) noexcept
+    : manager_(other.manager_) {
+  other.manager_ = nullptr;
+}
+
+inline EpochManager::guard::~guard() {
+  if (manager_ != nullptr)
+    manager_->exit(manager_->local());
+}
+
+inline EpochManager::EpochManager() {
+  static std::atomic<uint64_t> nManagers{0};
+  id_ = ++nManagers;
+}
+
+inline EpochManager::~EpochManager() {
+  release();
+  participant *p = participants_.load();
+  while (p != nullptr) {
+    participant *next = p->next;
+    delete p;
+    p = next;
+  }
+}
+
+inline EpochManager::guard EpochManager::pin() { return guard(this); }
+
+inline void EpochManager::retire(void *p, std::size_t size,
+                                 reclaimFn reclaim, void *owner) {
+  participant &self = local();
+  /* the block is unlinked, threads pinned later on can't reach it */
+  self.limbo.push_back({p, size, reclaim, owner, epoch_.load()});
+  if (++self.nRetired % advanceInterval == 0)
+    tryAdvance();
+}
+
+inline void EpochManager::release() {
+  for (participant *p = participants_.load(); p != nullptr; p = p->next)
+    reclaim(p->limbo);
+}
+
+inline EpochManager::participant &EpochManager::local() {
+  /* a thread mostly works on a single structure at a time */
+  thread_local struct {
+    uint64_t id = 0;
+    participant *p = nullptr;
+  } cache;
+  if (cache.id == id_)
+    return *cache.p;
+
+  std::thread::id self = std::this_thread::get_id();
+  participant *p = participants_.load(std::memory_order_acquire);
+  while (p != nullptr && p->owner != self)
+    p = p->next;
+  if (p == nullptr) {
+    p = new participant;
+    p->owner = self;
+    p->next = participants_.load(std::memory_order_relaxed);
+    while (!participants_.compare_exchange_weak(p->next, p,
+                                                std::memory_order_release)) {
+    }
+  }
+  cache.id = id_;
+  cache.p = p;
+  return *p;
+}
+
+inline void EpochManager::enter(participant &p) {
+  if (p.nesting++ > 0)
+    return;
+
+  /* the epoch must be published before the structure is read, and must
+   * not have advanced twice in the meantime */
+  uint64_t epoch = epoch_.load();
+  p.epoch.store(epoch);
+  while (epoch_.load() != epoch) {
+    epoch = epoch_.load();
+    p.epoch.store(epoch);
+  }
+
+  /* blocks retired at least two epochs ago are unreachable */
+  reclaim(p.limbo, epoch - 1);
+}
+
+inline void EpochManager::exit(participant &p) {
+  if (--p.nesting == 0)
+    p.epoch.store(0, std::memory_order_release);
+}
+
+inline void EpochManager::tryAdvance() {
+  uint64_t epoch = epoch_.load();
+  for (participant *p = participants_.load(std::memory_order_acquire);
+       p != nullptr; p = p->next) {
+    uint64_t observed = p->epoch.load();
+    if (observed != 0 && observed != epoch)
+      return;
+  }
+  epoch_.compare_exchange_strong(epoch, epoch + 1);
+}
+
+inline void EpochManager::reclaim(std::deque<retired> &limbo,
+                                  uint64_t before) {
+  while (!limbo.empty() && limbo.front().epoch < before) {
+    retired r = limbo.front();
+    limbo.pop_front();
+    r.reclaim(r.owner, r.p, r.size);
+  }
+}
+
+} // namespace art
+
+#endif // !ART_EPOCH_HPP
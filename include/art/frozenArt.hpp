@@ -0,0 +1,785 @@
+#ifndef ART_FROZEN_ART_HPP
+#define ART_FROZEN_ART_HPP
+
+#include "innerNode.hpp"
+#include "leafNode.hpp"
+#include "node.hpp"
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace art {
+
+template <typename T, class Allocator> class Art;
+
+/**
+ * Read-only adaptive radix tree served from a single contiguous image, as
+ * written by Art::freeze().
+ *
+ * The image holds no pointers: nodes and leaves refer to each other by
+ * their offset in the image, so that it can be written to a file and mapped
+ * by any number of processes, which share its pages. Opening a mapped image
+ * takes O(1); pages are read in as lookups touch them.
+ *
+ * Nodes are laid out depth-first, every node followed by its subtrees in
+ * key order, and hold their prefix in full. Depending on its number of
+ * children, a node stores either their sorted partial keys, an index from
+ * every partial key to the child's position, or a slot per partial key,
+ * and only the children it actually has. Leaves hold the value and the part
+ * of the key below their slot.
+ *
+ * Values are copied into the image byte by byte, so T must be trivially
+ * copyable; pointers are only meaningful to the process that froze the
+ * tree. The image uses the byte order of the machine that wrote it and is
+ * trusted: only its header is checked when it is opened.
+ *
+ *   tree.freeze("index.art");
+ *   ...
+ *   art::FrozenArt<uint64_t> index("index.art");
+ *   uint64_t row = index.get(key);
+ */
+template <typename T> class FrozenArt {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "frozen values are copied byte by byte");
+  static_assert(alignof(T) <= 8, "frozen values are aligned on 8 bytes");
+
+public:
+  class iterator;
+
+  /**
+   * Serves the given image, e.g. the one returned by Art::freeze().
+   */
+  explicit FrozenArt(std::vector<char> image);
+
+  /**
+   * Maps the image stored in the file at the given path.
+   */
+  explicit FrozenArt(const char *path);
+
+  FrozenArt(FrozenArt &&other) noexcept;
+  FrozenArt &operator=(FrozenArt &&other) noexcept;
+  ~FrozenArt();
+
+  /**
+   * Finds the value associated with the given key.
+   *
+   * @param key - The key to find.
+   * @param keyLen - The length of the key in bytes.
+   * @return the value associated with the key or a default constructed value.
+   */
+  T get(const uint8_t *key, std::size_t keyLen) const;
+  T get(std::string_view key) const;
+  T get(const char *key) const;
+
+  /**
+   * Number of keys in the tree.
+   */
+  std::size_t size() const;
+
+  /**
+   * Forward iterator that traverses the tree in lexicographic order,
+   * optionally starting from the provided key.
+   */
+  iterator begin() const;
+  iterator begin(const uint8_t *key, std::size_t keyLen) const;
+  iterator begin(std::string_view key) const;
+  iterator begin(const char *key) const;
+
+  /**
+   * Iterator to the end of the lexicographic order.
+   */
+  iterator end() const;
+
+  /**
+   * Calls fn(std::string_view key, const T &value) for the keys in [lo, hi)
+   * in lexicographic order until it returns false. The key view is only
+   * valid during the call.
+   *
+   * @return false if fn returned false.
+   */
+  template <class Fn>
+  bool scan(std::string_view lo, std::string_view hi, Fn fn) const;
+
+  /**
+   * Calls fn(std::string_view key, const T &value) for the keys starting
+   * with the given prefix in lexicographic order until it returns false,
+   * see scan().
+   *
+   * @return false if fn returned false.
+   */
+  template <class Fn> bool scanPrefix(std::string_view prefix, Fn fn) const;
+
+private:
+  template <typename, class> friend class Art;
+
+  /* start of an image, followed by the root's subtree */
+  struct header {
+    char magic[8];
+    uint32_t version;
+    uint32_t valueSize;
+    uint64_t nKeys;
+    uint64_t root;
+    uint64_t size;
+  };
+
+  /* start of a node, followed by its prefix padded to 8 bytes, its leaf
+   * slot if taken, its partial keys or index and its child references */
+  struct nodeHeader {
+    uint8_t type;
+    uint8_t hasLeaf;
+    uint16_t nChildren;
+    uint32_t prefixLen;
+  };
+
+  /* node encodings: sparse nodes store the sorted partial keys of their
+   * children, indexed nodes the position + 1 of the child of every partial
+   * key, or 0, and dense nodes a reference per partial key, or 0 */
+  enum : uint8_t { sparseNode, indexedNode, denseNode };
+  static constexpr int sparseMax = 16;
+
+  /* references are offsets in the image, leaves are tagged with the lowest
+   * bit and 0 refers to nothing */
+  static constexpr uint64_t leafTag = 1;
+
+  /* leaves start with the length of the rest of their key, followed by the
+   * value and the key bytes */
+  static constexpr std::size_t valueOffset = 8;
+
+  static constexpr char magic[8] = {'A', 'R', 'T', 'F', 'R', 'O', 'Z', 'N'};
+  static constexpr uint32_t formatVersion = 1;
+
+  /* positions of a node's entries, see firstChild() */
+  static constexpr int leafSlot = -1;
+  static constexpr int noChild = 256;
+
+  /* decoded node */
+  struct nodeView {
+    uint8_t type;
+    bool hasLeaf;
+    int nChildren;
+    uint32_t prefixLen;
+    const uint8_t *prefix;
+    uint64_t leaf;
+    const uint8_t *keys;
+    const char *refs;
+  };
+
+  static constexpr std::size_t padded(std::size_t size) {
+    return (size + 7) & ~std::size_t(7);
+  }
+
+  /**
+   * Serializes the tree rooted in the given node into an image.
+   */
+  static std::vector<char> write(Node<T> *root);
+
+  /**
+   * Appends the subtree rooted in the given node to the image. The path
+   * holds the key bytes leading to the node.
+   *
+   * @return the reference to the subtree.
+   */
+  static uint64_t writeNode(std::vector<char> &image, Node<T> *node,
+                            std::string &path, uint64_t &nKeys);
+
+  /**
+   * Checks the image's header and reads the root.
+   */
+  void open();
+
+  nodeView view(uint64_t node) const;
+
+  /**
+   * Position of the first child whose partial key is at least from, or
+   * noChild. Positions are indices of the partial keys in sparse nodes and
+   * partial keys in the other nodes; the leaf slot is at leafSlot.
+   */
+  static int firstChild(const nodeView &node, int from);
+  static int nextChild(const nodeView &node, int pos);
+  static uint8_t partialKey(const nodeView &node, int pos);
+  static uint64_t child(const nodeView &node, int pos);
+  static uint64_t findChild(const nodeView &node, uint8_t partialKey);
+  static uint64_t ref(const nodeView &node, int i);
+
+  T value(uint64_t leaf) const;
+
+  /**
+   * Bytes of the leaf's key below the slot it is stored in.
+   */
+  std::string_view suffix(uint64_t leaf) const;
+
+  std::vector<char> image_;
+  const char *data_ = nullptr;
+  std::size_t size_ = 0;
+  bool mapped_ = false;
+  uint64_t root_ = 0;
+  uint64_t nKeys_ = 0;
+};
+
+/**
+ * Forward iterator on the keys of a FrozenArt in lexicographic order. Like
+ * treeIt, it keeps the nodes on the path to the current leaf in a stack of
+ * frames and the key bytes of that path in a single buffer.
+ */
+template <typename T> class FrozenArt<T>::iterator {
+public:
+  using iterator_category = std::forward_iterator_tag;
+  using value_type = T;
+  using difference_type = int;
+  using pointer = const value_type *;
+  using reference = value_type;
+
+  value_type operator*() const;
+  iterator &operator++();
+  iterator operator++(int);
+  bool operator==(const iterator &rhs) const;
+  bool operator!=(const iterator &rhs) const;
+
+  /**
+   * Key of the current leaf. The view refers to the iterator's key buffer
+   * and is valid until the iterator moves.
+   */
+  std::string_view key() const;
+
+private:
+  friend class FrozenArt;
+
+  /* node on the path to the current leaf, the key buffer holds depth bytes
+   * before its prefix */
+  struct frame {
+    uint64_t node;
+    int pos;
+    uint32_t depth;
+  };
+
+  explicit iterator(const FrozenArt *tree);
+
+  /**
+   * Moves to the smallest leaf of the given subtree, whose path the key
+   * buffer holds.
+   */
+  void descendMin(uint64_t ref);
+
+  /**
+   * Moves to the smallest leaf after the current child of the top frame.
+   */
+  void advance();
+
+  /**
+   * Moves to the smallest leaf whose key is at least the given key.
+   */
+  void seek(const uint8_t *key, std::size_t keyLen);
+
+  const FrozenArt *tree_;
+  /* current leaf, 0 at the end */
+  uint64_t leaf_ = 0;
+  std::vector<frame> frames_;
+  std::string key_;
+};
+
+template <typename T>
+FrozenArt<T>::FrozenArt(std::vector<char> image)
+    : image_(std::move(image)), data_(image_.data()), size_(image_.size()) {
+  open();
+}
+
+template <typename T> FrozenArt<T>::FrozenArt(const char *path) {
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0)
+    throw std::system_error(errno, std::generic_category(), path);
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    int error = errno;
+    ::close(fd);
+    throw std::system_error(error, std::generic_category(), path);
+  }
+  size_ = st.st_size;
+  if (size_ < sizeof(header)) {
+    ::close(fd);
+    throw std::invalid_argument("not a frozen tree image");
+  }
+  void *mapping = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+  int error = errno;
+  ::close(fd);
+  if (mapping == MAP_FAILED)
+    throw std::system_error(error, std::generic_category(), path);
+  data_ = static_cast<const char *>(mapping);
+  mapped_ = true;
+  try {
+    open();
+  } catch (...) {
+    ::munmap(mapping, size_);
+    throw;
+  }
+}
+
+template <typename T>
+FrozenArt<T>::FrozenArt(FrozenArt &&other) noexcept
+    : image_(std::move(other.image_)),
+      data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      mapped_(std::exchange(other.mapped_, false)),
+      root_(std::exchange(other.root_, 0)),
+      nKeys_(std::exchange(other.nKeys_, 0)) {}
+
+template <typename T>
+FrozenArt<T> &FrozenArt<T>::operator=(FrozenArt &&other) noexcept {
+  if (this != &other) {
+    if (mapped_)
+      ::munmap(const_cast<char *>(data_), size_);
+    image_ = std::move(other.image_);
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+    mapped_ = std::exchange(other.mapped_, false);
+    root_ = std::exchange(other.root_, 0);
+    nKeys_ = std::exchange(other.nKeys_, 0);
+  }
+  return *this;
+}
+
+template <typename T> FrozenArt<T>::~FrozenArt() {
+  if (mapped_)
+    ::munmap(const_cast<char *>(data_), size_);
+}
+
+template <typename T> void FrozenArt<T>::open() {
+  header h;
+  if (size_ < sizeof(header) ||
+      reinterpret_cast<std::uintptr_t>(data_) % 8 != 0)
+    throw std::invalid_argument("not a frozen tree image");
+  std::memcpy(&h, data_, sizeof(header));
+  if (std::memcmp(h.magic, magic, sizeof(magic)) != 0 || h.size != size_)
+    throw std::invalid_argument("not a frozen tree image");
+  if (h.version != formatVersion)
+    throw std::invalid_argument("unsupported frozen tree image version");
+  if (h.valueSize != sizeof(T))
+    throw std::invalid_argument("frozen tree image of another value type");
+  root_ = h.root;
+  nKeys_ = h.nKeys;
+}
+
+template <typename T> std::vector<char> FrozenArt<T>::write(Node<T> *root) {
+  std::vector<char> image(sizeof(header));
+  header h{};
+  std::memcpy(h.magic, magic, sizeof(magic));
+  h.version = formatVersion;
+  h.valueSize = sizeof(T);
+  if (root != nullptr) {
+    std::string path;
+    h.root = writeNode(image, root, path, h.nKeys);
+  }
+  h.size = image.size();
+  std::memcpy(image.data(), &h, sizeof(header));
+  return image;
+}
+
+template <typename T>
+uint64_t FrozenArt<T>::writeNode(std::vector<char> &image, Node<T> *node,
+                                 std::string &path, uint64_t &nKeys) {
+  uint64_t offset = image.size();
+  if (isLeaf(node)) {
+    /* embedded values sit where the path spells their whole key */
+    std::string_view key = path;
+    if (!isEmbedded(node)) {
+      LeafNode<T> *leaf = asLeaf(node);
+      key = std::string_view(reinterpret_cast<const char *>(leaf->key()),
+                             leaf->keyLen_);
+    }
+    uint32_t restLen = key.size() - path.size();
+    std::size_t keyOffset = valueOffset + padded(sizeof(T));
+    image.resize(offset + keyOffset + padded(restLen));
+    T value = leafValue(node);
+    std::memcpy(&image[offset], &restLen, sizeof(restLen));
+    std::memcpy(&image[offset + valueOffset], &value, sizeof(T));
+    std::memcpy(&image[offset + keyOffset], key.data() + path.size(),
+                restLen);
+    ++nKeys;
+    return offset | leafTag;
+  }
+
+  auto inner = static_cast<innerNode<T> *>(node);
+  std::size_t depth = path.size();
+  uint32_t prefixLen = inner->prefixLen_;
+  /* prefixes longer than maxPrefixLen are spelled by the keys below */
+  const uint8_t *prefix = prefixLen <= Node<T>::maxPrefixLen
+                              ? inner->prefix_
+                              : inner->minLeaf()->key() + depth;
+  path.append(reinterpret_cast<const char *>(prefix), prefixLen);
+
+  int nChildren = inner->nChildren();
+  uint8_t type = nChildren <= sparseMax ? sparseNode
+                 : nChildren < 256      ? indexedNode
+                                        : denseNode;
+  std::size_t leafOffset = sizeof(nodeHeader) + padded(prefixLen);
+  std::size_t keysOffset = leafOffset + (inner->leaf_ != nullptr ? 8 : 0);
+  std::size_t refsOffset =
+      keysOffset + (type == sparseNode    ? padded(nChildren)
+                    : type == indexedNode ? 256
+                                          : 0);
+  image.resize(offset + refsOffset + 8 * (type == denseNode ? 256 : nChildren));
+  nodeHeader h{type, inner->leaf_ != nullptr,
+               static_cast<uint16_t>(nChildren), prefixLen};
+  std::memcpy(&image[offset], &h, sizeof(nodeHeader));
+  std::memcpy(&image[offset + sizeof(nodeHeader)], path.data() + depth,
+              prefixLen);
+
+  /* the image grows while the subtrees are written, refer to it by offset */
+  auto setRef = [&](std::size_t at, uint64_t ref) {
+    std::memcpy(&image[offset + at], &ref, sizeof(ref));
+  };
+  if (inner->leaf_ != nullptr)
+    setRef(leafOffset, writeNode(image, inner->leaf_, path, nKeys));
+  int i = 0;
+  inner->forEachChild(0, [&](uint8_t partialKey, Node<T> *child) {
+    path.push_back(static_cast<char>(partialKey));
+    uint64_t ref = writeNode(image, child, path, nKeys);
+    path.pop_back();
+    if (type == sparseNode)
+      image[offset + keysOffset + i] = static_cast<char>(partialKey);
+    else if (type == indexedNode)
+      image[offset + keysOffset + partialKey] = static_cast<char>(i + 1);
+    setRef(refsOffset + 8 * (type == denseNode ? partialKey : i), ref);
+    ++i;
+    return true;
+  });
+  path.resize(depth);
+  return offset;
+}
+
+template <typename T>
+typename FrozenArt<T>::nodeView FrozenArt<T>::view(uint64_t node) const {
+  const char *p = data_ + node;
+  nodeHeader h;
+  std::memcpy(&h, p, sizeof(nodeHeader));
+  nodeView v;
+  v.type = h.type;
+  v.hasLeaf = h.hasLeaf != 0;
+  v.nChildren = h.nChildren;
+  v.prefixLen = h.prefixLen;
+  v.prefix = reinterpret_cast<const uint8_t *>(p + sizeof(nodeHeader));
+  p += sizeof(nodeHeader) + padded(h.prefixLen);
+  v.leaf = 0;
+  if (v.hasLeaf) {
+    std::memcpy(&v.leaf, p, sizeof(v.leaf));
+    p += sizeof(v.leaf);
+  }
+  v.keys = reinterpret_cast<const uint8_t *>(p);
+  if (v.type == sparseNode)
+    p += padded(v.nChildren);
+  else if (v.type == indexedNode)
+    p += 256;
+  v.refs = p;
+  return v;
+}
+
+template <typename T>
+int FrozenArt<T>::firstChild(const nodeView &node, int from) {
+  if (node.type == sparseNode) {
+    for (int i = 0; i < node.nChildren; ++i) {
+      if (node.keys[i] >= from)
+        return i;
+    }
+    return noChild;
+  }
+  for (int partialKey = from; partialKey < 256; ++partialKey) {
+    if (node.type == indexedNode ? node.keys[partialKey] != 0
+                                 : ref(node, partialKey) != 0)
+      return partialKey;
+  }
+  return noChild;
+}
+
+template <typename T>
+int FrozenArt<T>::nextChild(const nodeView &node, int pos) {
+  if (pos == leafSlot)
+    return firstChild(node, 0);
+  if (node.type == sparseNode)
+    return pos + 1 < node.nChildren ? pos + 1 : noChild;
+  return firstChild(node, pos + 1);
+}
+
+template <typename T>
+uint8_t FrozenArt<T>::partialKey(const nodeView &node, int pos) {
+  return node.type == sparseNode ? node.keys[pos] : pos;
+}
+
+template <typename T>
+uint64_t FrozenArt<T>::child(const nodeView &node, int pos) {
+  if (pos == leafSlot)
+    return node.leaf;
+  return ref(node, node.type == indexedNode ? node.keys[pos] - 1 : pos);
+}
+
+template <typename T>
+uint64_t FrozenArt<T>::findChild(const nodeView &node, uint8_t partialKey) {
+  switch (node.type) {
+  case sparseNode:
+    for (int i = 0; i < node.nChildren; ++i) {
+      if (node.keys[i] == partialKey)
+        return ref(node, i);
+    }
+    return 0;
+  case indexedNode:
+    return node.keys[partialKey] != 0
+               ? ref(node, node.keys[partialKey] - 1)
+               : 0;
+  default:
+    return ref(node, partialKey);
+  }
+}
+
+template <typename T>
+uint64_t FrozenArt<T>::ref(const nodeView &node, int i) {
+  uint64_t ref;
+  std::memcpy(&ref, node.refs + 8 * i, sizeof(ref));
+  return ref;
+}
+
+template <typename T> T FrozenArt<T>::value(uint64_t leaf) const {
+  T value;
+  std::memcpy(&value, data_ + (leaf & ~leafTag) + valueOffset, sizeof(T));
+  return value;
+}
+
+template <typename T>
+std::string_view FrozenArt<T>::suffix(uint64_t leaf) const {
+  const char *p = data_ + (leaf & ~leafTag);
+  uint32_t len;
+  std::memcpy(&len, p, sizeof(len));
+  return std::string_view(p + valueOffset + padded(sizeof(T)), len);
+}
+
+template <typename T>
+T FrozenArt<T>::get(const uint8_t *key, std::size_t keyLen) const {
+  uint64_t node = root_;
+  std::size_t depth = 0;
+  while (node != 0) {
+    if (node & leafTag) {
+      std::string_view rest = suffix(node);
+      if (rest.size() == keyLen - depth &&
+          std::memcmp(rest.data(), key + depth, rest.size()) == 0)
+        return value(node);
+      return T{};
+    }
+    nodeView v = view(node);
+    if (keyLen - depth < v.prefixLen ||
+        std::memcmp(v.prefix, key + depth, v.prefixLen) != 0)
+      return T{};
+    depth += v.prefixLen;
+    node = depth == keyLen ? v.leaf : findChild(v, key[depth++]);
+  }
+  return T{};
+}
+
+template <typename T> T FrozenArt<T>::get(std::string_view key) const {
+  return get(reinterpret_cast<const uint8_t *>(key.data()), key.size());
+}
+
+template <typename T> T FrozenArt<T>::get(const char *key) const {
+  return get(std::string_view(key));
+}
+
+template <typename T> std::size_t FrozenArt<T>::size() const {
+  return nKeys_;
+}
+
+template <typename T>
+typename FrozenArt<T>::iterator FrozenArt<T>::begin() const {
+  iterator it(this);
+  if (root_ != 0)
+    it.descendMin(root_);
+  return it;
+}
+
+template <typename T>
+typename FrozenArt<T>::iterator
+FrozenArt<T>::begin(const uint8_t *key, std::size_t keyLen) const {
+  iterator it(this);
+  it.seek(key, keyLen);
+  return it;
+}
+
+template <typename T>
+typename FrozenArt<T>::iterator
+FrozenArt<T>::begin(std::string_view key) const {
+  return begin(reinterpret_cast<const uint8_t *>(key.data()), key.size());
+}
+
+template <typename T>
+typename FrozenArt<T>::iterator FrozenArt<T>::begin(const char *key) const {
+  return begin(std::string_view(key));
+}
+
+template <typename T>
+typename FrozenArt<T>::iterator FrozenArt<T>::end() const {
+  return iterator(this);
+}
+
+template <typename T>
+template <class Fn>
+bool FrozenArt<T>::scan(std::string_view lo, std::string_view hi,
+                        Fn fn) const {
+  for (iterator it = begin(lo), itEnd = end(); it != itEnd; ++it) {
+    if (!(it.key() < hi))
+      break;
+    T value = *it;
+    if (!fn(it.key(), value))
+      return false;
+  }
+  return true;
+}
+
+template <typename T>
+template <class Fn>
+bool FrozenArt<T>::scanPrefix(std::string_view prefix, Fn fn) const {
+  /* the keys starting with the prefix are those before its successor,
+   * which does not exist if it only consists of 0xff bytes */
+  std::string successor(prefix);
+  while (!successor.empty() && static_cast<uint8_t>(successor.back()) == 0xff)
+    successor.pop_back();
+  if (!successor.empty()) {
+    ++successor.back();
+    return scan(prefix, successor, fn);
+  }
+  for (iterator it = begin(prefix), itEnd = end(); it != itEnd; ++it) {
+    T value = *it;
+    if (!fn(it.key(), value))
+      return false;
+  }
+  return true;
+}
+
+template <typename T>
+FrozenArt<T>::iterator::iterator(const FrozenArt *tree) : tree_(tree) {}
+
+template <typename T> T FrozenArt<T>::iterator::operator*() const {
+  return tree_->value(leaf_);
+}
+
+template <typename T>
+typename FrozenArt<T>::iterator &FrozenArt<T>::iterator::operator++() {
+  advance();
+  return *this;
+}
+
+template <typename T>
+typename FrozenArt<T>::iterator FrozenArt<T>::iterator::operator++(int) {
+  iterator old = *this;
+  advance();
+  return old;
+}
+
+template <typename T>
+bool FrozenArt<T>::iterator::operator==(const iterator &rhs) const {
+  return leaf_ == rhs.leaf_;
+}
+
+template <typename T>
+bool FrozenArt<T>::iterator::operator!=(const iterator &rhs) const {
+  return !(*this == rhs);
+}
+
+template <typename T>
+std::string_view FrozenArt<T>::iterator::key() const {
+  return key_;
+}
+
+template <typename T>
+void FrozenArt<T>::iterator::descendMin(uint64_t ref) {
+  while (!(ref & leafTag)) {
+    nodeView v = tree_->view(ref);
+    int pos = v.hasLeaf ? leafSlot : firstChild(v, 0);
+    frames_.push_back({ref, pos, static_cast<uint32_t>(key_.size())});
+    key_.append(reinterpret_cast<const char *>(v.prefix), v.prefixLen);
+    if (pos != leafSlot)
+      key_.push_back(static_cast<char>(partialKey(v, pos)));
+    ref = child(v, pos);
+  }
+  key_.append(tree_->suffix(ref));
+  leaf_ = ref;
+}
+
+template <typename T> void FrozenArt<T>::iterator::advance() {
+  while (!frames_.empty()) {
+    frame &f = frames_.back();
+    nodeView v = tree_->view(f.node);
+    f.pos = nextChild(v, f.pos);
+    if (f.pos != noChild) {
+      key_.resize(f.depth + v.prefixLen);
+      key_.push_back(static_cast<char>(partialKey(v, f.pos)));
+      descendMin(child(v, f.pos));
+      return;
+    }
+    key_.resize(f.depth);
+    frames_.pop_back();
+  }
+  key_.clear();
+  leaf_ = 0;
+}
+
+template <typename T>
+void FrozenArt<T>::iterator::seek(const uint8_t *key, std::size_t keyLen) {
+  uint64_t ref = tree_->root_;
+  if (ref == 0)
+    return;
+  while (!(ref & leafTag)) {
+    nodeView v = tree_->view(ref);
+    std::size_t depth = key_.size();
+    std::size_t matchLen = 0;
+    while (matchLen < v.prefixLen && depth + matchLen < keyLen &&
+           key[depth + matchLen] == v.prefix[matchLen])
+      ++matchLen;
+    if (matchLen < v.prefixLen || depth + v.prefixLen == keyLen) {
+      if (matchLen < v.prefixLen && depth + matchLen < keyLen &&
+          key[depth + matchLen] > v.prefix[matchLen]) {
+        /* the search key is greater than the whole subtree */
+        advance();
+      } else {
+        /* the search key is at most the subtree's smallest key */
+        descendMin(ref);
+      }
+      return;
+    }
+
+    /* the leaf slot holds a key that is smaller than the search key */
+    depth += v.prefixLen;
+    int pos = firstChild(v, key[depth]);
+    if (pos == noChild) {
+      advance();
+      return;
+    }
+    uint8_t childKey = partialKey(v, pos);
+    frames_.push_back({ref, pos, static_cast<uint32_t>(key_.size())});
+    key_.append(reinterpret_cast<const char *>(v.prefix), v.prefixLen);
+    key_.push_back(static_cast<char>(childKey));
+    ref = child(v, pos);
+    if (childKey != key[depth]) {
+      descendMin(ref);
+      return;
+    }
+  }
+  /* the leaf was reached through the search key's bytes, compare the rest
+   * of its key */
+  key_.append(tree_->suffix(ref));
+  leaf_ = ref;
+  if (std::string_view(key_) <
+      std::string_view(reinterpret_cast<const char *>(key), keyLen))
+    advance();
+}
+
+} // namespace art
+
+#endif // !ART_FROZEN_ART_HPP
@@ -1,6 +1,7 @@
 #ifndef ART_INNER_NODE_HPP
 #define ART_INNER_NODE_HPP
 
+#include "allocator.hpp"
 #include "childIt.hpp"
 #include "leafNode.hpp"
 #include "node.hpp"
@@ -11,18 +12,20 @@
 #include <iostream>
 #include <iterator>
 #include <stdexcept>
+#include <type_traits>
 
 namespace art {
+
+/**
+ * Base of the inner node types.
+ *
+ * The operations below dispatch statically on the node's type tag to the
+ * concrete Node4, Node16, Node48 or Node256 implementation, which the
+ * compiler can inline into the tree's traversal loops.
+ */
 template <class T> class innerNode : public Node<T> {
 public:
-  innerNode() = default;
-  innerNode(const innerNode<T> &other) = default;
-  innerNode(innerNode<T> &&other) noexcept = default;
-  innerNode<T> &operator=(const innerNode<T> &other) = default;
-  innerNode<T> &operator=(innerNode<T> &&other) = default;
-  virtual ~innerNode() = default;
-
-  bool isLeaf() const override;
+  explicit innerNode(NodeType type);
 
   /**
    * Finds and returns the child node identified by the given partial key.
@@ -31,7 +34,7 @@ public:
    * @return Child node identified by the given partial key or
    * a null pointer of no child node is associated with the partial key.
    */
-  virtual Node<T> **findChild(char partialKey) = 0;
+  Node<T> **findChild(uint8_t partialKey);
 
   /**
    * Adds the given node to the node's children.
@@ -43,51 +46,81 @@ public:
    * @param partialKey - The partial key associated with the child.
    * @param child - The child node.
    */
-  virtual void setChild(char partialKey, Node<T> *child) = 0;
+  void setChild(uint8_t partialKey, Node<T> *child);
 
   /**
    * Deletes the child associated with the given partial key.
    *
    * @param partial_key - The partial key associated with the child.
    */
-  virtual Node<T> *delChild(char partialKey) = 0;
+  Node<T> *delChild(uint8_t partialKey);
 
   /**
    * Creates and returns a new node with bigger children capacity.
    * The current node gets deleted.
    *
+   * @param alloc - The allocator the tree's nodes are obtained from.
    * @return node with bigger capacity
    */
-  virtual innerNode<T> *grow() = 0;
+  template <class Allocator> innerNode<T> *grow(Allocator &alloc);
 
   /**
    * Creates and returns a new node with lesser children capacity.
    * The current node gets deleted.
    *
    * @pre node must be undefull
+   * @param alloc - The allocator the tree's nodes are obtained from.
    * @return node with lesser capacity
    */
-  virtual innerNode<T> *shrink() = 0;
+  template <class Allocator> innerNode<T> *shrink(Allocator &alloc);
+
+  /**
+   * Creates and returns a node of the same type holding the same prefix,
+   * leaf and children. The current node is left untouched.
+   *
+   * @param alloc - The allocator the tree's nodes are obtained from.
+   * @return copy of the node
+   */
+  template <class Allocator> innerNode<T> *copy(Allocator &alloc) const;
 
   /**
    * Determines if the node is full, i.e. can carry no more child nodes.
    */
-  virtual bool isFull() const = 0;
+  bool isFull() const;
 
   /**
    * Determines if the node is underfull, i.e. carries less child nodes than
    * intended.
    */
-  virtual bool isUnderfull() const = 0;
+  bool isUnderfull() const;
 
-  virtual int nChildren() const = 0;
+  /**
+   * Number of children, not counting the node's leaf slot.
+   */
+  int nChildren() const;
 
-  virtual char next_partial_key(char partial_key) const = 0;
+  uint8_t nextPartialKey(uint8_t partialKey) const;
 
-  virtual char prev_partial_key(char partial_key) const = 0;
+  uint8_t prevPartialKey(uint8_t partialKey) const;
 
   /**
-   * Iterator on the first child node.
+   * Calls fn(uint8_t partialKey, Node<T> *child) for the children whose
+   * partial key is at least from, in ascending order of their partial keys,
+   * until it returns false. The leaf slot is not visited.
+   *
+   * @return false if fn returned false.
+   */
+  template <class Fn> bool forEachChild(uint8_t from, Fn &&fn) const;
+
+  /**
+   * Finds the leftmost leaf of the subtree rooted in the node, i.e. the leaf
+   * with the smallest key.
+   */
+  LeafNode<T> *minLeaf();
+
+  /**
+   * Iterator on the first child node. The node's leaf slot, if any, comes
+   * first.
    *
    * @return Iterator on the first child node.
    */
@@ -101,9 +134,116 @@ public:
    */
   childIt<T> end();
   std::reverse_iterator<childIt<T>> rend();
+
+private:
+  /**
+   * Calls fn with the node cast to its concrete type.
+   */
+  template <class Fn> decltype(auto) visit(Fn &&fn);
+  template <class Fn> decltype(auto) visit(Fn &&fn) const;
 };
 
-template <class T> bool innerNode<T>::isLeaf() const { return false; }
+/**
+ * Advances a lookup of the given key by one inner node. The depth is
+ * updated to the number of key bytes consumed.
+ *
+ * @return the child or leaf the key leads to or a null pointer.
+ */
+template <class T>
+Node<T> *descend(Node<T> *node, const uint8_t *key, int keyLen, int &depth);
+
+template <class T>
+innerNode<T>::innerNode(NodeType type) : Node<T>(type) {}
+
+template <class T> Node<T> **innerNode<T>::findChild(uint8_t partialKey) {
+  return visit([=](auto n) { return n->findChild(partialKey); });
+}
+
+template <class T>
+void innerNode<T>::setChild(uint8_t partialKey, Node<T> *child) {
+  visit([=](auto n) { n->setChild(partialKey, child); });
+}
+
+template <class T> Node<T> *innerNode<T>::delChild(uint8_t partialKey) {
+  return visit([=](auto n) { return n->delChild(partialKey); });
+}
+
+template <class T>
+template <class Allocator>
+innerNode<T> *innerNode<T>::grow(Allocator &alloc) {
+  return visit([&](auto n) { return n->grow(alloc); });
+}
+
+template <class T>
+template <class Allocator>
+innerNode<T> *innerNode<T>::shrink(Allocator &alloc) {
+  return visit([&](auto n) { return n->shrink(alloc); });
+}
+
+template <class T>
+template <class Allocator>
+innerNode<T> *innerNode<T>::copy(Allocator &alloc) const {
+  return visit([&](auto n) -> innerNode<T> * {
+    using N = std::remove_cv_t<std::remove_pointer_t<decltype(n)>>;
+    return allocNode<N>(alloc, *n);
+  });
+}
+
+template <class T> bool innerNode<T>::isFull() const {
+  return visit([](auto n) { return n->isFull(); });
+}
+
+template <class T> bool innerNode<T>::isUnderfull() const {
+  return visit([](auto n) { return n->isUnderfull(); });
+}
+
+template <class T> int innerNode<T>::nChildren() const {
+  return this->nChildren_;
+}
+
+template <class T>
+uint8_t innerNode<T>::nextPartialKey(uint8_t partialKey) const {
+  return visit([=](auto n) { return n->nextPartialKey(partialKey); });
+}
+
+template <class T>
+uint8_t innerNode<T>::prevPartialKey(uint8_t partialKey) const {
+  return visit([=](auto n) { return n->prevPartialKey(partialKey); });
+}
+
+template <class T>
+template <class Fn>
+bool innerNode<T>::forEachChild(uint8_t from, Fn &&fn) const {
+  return visit([&](auto n) { return n->forEachChild(from, fn); });
+}
+
+template <class T> LeafNode<T> *innerNode<T>::minLeaf() {
+  Node<T> *node = this;
+  while (!isLeaf(node)) {
+    auto inner = static_cast<innerNode<T> *>(node);
+    node = inner->leaf_ != nullptr ? inner->leaf_
+                                   : *inner->findChild(inner->nextPartialKey(0));
+  }
+  assert(!isEmbedded(node));
+  return asLeaf(node);
+}
+
+template <class T>
+Node<T> *descend(Node<T> *node, const uint8_t *key, int keyLen, int &depth) {
+  if (std::min(node->prefixLen_, Node<T>::maxPrefixLen) !=
+      static_cast<uint32_t>(node->checkPrefix(key + depth, keyLen - depth)))
+    // Prefix mismatch
+    return nullptr;
+
+  depth += node->prefixLen_;
+  if (depth >= keyLen)
+    // The key ends at the node, it can only be the one in the leaf slot
+    return depth == keyLen ? node->leaf_ : nullptr;
+
+  Node<T> **child = static_cast<innerNode<T> *>(node)->findChild(key[depth]);
+  depth += 1;
+  return child != nullptr ? *child : nullptr;
+}
 
 template <class T> childIt<T> innerNode<T>::begin() { return childIt<T>(this); }
 
@@ -112,13 +252,45 @@ template <class T> std::reverse_iterator<childIt<T>> innerNode<T>::rbegin() {
 }
 
 template <class T> childIt<T> innerNode<T>::end() {
-  return childIt<T>(this, nChildren());
+  return childIt<T>(this, nChildren() + (this->leaf_ != nullptr));
 }
 
 template <class T> std::reverse_iterator<childIt<T>> innerNode<T>::rend() {
   return std::reverse_iterator<childIt<T>>(begin());
 }
 
+template <class T>
+template <class Fn>
+decltype(auto) innerNode<T>::visit(Fn &&fn) {
+  switch (this->type_) {
+  case NodeType::Node4:
+    return fn(static_cast<Node4<T> *>(this));
+  case NodeType::Node16:
+    return fn(static_cast<Node16<T> *>(this));
+  case NodeType::Node48:
+    return fn(static_cast<Node48<T> *>(this));
+  default:
+    assert(this->type_ == NodeType::Node256);
+    return fn(static_cast<Node256<T> *>(this));
+  }
+}
+
+template <class T>
+template <class Fn>
+decltype(auto) innerNode<T>::visit(Fn &&fn) const {
+  switch (this->type_) {
+  case NodeType::Node4:
+    return fn(static_cast<const Node4<T> *>(this));
+  case NodeType::Node16:
+    return fn(static_cast<const Node16<T> *>(this));
+  case NodeType::Node48:
+    return fn(static_cast<const Node48<T> *>(this));
+  default:
+    assert(this->type_ == NodeType::Node256);
+    return fn(static_cast<const Node256<T> *>(this));
+  }
+}
+
 } // namespace art
 
 #endif // ART_INNER_NODE_HPP
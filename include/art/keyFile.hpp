@@ -0,0 +1,182 @@
+#ifndef ART_KEY_FILE_HPP
+#define ART_KEY_FILE_HPP
+
+#include "art.hpp"
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace art {
+
+/**
+ * Newline-delimited file of keys, mapped into memory and read in place.
+ *
+ * Every line holds a key, optionally followed by a tab and a value; a
+ * trailing carriage return is dropped. Lines are handed out as views into
+ * the mapping, found with memchr(), so that reading the file allocates
+ * nothing per line. The views are valid as long as the KeyFile is alive.
+ *
+ *   art::KeyFile file("resources/artTest.txt");
+ *   art::Art<int> m;
+ *   file.load(m, [](std::string_view) { return 1; });
+ */
+class KeyFile {
+public:
+  /**
+   * Maps the file at the given path.
+   */
+  explicit KeyFile(const char *path);
+
+  KeyFile(KeyFile &&other) noexcept;
+  KeyFile &operator=(KeyFile &&other) noexcept;
+  ~KeyFile();
+
+  /**
+   * The content of the file.
+   */
+  std::string_view data() const;
+
+  /**
+   * Calls fn(std::string_view key, std::string_view value) for every line
+   * in the order of the file. The value is empty for lines without a tab.
+   *
+   * @return the number of lines.
+   */
+  template <class Fn> std::size_t forEach(Fn fn) const;
+
+  /**
+   * Checks whether the keys are in strictly ascending order, as required
+   * by Art::bulkLoad().
+   *
+   * @param nLines - Set to the number of lines.
+   */
+  bool sorted(std::size_t &nLines) const;
+
+  /**
+   * Inserts every line into the given tree, associating the key with
+   * valueOf(std::string_view value). Later lines overwrite the values of
+   * earlier lines with the same key.
+   *
+   * If the tree is empty and the keys are sorted without duplicates, the
+   * tree is built through bulkLoad() from views into the file, otherwise
+   * the keys are set one by one.
+   *
+   * @return the number of lines.
+   */
+  template <typename T, class Allocator, class Fn>
+  std::size_t load(Art<T, Allocator> &m, Fn valueOf) const;
+
+private:
+  const char *data_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+inline KeyFile::KeyFile(const char *path) {
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0)
+    throw std::system_error(errno, std::generic_category(), path);
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    int error = errno;
+    ::close(fd);
+    throw std::system_error(error, std::generic_category(), path);
+  }
+  size_ = st.st_size;
+  if (size_ == 0) {
+    ::close(fd);
+    return;
+  }
+  void *mapping = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  int error = errno;
+  ::close(fd);
+  if (mapping == MAP_FAILED)
+    throw std::system_error(error, std::generic_category(), path);
+  /* the file is read front to back, let the kernel read ahead */
+  ::madvise(mapping, size_, MADV_SEQUENTIAL);
+  data_ = static_cast<const char *>(mapping);
+}
+
+inline KeyFile::KeyFile(KeyFile &&other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)) {}
+
+inline KeyFile &KeyFile::operator=(KeyFile &&other) noexcept {
+  if (this != &other) {
+    if (data_ != nullptr)
+      ::munmap(const_cast<char *>(data_), size_);
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+  }
+  return *this;
+}
+
+inline KeyFile::~KeyFile() {
+  if (data_ != nullptr)
+    ::munmap(const_cast<char *>(data_), size_);
+}
+
+inline std::string_view KeyFile::data() const { return {data_, size_}; }
+
+template <class Fn> std::size_t KeyFile::forEach(Fn fn) const {
+  std::size_t nLines = 0;
+  const char *cur = data_, *end = data_ + size_;
+  while (cur != end) {
+    auto eol = static_cast<const char *>(std::memchr(cur, '\n', end - cur));
+    const char *next = eol == nullptr ? end : eol + 1;
+    if (eol == nullptr)
+      eol = end;
+    if (eol != cur && eol[-1] == '\r')
+      --eol;
+    auto tab = static_cast<const char *>(std::memchr(cur, '\t', eol - cur));
+    if (tab == nullptr) {
+      fn(std::string_view(cur, eol - cur), std::string_view());
+    } else {
+      fn(std::string_view(cur, tab - cur),
+         std::string_view(tab + 1, eol - tab - 1));
+    }
+    ++nLines;
+    cur = next;
+  }
+  return nLines;
+}
+
+inline bool KeyFile::sorted(std::size_t &nLines) const {
+  bool ascending = true, first = true;
+  std::string_view prev;
+  nLines = forEach([&](std::string_view key, std::string_view) {
+    /* char_traits<char> compares bytes as unsigned, like the tree */
+    ascending = ascending && (first || prev < key);
+    first = false;
+    prev = key;
+  });
+  return ascending;
+}
+
+template <typename T, class Allocator, class Fn>
+std::size_t KeyFile::load(Art<T, Allocator> &m, Fn valueOf) const {
+  std::size_t nLines = 0;
+  if (m.begin() == m.end() && sorted(nLines)) {
+    std::vector<std::pair<std::string_view, T>> entries;
+    entries.reserve(nLines);
+    forEach([&](std::string_view key, std::string_view value) {
+      entries.emplace_back(key, valueOf(value));
+    });
+    m.bulkLoad(entries.begin(), entries.end());
+    return nLines;
+  }
+  return forEach([&](std::string_view key, std::string_view value) {
+    m.set(key, valueOf(value));
+  });
+}
+
+} // namespace art
+
+#endif // !ART_KEY_FILE_HPP
@@ -0,0 +1,174 @@
+#ifndef ART_KEY_TRAITS_HPP
+#define ART_KEY_TRAITS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace art {
+
+/**
+ * Binary-comparable encoding of keys of type K.
+ *
+ * A specialization provides the fixed size of the encoding along with
+ * encode() and decode(). Encoded keys compare with memcmp like the keys
+ * themselves compare with operator<, so the tree's lexicographic order is
+ * the key type's natural order.
+ *
+ *   static constexpr std::size_t size;
+ *   static void encode(const K &key, uint8_t *out);
+ *   static K decode(const uint8_t *in);
+ *
+ * Specializations are provided for integers, enums, float, double and
+ * tuples or pairs of those.
+ */
+template <class K, class = void> struct KeyTraits;
+
+/**
+ * Unsigned integers are stored big-endian.
+ */
+template <class K>
+struct KeyTraits<K, std::enable_if_t<std::is_integral<K>::value &&
+                                     std::is_unsigned<K>::value>> {
+  static constexpr std::size_t size = sizeof(K);
+
+  static void encode(K key, uint8_t *out) {
+    for (std::size_t i = 0; i < size; ++i)
+      out[i] = static_cast<uint8_t>(key >> (8 * (size - 1 - i)));
+  }
+
+  static K decode(const uint8_t *in) {
+    K key = 0;
+    for (std::size_t i = 0; i < size; ++i)
+      key = static_cast<K>(key << 8) | in[i];
+    return key;
+  }
+};
+
+/**
+ * Signed integers are stored big-endian with the sign bit flipped, which
+ * moves negative numbers in front of positive ones.
+ */
+template <class K>
+struct KeyTraits<K, std::enable_if_t<std::is_integral<K>::value &&
+                                     std::is_signed<K>::value>> {
+  using bits = KeyTraits<std::make_unsigned_t<K>>;
+  static constexpr std::size_t size = sizeof(K);
+  static constexpr std::make_unsigned_t<K> signBit =
+      std::make_unsigned_t<K>(1) << (8 * size - 1);
+
+  static void encode(K key, uint8_t *out) {
+    bits::encode(static_cast<std::make_unsigned_t<K>>(key) ^ signBit, out);
+  }
+
+  static K decode(const uint8_t *in) {
+    return static_cast<K>(bits::decode(in) ^ signBit);
+  }
+};
+
+/**
+ * Enums are stored like their underlying type.
+ */
+template <class K>
+struct KeyTraits<K, std::enable_if_t<std::is_enum<K>::value>> {
+  using underlying = KeyTraits<std::underlying_type_t<K>>;
+  static constexpr std::size_t size = underlying::size;
+
+  static void encode(K key, uint8_t *out) {
+    underlying::encode(static_cast<std::underlying_type_t<K>>(key), out);
+  }
+
+  static K decode(const uint8_t *in) {
+    return static_cast<K>(underlying::decode(in));
+  }
+};
+
+/**
+ * IEEE 754 numbers are stored as their bit pattern: positive numbers get the
+ * sign bit set, negative numbers get all bits flipped so that a bigger
+ * magnitude sorts first. -0.0 sorts right before 0.0 and NaNs sort at
+ * either end depending on their sign.
+ */
+template <class K>
+struct KeyTraits<K, std::enable_if_t<std::is_floating_point<K>::value>> {
+  static_assert(sizeof(K) == 4 || sizeof(K) == 8,
+                "only IEEE 754 single and double precision are supported");
+  using uint = std::conditional_t<sizeof(K) == 4, uint32_t, uint64_t>;
+  using bits = KeyTraits<uint>;
+  static constexpr std::size_t size = sizeof(K);
+  static constexpr uint signBit = uint(1) << (8 * size - 1);
+
+  static void encode(K key, uint8_t *out) {
+    uint u;
+    std::memcpy(&u, &key, size);
+    bits::encode(u & signBit ? ~u : u | signBit, out);
+  }
+
+  static K decode(const uint8_t *in) {
+    uint u = bits::decode(in);
+    u = u & signBit ? u & ~signBit : ~u;
+    K key;
+    std::memcpy(&key, &u, size);
+    return key;
+  }
+};
+
+/**
+ * Tuples are stored as the concatenation of their elements' encodings, which
+ * all have a fixed size. Empty tuples are rejected.
+ */
+template <class... Ks> struct KeyTraits<std::tuple<Ks...>> {
+  static_assert(sizeof...(Ks) > 0, "an empty tuple has no bytes to encode");
+  static constexpr std::size_t size = (KeyTraits<Ks>::size + ... + 0);
+
+  static void encode(const std::tuple<Ks...> &key, uint8_t *out) {
+    encode(key, out, std::index_sequence_for<Ks...>());
+  }
+
+  static std::tuple<Ks...> decode(const uint8_t *in) {
+    return decode(in, std::index_sequence_for<Ks...>());
+  }
+
+private:
+  /* offset of the I-th element's encoding */
+  template <std::size_t I> static constexpr std::size_t offset() {
+    constexpr std::size_t sizes[] = {KeyTraits<Ks>::size..., 0};
+    std::size_t off = 0;
+    for (std::size_t i = 0; i < I; ++i)
+      off += sizes[i];
+    return off;
+  }
+
+  template <std::size_t... Is>
+  static void encode(const std::tuple<Ks...> &key, uint8_t *out,
+                     std::index_sequence<Is...>) {
+    (KeyTraits<Ks>::encode(std::get<Is>(key), out + offset<Is>()), ...);
+  }
+
+  template <std::size_t... Is>
+  static std::tuple<Ks...> decode(const uint8_t *in,
+                                  std::index_sequence<Is...>) {
+    return std::tuple<Ks...>(KeyTraits<Ks>::decode(in + offset<Is>())...);
+  }
+};
+
+template <class K1, class K2> struct KeyTraits<std::pair<K1, K2>> {
+  using tuple = KeyTraits<std::tuple<K1, K2>>;
+  static constexpr std::size_t size = tuple::size;
+
+  static void encode(const std::pair<K1, K2> &key, uint8_t *out) {
+    tuple::encode(std::tuple<K1, K2>(key.first, key.second), out);
+  }
+
+  static std::pair<K1, K2> decode(const uint8_t *in) {
+    auto key = tuple::decode(in);
+    return {std::get<0>(key), std::get<1>(key)};
+  }
+};
+
+} // namespace art
+
+#endif // !ART_KEY_TRAITS_HPP
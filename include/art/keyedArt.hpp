@@ -0,0 +1,135 @@
+#ifndef ART_KEYED_ART_HPP
+#define ART_KEYED_ART_HPP
+
+#include "allocator.hpp"
+#include "art.hpp"
+#include "keyTraits.hpp"
+#include "treeIt.hpp"
+#include <cstdint>
+
+namespace art {
+
+/**
+ * Adaptive radix tree mapping keys of type K to values of type V.
+ *
+ * Keys are encoded into a buffer on the stack through KeyTraits, whose
+ * encoding is binary comparable, and stored in an Art. Iterating the tree
+ * therefore visits the keys in the order of K, e.g. numeric order for
+ * integers and doubles, or element-wise order for tuples.
+ *
+ *   KeyedArt<std::tuple<uint32_t, int64_t>, Row *> rows;
+ *   rows.set({tenant, id}, row);
+ */
+template <class K, class V, class Traits = KeyTraits<K>,
+          class Allocator = SlabAllocator>
+class KeyedArt {
+  static_assert(Traits::size > 0,
+                "keys are encoded into at least one byte on the stack");
+
+public:
+  /**
+   * Finds the value associated with the given key.
+   *
+   * @param key - The key to find.
+   * @return the value associated with the key or a default constructed value.
+   */
+  V get(const K &key) const;
+
+  /**
+   * Associates the given key with the given value.
+   *
+   * @param key - The key to associate with the value.
+   * @param value - The value to be associated with the key.
+   * @return the previously associated value or a default constructed value.
+   */
+  V set(const K &key, V value);
+
+  /**
+   * Deletes the given key and returns its associated value.
+   *
+   * @param key - The key to delete.
+   * @return the value associated with the key or a default constructed value.
+   */
+  V del(const K &key);
+
+  /**
+   * Forward iterator that traverses the tree in the order of K.
+   */
+  treeIt<V> begin();
+
+  /**
+   * Forward iterator that traverses the tree in the order of K starting
+   * from the provided key.
+   */
+  treeIt<V> begin(const K &key);
+
+  /**
+   * Iterator to the end of the order.
+   */
+  treeIt<V> end();
+
+  /**
+   * Decodes the key of the leaf the iterator is on.
+   */
+  static K key(const treeIt<V> &it);
+
+  /**
+   * Underlying tree holding the encoded keys.
+   */
+  const Art<V, Allocator> &tree() const;
+
+private:
+  Art<V, Allocator> art_;
+};
+
+template <class K, class V, class Traits, class Allocator>
+V KeyedArt<K, V, Traits, Allocator>::get(const K &key) const {
+  uint8_t buf[Traits::size];
+  Traits::encode(key, buf);
+  return art_.get(buf, Traits::size);
+}
+
+template <class K, class V, class Traits, class Allocator>
+V KeyedArt<K, V, Traits, Allocator>::set(const K &key, V value) {
+  uint8_t buf[Traits::size];
+  Traits::encode(key, buf);
+  return art_.set(buf, Traits::size, value);
+}
+
+template <class K, class V, class Traits, class Allocator>
+V KeyedArt<K, V, Traits, Allocator>::del(const K &key) {
+  uint8_t buf[Traits::size];
+  Traits::encode(key, buf);
+  return art_.del(buf, Traits::size);
+}
+
+template <class K, class V, class Traits, class Allocator>
+treeIt<V> KeyedArt<K, V, Traits, Allocator>::begin() {
+  return art_.begin();
+}
+
+template <class K, class V, class Traits, class Allocator>
+treeIt<V> KeyedArt<K, V, Traits, Allocator>::begin(const K &key) {
+  uint8_t buf[Traits::size];
+  Traits::encode(key, buf);
+  return art_.begin(buf, Traits::size);
+}
+
+template <class K, class V, class Traits, class Allocator>
+treeIt<V> KeyedArt<K, V, Traits, Allocator>::end() {
+  return art_.end();
+}
+
+template <class K, class V, class Traits, class Allocator>
+K KeyedArt<K, V, Traits, Allocator>::key(const treeIt<V> &it) {
+  return Traits::decode(reinterpret_cast<const uint8_t *>(it.key().data()));
+}
+
+template <class K, class V, class Traits, class Allocator>
+const Art<V, Allocator> &KeyedArt<K, V, Traits, Allocator>::tree() const {
+  return art_;
+}
+
+} // namespace art
+
+#endif // !ART_KEYED_ART_HPP
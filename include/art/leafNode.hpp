@@ -2,20 +2,166 @@
 #define ART_LEAF_NODE_HPP
 
 #include "node.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
 
 namespace art {
 
-template <class T> class LeafNode : public Node<T> {
+/**
+ * Leaf record holding a value along with the full key it is associated with.
+ *
+ * Leaves are not nodes: a child slot refers to a leaf through a tagged
+ * pointer, see isLeaf(). The key bytes are stored right behind the record in
+ * the same allocation, use LeafNode<T>::size() to determine how many bytes a
+ * leaf needs.
+ */
+template <class T> class LeafNode {
 public:
-  explicit LeafNode(T value);
-  bool isLeaf() const override;
+  LeafNode(T value, const uint8_t *key, int keyLen);
+
+  std::size_t nodeSize() const;
+
+  /**
+   * Number of bytes required by a leaf for a key of the given length.
+   */
+  static std::size_t size(int keyLen);
+
+  /**
+   * Determines if the leaf is associated with the given key.
+   */
+  bool matches(const uint8_t *key, int keyLen) const;
+
+  const uint8_t *key() const;
 
   T value;
+  uint32_t keyLen_;
+
+  /* generation the leaf was created in, see Art::snapshot() */
+  uint32_t generation_ = 0;
 };
 
-template <class T> LeafNode<T>::LeafNode(T value) : value(value){};
+/**
+ * Determines if values of type T can be embedded in a child slot instead of
+ * being stored in a leaf record. This is the case for pointers to types
+ * aligned on at least 4 bytes, which leave the tag bits clear.
+ */
+template <class T, class = void> struct isEmbeddable : std::false_type {};
+
+template <class T>
+struct isEmbeddable<
+    T *, std::enable_if_t<std::is_object<T>::value && alignof(T) >= 4>>
+    : std::true_type {};
+
+/*
+ * Child slots hold tagged pointers:
+ *
+ *   ...00  inner node
+ *   ...01  leaf record
+ *   ...10  value embedded in the slot
+ */
+constexpr uintptr_t leafTag = 1;
+constexpr uintptr_t embeddedTag = 2;
+constexpr uintptr_t tagMask = 3;
+
+/**
+ * Determines if the child is a leaf, i.e. either a leaf record or an
+ * embedded value.
+ */
+template <class T> bool isLeaf(const Node<T> *child);
+
+/**
+ * Determines if the child is a value embedded in the slot.
+ */
+template <class T> bool isEmbedded(const Node<T> *child);
+
+template <class T> LeafNode<T> *asLeaf(Node<T> *child);
+template <class T> Node<T> *tagLeaf(LeafNode<T> *leaf);
+
+template <class T> T embeddedValue(const Node<T> *child);
+template <class T> Node<T> *embedValue(T value);
+
+/**
+ * Value of the given leaf, be it a leaf record or an embedded value.
+ */
+template <class T> T leafValue(Node<T> *leaf);
+
+/**
+ * Determines if the leaf reached at depth is associated with the given key.
+ */
+template <class T>
+bool leafMatches(Node<T> *leaf, const uint8_t *key, int keyLen, int depth);
+
+template <class T>
+LeafNode<T>::LeafNode(T value, const uint8_t *key, int keyLen)
+    : value(value), keyLen_(keyLen) {
+  std::copy(key, key + keyLen, reinterpret_cast<uint8_t *>(this + 1));
+}
+
+template <class T> std::size_t LeafNode<T>::nodeSize() const {
+  return size(keyLen_);
+}
+
+template <class T> std::size_t LeafNode<T>::size(int keyLen) {
+  return sizeof(LeafNode<T>) + keyLen;
+}
+
+template <class T>
+bool LeafNode<T>::matches(const uint8_t *key, int keyLen) const {
+  return keyLen_ == static_cast<uint32_t>(keyLen) &&
+         std::equal(key, key + keyLen, this->key());
+}
+
+template <class T> const uint8_t *LeafNode<T>::key() const {
+  return reinterpret_cast<const uint8_t *>(this + 1);
+}
+
+template <class T> bool isLeaf(const Node<T> *child) {
+  return reinterpret_cast<uintptr_t>(child) & tagMask;
+}
+
+template <class T> bool isEmbedded(const Node<T> *child) {
+  return reinterpret_cast<uintptr_t>(child) & embeddedTag;
+}
+
+template <class T> LeafNode<T> *asLeaf(Node<T> *child) {
+  return reinterpret_cast<LeafNode<T> *>(reinterpret_cast<uintptr_t>(child) &
+                                         ~tagMask);
+}
+
+template <class T> Node<T> *tagLeaf(LeafNode<T> *leaf) {
+  return reinterpret_cast<Node<T> *>(reinterpret_cast<uintptr_t>(leaf) |
+                                     leafTag);
+}
+
+template <class T> T embeddedValue(const Node<T> *child) {
+  static_assert(isEmbeddable<T>::value, "value can't be embedded");
+  return reinterpret_cast<T>(reinterpret_cast<uintptr_t>(child) & ~tagMask);
+}
+
+template <class T> Node<T> *embedValue(T value) {
+  static_assert(isEmbeddable<T>::value, "value can't be embedded");
+  return reinterpret_cast<Node<T> *>(reinterpret_cast<uintptr_t>(value) |
+                                     embeddedTag);
+}
+
+template <class T> T leafValue(Node<T> *leaf) {
+  if constexpr (isEmbeddable<T>::value) {
+    if (isEmbedded(leaf))
+      return embeddedValue(leaf);
+  }
+  return asLeaf(leaf)->value;
+}
 
-template <class T> bool LeafNode<T>::isLeaf() const { return true; }
+template <class T>
+bool leafMatches(Node<T> *leaf, const uint8_t *key, int keyLen, int depth) {
+  /* embedded values only occur where the path spells the whole key, leaf
+   * records are verified against the full key since prefixes longer than
+   * maxPrefixLen were skipped */
+  return isEmbedded(leaf) ? depth == keyLen
+                          : asLeaf(leaf)->matches(key, keyLen);
+}
 
 } // namespace art
 
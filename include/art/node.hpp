@@ -1,17 +1,55 @@
 #ifndef ART_NODE_HPP
 #define ART_NODE_HPP
 
-#include <_types/_uint16_t.h>
 #include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
 namespace art {
+
+/**
+ * Hints the processor that the thread is spinning.
+ */
+inline void cpuRelax() {
+#if defined(__i386__) || defined(__amd64__)
+  __builtin_ia32_pause();
+#endif
+}
+
+/**
+ * Tag identifying the concrete type of a node.
+ */
+enum class NodeType : uint8_t { Node4, Node16, Node48, Node256 };
+
+/**
+ * Common header of all inner nodes.
+ *
+ * There is no virtual dispatch: the header holds a type tag and operations
+ * that depend on the concrete node type switch over it. The header takes up
+ * 32 bytes in total. Leaves are not nodes, see LeafNode.
+ *
+ * Keys are arbitrary byte strings, so a key may be a prefix of another one.
+ * A key that ends right after a node's prefix can't be told apart by a
+ * partial key and is kept in the node's leaf_ slot instead, which sorts
+ * before all of the node's children.
+ */
 template <class T> class Node {
 public:
-  virtual ~Node() = default;
+  explicit Node(NodeType type);
 
-  Node() = default;
-  Node(const Node<T> &other) = default;
+  /**
+   * Copies the header except for the version, which starts over.
+   */
+  Node(const Node &other);
 
-  virtual bool isLeaf() const = 0;
+  /**
+   * Size of the node in bytes, i.e. of its concrete type, used to hand
+   * the node back to the tree's allocator.
+   */
+  std::size_t nodeSize() const;
 
   /**
    * Determines the number of matching bytes between the node's prefix and the
@@ -25,15 +63,188 @@ public:
    * prefix:  "abbbd"
    *           ^^^^*
    * index:    01234
+   *
+   * Only the bytes stored inline are compared, i.e. at most maxPrefixLen.
+   */
+  int checkPrefix(const uint8_t *key, int keyLen) const;
+
+  /**
+   * Sets the prefix length and stores the first maxPrefixLen bytes of the
+   * given prefix inline. The source may overlap with the current prefix.
    */
-  int checkPrefix(const char *key, int keyLen) const;
+  void setPrefix(const uint8_t *prefix, uint32_t prefixLen);
+
+  /**
+   * Copies the prefix and the leaf slot of the given node, used when a node
+   * is replaced by one of another type.
+   */
+  void copyHeader(const Node<T> &other);
+
+  /**
+   * Number of prefix bytes stored inline in the node header, 8 so that
+   * they fill its first 16 bytes along with the type, the child count and
+   * the prefix length.
+   *
+   * Longer prefixes are compressed optimistically: only their first
+   * maxPrefixLen bytes are kept and the remainder is skipped on lookups,
+   * which verify the full key in the leaf they end up in.
+   */
+  static constexpr uint32_t maxPrefixLen = 8;
+
+  /**
+   * Optimistic lock coupling, see ConcurrentArt.
+   *
+   * Readers take no lock: they remember the node's version through
+   * readLock() and validate() it once they are done reading the node,
+   * restarting if a writer got in between. Writers lock the nodes they
+   * modify, which increments the version once they unlock. Nodes replaced
+   * by another one are marked obsolete on unlock.
+   *
+   * All operations return false if the caller has to restart.
+   */
+  bool readLock(uint64_t &version) const;
+  bool validate(uint64_t version) const;
+  bool upgradeToWriteLock(uint64_t version);
+  bool writeLock();
+  void writeUnlock();
+  void writeUnlockObsolete();
+
+  /**
+   * Generation the node was created in, see Art::snapshot(). Art has no
+   * concurrent writers and keeps it in the version word.
+   */
+  uint32_t generation() const;
+  void setGeneration(uint32_t generation);
+
+  /**
+   * Number of keys in the subtree rooted in the node, maintained by trees
+   * counting their keys, see Art::rank(). Art keeps it in the upper half of
+   * the version word.
+   *
+   * The count takes 32 bits, a subtree holds at most 2^32 - 1 keys. Larger
+   * counts would wrap around silently and are caught by an assertion.
+   */
+  uint32_t keyCount() const;
+  void setKeyCount(std::size_t keyCount);
+
+  NodeType type_;
+  uint16_t nChildren_ = 0;
+  uint32_t prefixLen_ = 0;
+  uint8_t prefix_[maxPrefixLen];
 
-  char *prefix_ = nullptr;
-  uint16_t prefixLen_ = 0;
+  /* leaf of the key ending right after the prefix, or a null pointer */
+  Node<T> *leaf_ = nullptr;
+
+  /* version counter, lockedBit and obsoleteBit */
+  std::atomic<uint64_t> version_{0};
+
+  static constexpr uint64_t obsoleteBit = 1;
+  static constexpr uint64_t lockedBit = 2;
 };
 
-template <class T> int Node<T>::checkPrefix(const char *key, int keyLen) const {
-  return std::mismatch(prefix_, prefix_ + prefixLen_, key).second - key;
+template <class T> class Node4;
+template <class T> class Node16;
+template <class T> class Node48;
+template <class T> class Node256;
+
+template <class T> Node<T>::Node(NodeType type) : type_(type) {}
+
+template <class T>
+Node<T>::Node(const Node &other)
+    : type_(other.type_), nChildren_(other.nChildren_),
+      prefixLen_(other.prefixLen_), leaf_(other.leaf_) {
+  std::copy(other.prefix_, other.prefix_ + maxPrefixLen, prefix_);
+}
+
+template <class T> std::size_t Node<T>::nodeSize() const {
+  switch (type_) {
+  case NodeType::Node4:
+    return sizeof(Node4<T>);
+  case NodeType::Node16:
+    return sizeof(Node16<T>);
+  case NodeType::Node48:
+    return sizeof(Node48<T>);
+  case NodeType::Node256:
+    return sizeof(Node256<T>);
+  }
+  return 0;
+}
+
+template <class T>
+int Node<T>::checkPrefix(const uint8_t *key, int keyLen) const {
+  int len = std::min<int>(std::min(prefixLen_, maxPrefixLen), keyLen);
+  return std::mismatch(prefix_, prefix_ + len, key).first - prefix_;
+}
+
+template <class T>
+void Node<T>::setPrefix(const uint8_t *prefix, uint32_t prefixLen) {
+  std::memmove(prefix_, prefix, std::min(prefixLen, maxPrefixLen));
+  prefixLen_ = prefixLen;
+}
+
+template <class T> bool Node<T>::readLock(uint64_t &version) const {
+  version = version_.load(std::memory_order_acquire);
+  while (version & lockedBit) {
+    /* wait for the writer instead of restarting right away */
+    cpuRelax();
+    version = version_.load(std::memory_order_acquire);
+  }
+  return !(version & obsoleteBit);
+}
+
+template <class T> bool Node<T>::validate(uint64_t version) const {
+  /* the node's fields were read before the version is checked again */
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return version_.load(std::memory_order_relaxed) == version;
+}
+
+template <class T> bool Node<T>::upgradeToWriteLock(uint64_t version) {
+  return version_.compare_exchange_strong(version, version + lockedBit,
+                                          std::memory_order_acquire);
+}
+
+template <class T> bool Node<T>::writeLock() {
+  uint64_t version;
+  do {
+    if (!readLock(version))
+      return false;
+  } while (!upgradeToWriteLock(version));
+  return true;
+}
+
+template <class T> void Node<T>::writeUnlock() {
+  /* clears lockedBit and increments the version */
+  version_.fetch_add(lockedBit, std::memory_order_release);
+}
+
+template <class T> void Node<T>::writeUnlockObsolete() {
+  version_.fetch_add(lockedBit | obsoleteBit, std::memory_order_release);
+}
+
+template <class T> uint32_t Node<T>::generation() const {
+  return version_.load(std::memory_order_relaxed);
+}
+
+template <class T> void Node<T>::setGeneration(uint32_t generation) {
+  uint64_t version = version_.load(std::memory_order_relaxed);
+  version_.store((version & ~uint64_t{0xffffffff}) | generation,
+                 std::memory_order_relaxed);
+}
+
+template <class T> uint32_t Node<T>::keyCount() const {
+  return version_.load(std::memory_order_relaxed) >> 32;
+}
+
+template <class T> void Node<T>::setKeyCount(std::size_t keyCount) {
+  assert(keyCount <= 0xffffffff);
+  uint64_t version = version_.load(std::memory_order_relaxed);
+  version_.store((version & 0xffffffff) | uint64_t{keyCount} << 32,
+                 std::memory_order_relaxed);
+}
+
+template <class T> void Node<T>::copyHeader(const Node<T> &other) {
+  setPrefix(other.prefix_, other.prefixLen_);
+  leaf_ = other.leaf_;
 }
 } // namespace art
 
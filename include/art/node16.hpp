@@ -4,8 +4,13 @@
 #include "innerNode.hpp"
 #include "node.hpp"
 #include <algorithm>
+#include <cstdint>
 #include <stdexcept>
 
+#if defined(__i386__) || defined(__amd64__)
+#include <emmintrin.h>
+#endif
+
 namespace art {
 template <class T> class Node4;
 template <class T> class Node48;
@@ -15,47 +20,50 @@ template <class T> class Node16 : public innerNode<T> {
   friend class Node48<T>;
 
 public:
-  Node<T> **findChild(char partial_key) override;
-  void setChild(char partialKey, Node<T> *child) override;
-  Node<T> *delChild(char partialKey) override;
-  innerNode<T> *grow() override;
-  innerNode<T> *shrink() override;
-  bool isFull() const override;
-  bool isUnderfull() const override;
+  Node16();
 
-  char nextPartialKey(char partialKey) const override;
+  Node<T> **findChild(uint8_t partialKey);
+  void setChild(uint8_t partialKey, Node<T> *child);
+  Node<T> *delChild(uint8_t partialKey);
+  template <class Allocator> innerNode<T> *grow(Allocator &alloc);
+  template <class Allocator> innerNode<T> *shrink(Allocator &alloc);
+  bool isFull() const;
+  bool isUnderfull() const;
 
-  char prevPartialKey(char partialKey) const override;
+  uint8_t nextPartialKey(uint8_t partialKey) const;
 
-  int nChildren() const override;
+  uint8_t prevPartialKey(uint8_t partialKey) const;
+  template <class Fn> bool forEachChild(uint8_t from, Fn &&fn) const;
 
 private:
-  uint8_t nChildren_ = 0;
-  char keys_[16];
+  uint8_t keys_[16];
   Node<T> *children_[16];
 };
 
-template <typename T> Node<T> **Node16<T>::findChild(char partialKey) {
+template <typename T>
+Node16<T>::Node16() : innerNode<T>(NodeType::Node16) {}
+
+template <typename T> Node<T> **Node16<T>::findChild(uint8_t partialKey) {
 #if defined(__i386__) || defined(__amd64__)
   int bitfield =
-      _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(partial_key),
+      _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(partialKey),
                                        _mm_loadu_si128((__m128i *)keys_))) &
-      ((1 << n_children_) - 1);
+      ((1 << this->nChildren_) - 1);
   return (bool)bitfield ? &children_[__builtin_ctz(bitfield)] : nullptr;
 #else
 
   // Perform binary search on array to find child;
   int lo, mid, hi;
   lo = 0;
-  hi = nChildren_;
+  hi = this->nChildren_;
   while (lo < hi) {
     mid = (lo + hi) / 2;
     if (partialKey < keys_[mid])
       hi = mid;
     else if (partialKey > keys_[mid])
-      lo = mid;
+      lo = mid + 1;
     else
-      return children_[mid];
+      return &children_[mid];
   }
   return nullptr;
 
@@ -63,7 +71,7 @@ template <typename T> Node<T> **Node16<T>::findChild(char partialKey) {
 }
 // [a, b, c, d, e, f, g, h, x, y, z, 0, 0, 0]
 template <typename T>
-void Node16<T>::setChild(char partialKey, Node<T> *child) {
+void Node16<T>::setChild(uint8_t partialKey, Node<T> *child) {
   int childI;
   for (int i = this->nChildren_ - 1;; --i) {
     if (i >= 0 && partialKey < this->keys_[i]) {
@@ -76,52 +84,67 @@ void Node16<T>::setChild(char partialKey, Node<T> *child) {
   }
   this->keys_[childI] = partialKey;
   this->children_[childI] = child;
-  ++nChildren_;
+  ++this->nChildren_;
 }
 
-template <typename T> Node<T> *Node16<T>::delChild(char partialKey) {
-  Node<T> childToDelete = nullptr;
-  for (int i = 0; i < nChildren_; ++i) {
+template <typename T> Node<T> *Node16<T>::delChild(uint8_t partialKey) {
+  Node<T> *childToDelete = nullptr;
+  for (int i = 0; i < this->nChildren_; ++i) {
     if (childToDelete == nullptr && keys_[i] == partialKey) {
       childToDelete = children_[i];
     }
 
     // [a, c, d, 0]
     if (childToDelete != nullptr) {
-      keys_[i] = i < nChildren_ - 1 ? keys_[i + 1] : 0;
-      children_[i] = i < nChildren_ - 1 ? children_[i + 1] : nullptr;
+      keys_[i] = i < this->nChildren_ - 1 ? keys_[i + 1] : 0;
+      children_[i] =
+          i < this->nChildren_ - 1 ? children_[i + 1] : nullptr;
     }
   }
 
   if (childToDelete != nullptr)
-    --nChildren_;
+    --this->nChildren_;
 
   return childToDelete;
 }
 
-template <typename T> innerNode<T> *Node16<T>::grow() {
-  auto newNode = new Node48<T>();
-  newNode->prefix_ = this->prefix_;
-  newNode->prefixLen_ = this->prefixLen_;
+template <typename T>
+template <class Allocator>
+innerNode<T> *Node16<T>::grow(Allocator &alloc) {
+  auto newNode = allocNode<Node48<T>>(alloc);
+  newNode->copyHeader(*this);
+  for (int i = 0; i < this->nChildren_; ++i)
+    newNode->setChild(keys_[i], children_[i]);
+
+  freeNode(alloc, this);
+  return newNode;
+}
+
+template <typename T>
+template <class Allocator>
+innerNode<T> *Node16<T>::shrink(Allocator &alloc) {
+  auto newNode = allocNode<Node4<T>>(alloc);
+  newNode->copyHeader(*this);
   newNode->nChildren_ = this->nChildren_;
   std::copy(this->keys_, this->keys_ + this->nChildren_, newNode->keys_);
   std::copy(this->children_, this->children_ + this->nChildren_,
             newNode->children_);
 
-  delete this;
+  freeNode(alloc, this);
   return newNode;
 }
 
 template <typename T> bool Node16<T>::isFull() const {
-  return nChildren_ == 16;
+  return this->nChildren_ == 16;
 }
 
 template <typename T> bool Node16<T>::isUnderfull() const {
-  return nChildren_ == 4;
+  return this->nChildren_ <= 4;
 }
 
-template <typename T> char Node16<T>::nextPartialKey(char partialKey) const {
-  for (int i = 0; i < nChildren_; ++i) {
+template <typename T>
+uint8_t Node16<T>::nextPartialKey(uint8_t partialKey) const {
+  for (int i = 0; i < this->nChildren_; ++i) {
     if (keys_[i] >= partialKey) {
       return keys_[i];
     }
@@ -130,8 +153,9 @@ template <typename T> char Node16<T>::nextPartialKey(char partialKey) const {
       "There are no successors to the provided partial key");
 }
 
-template <typename T> char Node16<T>::prevPartialKey(char partialKey) const {
-  for (int i = nChildren_ - 1; i >= 0; --i) {
+template <typename T>
+uint8_t Node16<T>::prevPartialKey(uint8_t partialKey) const {
+  for (int i = this->nChildren_ - 1; i >= 0; --i) {
     if (keys_[i] <= partialKey) {
       return keys_[i];
     }
@@ -140,7 +164,17 @@ template <typename T> char Node16<T>::prevPartialKey(char partialKey) const {
       "There are no predecessors to the provided partial key");
 }
 
-template <typename T> int Node16<T>::nChildren() const { return nChildren_; }
+template <typename T>
+template <class Fn>
+bool Node16<T>::forEachChild(uint8_t from, Fn &&fn) const {
+  for (int i = 0; i < this->nChildren_; ++i) {
+    if (keys_[i] >= from && !fn(keys_[i], children_[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
 } // namespace art
 
 #endif // !ART_NODE_16_HPP
@@ -3,6 +3,8 @@
 
 #include "innerNode.hpp"
 #include "node.hpp"
+#include <array>
+#include <cstdint>
 #include <stdexcept>
 #include <vector>
 
@@ -17,96 +19,113 @@ template <typename T> class Node256 : public innerNode<T> {
 public:
   Node256();
 
-  Node<T> **findChild(char partial_key) override;
-  void setChild(char partialKey, Node<T> *child) override;
-  Node<T> *delChild(char partialKey) override;
-  innerNode<T> *grow() override;
-  innerNode<T> *shrink() override;
-  bool isFull() const override;
-  bool isUnderfull() const override;
+  Node<T> **findChild(uint8_t partialKey);
+  void setChild(uint8_t partialKey, Node<T> *child);
+  Node<T> *delChild(uint8_t partialKey);
+  template <class Allocator> innerNode<T> *grow(Allocator &alloc);
+  template <class Allocator> innerNode<T> *shrink(Allocator &alloc);
+  bool isFull() const;
+  bool isUnderfull() const;
 
-  char nextPartialKey(char partialKey) const override;
-  char prevPartialKey(char partialKey) const override;
-
-  int nChildren() const override;
+  uint8_t nextPartialKey(uint8_t partialKey) const;
+  uint8_t prevPartialKey(uint8_t partialKey) const;
+  template <class Fn> bool forEachChild(uint8_t from, Fn &&fn) const;
 
 private:
-  uint8_t nChildren_ = 0;
   std::array<Node<T> *, 256> children_;
 };
 
-template <typename T> Node256<T>::Node256() { children_.fill(nullptr); }
+template <typename T>
+Node256<T>::Node256() : innerNode<T>(NodeType::Node256) {
+  children_.fill(nullptr);
+}
 
-template <typename T> Node<T> **Node256<T>::findChild(char partialKey) {
-  return children_[128 + partialKey] != nullptr ? &children_[128 + partialKey]
+template <typename T> Node<T> **Node256<T>::findChild(uint8_t partialKey) {
+  return children_[partialKey] != nullptr ? &children_[partialKey]
                                                 : nullptr;
 }
 
 template <typename T>
-void Node256<T>::setChild(char partialKey, Node<T> *child) {
-  children_[128 + partialKey] = child;
-  ++nChildren_;
+void Node256<T>::setChild(uint8_t partialKey, Node<T> *child) {
+  children_[partialKey] = child;
+  ++this->nChildren_;
 }
 
-template <typename T> Node<T> *Node256<T>::delChild(char partialKey) {
-  Node<T> *nodeToDelete = children_[128 + partialKey];
+template <typename T> Node<T> *Node256<T>::delChild(uint8_t partialKey) {
+  Node<T> *nodeToDelete = children_[partialKey];
   if (nodeToDelete != nullptr) {
-    --nChildren_;
-    children_[128 + partialKey] = nullptr;
+    --this->nChildren_;
+    children_[partialKey] = nullptr;
   }
   return nodeToDelete;
 }
 
-template <typename T> innerNode<T> *Node256<T>::grow() {
+template <typename T>
+template <class Allocator>
+innerNode<T> *Node256<T>::grow(Allocator &) {
   throw std::runtime_error("Node of size 256 cant grow bigger");
 }
 
-template <typename T> innerNode<T> *Node256<T>::shrink() {
-  auto smallerNode = Node48<T>();
-  smallerNode->prefix_ = this->prefix_;
-  smallerNode->prefixLen_ = this->prefixLen_;
+template <typename T>
+template <class Allocator>
+innerNode<T> *Node256<T>::shrink(Allocator &alloc) {
+  auto smallerNode = allocNode<Node48<T>>(alloc);
+  smallerNode->copyHeader(*this);
   for (int partialKey = 0; partialKey < 256; ++partialKey) {
-    if (children_[128 + partialKey] != nullptr)
-      smallerNode->setChild(partialKey, children_[128 + partialKey]);
+    if (children_[partialKey] != nullptr)
+      smallerNode->setChild(partialKey, children_[partialKey]);
   }
 
-  delete this;
+  freeNode(alloc, this);
   return smallerNode;
 }
 
 template <typename T> bool Node256<T>::isFull() const {
-  return nChildren_ == 256;
+  return this->nChildren_ == 256;
 }
 
 template <typename T> bool Node256<T>::isUnderfull() const {
-  return nChildren_ == 48;
+  return this->nChildren_ <= 48;
 }
 
-template <typename T> char Node256<T>::nextPartialKey(char partialKey) const {
+template <typename T>
+uint8_t Node256<T>::nextPartialKey(uint8_t partialKey) const {
   while (true) {
-    if (children_[128 + partialKey] != nullptr)
+    if (children_[partialKey] != nullptr)
       return partialKey;
 
-    if (partialKey == 127)
+    if (partialKey == 255)
       throw std::out_of_range("Provided key doesnt have a successor");
 
     partialKey++;
   }
 }
 
-template <typename T> char Node256<T>::prevPartialKey(char partialKey) const {
+template <typename T>
+uint8_t Node256<T>::prevPartialKey(uint8_t partialKey) const {
   while (true) {
-    if (children_[128 + partialKey] != nullptr)
+    if (children_[partialKey] != nullptr)
       return partialKey;
 
-    if (partialKey == -128)
+    if (partialKey == 0)
       throw std::out_of_range("Provided key doesnt have a predecessor");
 
     --partialKey;
   }
 }
 
-template <typename T> int Node256<T>::nChildren() const { return nChildren_; }
+template <typename T>
+template <class Fn>
+bool Node256<T>::forEachChild(uint8_t from, Fn &&fn) const {
+  for (int partialKey = from; partialKey < 256; ++partialKey) {
+    if (children_[partialKey] != nullptr &&
+        !fn(static_cast<uint8_t>(partialKey), children_[partialKey])) {
+      return false;
+    }
+  }
+  return true;
+}
+
 } // namespace art
 
 #endif // !ART_NODE_256_HPP
@@ -3,9 +3,10 @@
 
 #include "innerNode.hpp"
 #include "node.hpp"
-#include <_types/_uint8_t.h>
 #include <algorithm>
 #include <array>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 #include <utility>
@@ -19,28 +20,30 @@ template <class T> class Node4 : public innerNode<T> {
   friend class Node16<T>;
 
 public:
-  Node<T> **findChild(char partial_key) override;
-  void setChild(char partialKey, Node<T> *child) override;
-  Node<T> *delChild(char partialKey) override;
-  innerNode<T> *grow() override;
-  innerNode<T> *shrink() override;
-  bool isFull() const override;
-  bool isUnderfull() const override;
+  Node4();
 
-  char nextPartialKey(char partialKey) const override;
+  Node<T> **findChild(uint8_t partialKey);
+  void setChild(uint8_t partialKey, Node<T> *child);
+  Node<T> *delChild(uint8_t partialKey);
+  template <class Allocator> innerNode<T> *grow(Allocator &alloc);
+  template <class Allocator> innerNode<T> *shrink(Allocator &alloc);
+  bool isFull() const;
+  bool isUnderfull() const;
 
-  char prevPartialKey(char partialKey) const override;
+  uint8_t nextPartialKey(uint8_t partialKey) const;
 
-  int nChildren() const override;
+  uint8_t prevPartialKey(uint8_t partialKey) const;
+  template <class Fn> bool forEachChild(uint8_t from, Fn &&fn) const;
 
 private:
-  uint8_t nChildren_ = 0;
-  char keys_[4];
+  uint8_t keys_[4];
   Node<T> *children_[4];
 };
 
-template <class T> Node<T> **Node4<T>::findChild(char partialKey) {
-  for (int i = 0; i < nChildren_; ++i) {
+template <class T> Node4<T>::Node4() : innerNode<T>(NodeType::Node4) {}
+
+template <class T> Node<T> **Node4<T>::findChild(uint8_t partialKey) {
+  for (int i = 0; i < this->nChildren_; ++i) {
     if (keys_[i] == partialKey) {
       return &children_[i];
     }
@@ -48,63 +51,70 @@ template <class T> Node<T> **Node4<T>::findChild(char partialKey) {
   return nullptr;
 }
 
-template <class T> void Node4<T>::setChild(char partialKey, Node<T> *child) {
+template <class T> void Node4<T>::setChild(uint8_t partialKey, Node<T> *child) {
   /* determine index for child */
   int childIndex;
   for (childIndex = 0;
-       childIndex < nChildren_ && partialKey >= keys_[childIndex];
+       childIndex < this->nChildren_ && partialKey >= keys_[childIndex];
        ++childIndex) {
   }
 
   std::memmove(keys_ + childIndex + 1, keys_ + childIndex,
-               nChildren_ - childIndex);
+               this->nChildren_ - childIndex);
   std::memmove(children_ + childIndex + 1, children_ + childIndex,
-               (nChildren_ - childIndex) * sizeof(void *));
+               (this->nChildren_ - childIndex) * sizeof(void *));
 
   keys_[childIndex] = partialKey;
   children_[childIndex] = child;
-  ++nChildren_;
+  ++this->nChildren_;
 }
 
-template <class T> Node<T> *Node4<T>::delChild(char partialKey) {
+template <class T> Node<T> *Node4<T>::delChild(uint8_t partialKey) {
   Node<T> *child_to_delete = nullptr;
-  for (int i = 0; i < nChildren_; ++i) {
+  for (int i = 0; i < this->nChildren_; ++i) {
     if (child_to_delete == nullptr && partialKey == keys_[i]) {
       child_to_delete = children_[i];
     }
     if (child_to_delete != nullptr) {
       /* move existing sibling to the left */
-      keys_[i] = i < nChildren_ - 1 ? keys_[i + 1] : 0;
-      children_[i] = i < nChildren_ - 1 ? children_[i + 1] : nullptr;
+      keys_[i] = i < this->nChildren_ - 1 ? keys_[i + 1] : 0;
+      children_[i] =
+          i < this->nChildren_ - 1 ? children_[i + 1] : nullptr;
     }
   }
   if (child_to_delete != nullptr) {
-    --nChildren_;
+    --this->nChildren_;
   }
   return child_to_delete;
 }
 
-template <typename T> innerNode<T> *Node4<T>::grow() {
-  auto newNode = new Node16<T>();
-  newNode->prefix_ = this->prefix_;
-  newNode->prefixLen_ = this->prefixLen_;
+template <typename T>
+template <class Allocator>
+innerNode<T> *Node4<T>::grow(Allocator &alloc) {
+  auto newNode = allocNode<Node16<T>>(alloc);
+  newNode->copyHeader(*this);
   newNode->nChildren_ = this->nChildren_;
   std::copy(this->keys_, this->keys_ + this->nChildren_, newNode->keys_);
   std::copy(this->children_, this->children_ + this->nChildren_,
             newNode->children_);
-  delete this;
+  freeNode(alloc, this);
   return newNode;
 }
 
-template <typename T> innerNode<T> *Node4<T>::shrink() {
+template <typename T>
+template <class Allocator>
+innerNode<T> *Node4<T>::shrink(Allocator &) {
   throw std::runtime_error("Cant shrink a Node4!");
 }
 
-template <typename T> bool Node4<T>::isFull() const { return nChildren_ == 4; }
+template <typename T> bool Node4<T>::isFull() const {
+  return this->nChildren_ == 4;
+}
 template <typename T> bool Node4<T>::isUnderfull() const { return false; }
 
-template <typename T> char Node4<T>::nextPartialKey(char partialKey) const {
-  for (int i = 0; i < nChildren_; ++i) {
+template <typename T>
+uint8_t Node4<T>::nextPartialKey(uint8_t partialKey) const {
+  for (int i = 0; i < this->nChildren_; ++i) {
     if (keys_[i] >= partialKey) {
       return keys_[i];
     }
@@ -112,8 +122,9 @@ template <typename T> char Node4<T>::nextPartialKey(char partialKey) const {
   throw std::out_of_range("provided partial key doesnt have a successor");
 }
 
-template <typename T> char Node4<T>::prevPartialKey(char partialKey) const {
-  for (int i = nChildren_ - 1; i >= 0; --i) {
+template <typename T>
+uint8_t Node4<T>::prevPartialKey(uint8_t partialKey) const {
+  for (int i = this->nChildren_ - 1; i >= 0; --i) {
     if (keys_[i] <= partialKey) {
       return keys_[i];
     }
@@ -121,8 +132,15 @@ template <typename T> char Node4<T>::prevPartialKey(char partialKey) const {
   throw std::out_of_range("provided partial key doesnt have a predecessor");
 }
 
-template <typename T> int Node4<T>::nChildren() const {
-  return this->nChildren_;
+template <typename T>
+template <class Fn>
+bool Node4<T>::forEachChild(uint8_t from, Fn &&fn) const {
+  for (int i = 0; i < this->nChildren_; ++i) {
+    if (keys_[i] >= from && !fn(keys_[i], children_[i])) {
+      return false;
+    }
+  }
+  return true;
 }
 
 } // namespace art
@@ -3,8 +3,8 @@
 
 #include "innerNode.hpp"
 #include "node.hpp"
-#include <_types/_uint8_t.h>
 #include <algorithm>
+#include <cstdint>
 #include <stdexcept>
 
 namespace art {
@@ -19,114 +19,143 @@ template <typename T> class Node48 : public innerNode<T> {
 public:
   Node48();
 
-  Node<T> **findChild(char partial_key) override;
-  void setChild(char partialKey, Node<T> *child) override;
-  Node<T> *delChild(char partialKey) override;
-  innerNode<T> *grow() override;
-  innerNode<T> *shrink() override;
-  bool isFull() const override;
-  bool isUnderfull() const override;
+  Node<T> **findChild(uint8_t partialKey);
+  void setChild(uint8_t partialKey, Node<T> *child);
+  Node<T> *delChild(uint8_t partialKey);
+  template <class Allocator> innerNode<T> *grow(Allocator &alloc);
+  template <class Allocator> innerNode<T> *shrink(Allocator &alloc);
+  bool isFull() const;
+  bool isUnderfull() const;
 
-  char nextPartialKey(char partialKey) const override;
-  char prevPartialKey(char partialKey) const override;
-
-  int nChildren() const override;
+  uint8_t nextPartialKey(uint8_t partialKey) const;
+  uint8_t prevPartialKey(uint8_t partialKey) const;
+  template <class Fn> bool forEachChild(uint8_t from, Fn &&fn) const;
 
 private:
-  static const char EMPTY;
+  static const uint8_t EMPTY;
 
-  uint8_t nChildren_ = 0;
-  char indexes_[256];
+  uint8_t indexes_[256];
   Node<T> *children_[48];
 };
 
-template <typename T> Node48<T>::Node48() {
+template <typename T>
+Node48<T>::Node48() : innerNode<T>(NodeType::Node48) {
   std::fill(this->indexes_, this->indexes_ + 256, Node48::EMPTY);
-  std::fill(this->indexes_, this->indexes_ + 48, Node48::EMPTY);
+  std::fill(this->children_, this->children_ + 48, nullptr);
 }
 
-template <typename T> Node<T> **Node48<T>::findChild(char partialKey) {
-  uint8_t index = indexes_[128 + partialKey];
+template <typename T> Node<T> **Node48<T>::findChild(uint8_t partialKey) {
+  uint8_t index = indexes_[partialKey];
   return Node48<T>::EMPTY != index ? &children_[index] : nullptr;
 }
 
 template <typename T>
-void Node48<T>::setChild(char partialKey, Node<T> *child) {
+void Node48<T>::setChild(uint8_t partialKey, Node<T> *child) {
   for (int i = 0; i < 48; ++i) {
     if (children_[i] == nullptr) {
-      indexes_[128 + partialKey] = static_cast<uint8_t>(i);
+      indexes_[partialKey] = static_cast<uint8_t>(i);
       children_[i] = child;
       break;
     }
   }
-  ++nChildren_;
+  ++this->nChildren_;
 }
 
-template <typename T> Node<T> *Node48<T>::delChild(char partialKey) {
+template <typename T> Node<T> *Node48<T>::delChild(uint8_t partialKey) {
   Node<T> *childToDelete = nullptr;
 
-  // TODO: DOES THIS ACTUALLY NEED TO BE UNSIGNED??
-  char index = indexes_[128 + partialKey];
-  if (indexes_[index] != Node48::EMPTY) {
+  uint8_t index = indexes_[partialKey];
+  if (index != Node48::EMPTY) {
     childToDelete = children_[index];
-    indexes_[128 + partialKey] = Node48::EMPTY;
+    indexes_[partialKey] = Node48::EMPTY;
     children_[index] = nullptr;
-    --nChildren_;
+    --this->nChildren_;
   }
 
   return childToDelete;
 }
 
-template <typename T> innerNode<T> *Node48<T>::grow() {
-  auto newNode = new Node256<T>();
-  newNode->prefix_ = this->prefix_;
-  newNode->prefixLen_ = this->prefixLen_;
+template <typename T>
+template <class Allocator>
+innerNode<T> *Node48<T>::grow(Allocator &alloc) {
+  auto newNode = allocNode<Node256<T>>(alloc);
+  newNode->copyHeader(*this);
   uint8_t index;
-  for (int partialKey = -128; partialKey < 127; ++partialKey) {
-    index = indexes_[partialKey + 128];
+  for (int partialKey = 0; partialKey < 256; ++partialKey) {
+    index = indexes_[partialKey];
     if (index != Node48::EMPTY) {
       newNode->setChild(partialKey, children_[index]);
     }
   }
-  delete this;
+  freeNode(alloc, this);
+  return newNode;
+}
+
+template <typename T>
+template <class Allocator>
+innerNode<T> *Node48<T>::shrink(Allocator &alloc) {
+  auto newNode = allocNode<Node16<T>>(alloc);
+  newNode->copyHeader(*this);
+  uint8_t index;
+  for (int partialKey = 0; partialKey < 256; ++partialKey) {
+    index = indexes_[partialKey];
+    if (index != Node48::EMPTY) {
+      newNode->setChild(partialKey, children_[index]);
+    }
+  }
+  freeNode(alloc, this);
   return newNode;
 }
 
 template <typename T> bool Node48<T>::isFull() const {
-  return nChildren_ == 48;
+  return this->nChildren_ == 48;
 }
 
 template <typename T> bool Node48<T>::isUnderfull() const {
-  return nChildren_ == 16;
+  return this->nChildren_ <= 16;
 }
 
-template <typename T> const char Node48<T>::EMPTY = 48;
+template <typename T> const uint8_t Node48<T>::EMPTY = 48;
 
-template <typename T> char Node48<T>::nextPartialKey(char partialKey) const {
+template <typename T>
+uint8_t Node48<T>::nextPartialKey(uint8_t partialKey) const {
   while (true) {
-    if (indexes_[128 + partialKey] != Node48<T>::EMPTY)
+    if (indexes_[partialKey] != Node48<T>::EMPTY)
       return partialKey;
 
-    if (partialKey == 127)
+    if (partialKey == 255)
       throw std::out_of_range("Provided key doesnt have a successor");
 
     ++partialKey;
   }
 }
 
-template <typename T> char Node48<T>::prevPartialKey(char partialKey) const {
+template <typename T>
+uint8_t Node48<T>::prevPartialKey(uint8_t partialKey) const {
   while (true) {
-    if (indexes_[128 + partialKey] != Node48<T>::EMPTY)
+    if (indexes_[partialKey] != Node48<T>::EMPTY)
       return partialKey;
 
-    if (partialKey == -128)
+    if (partialKey == 0)
       throw std::out_of_range("Provided key doesnt have a predecessor");
 
     --partialKey;
   }
 }
 
-template <typename T> int Node48<T>::nChildren() const { return nChildren_; }
+template <typename T>
+template <class Fn>
+bool Node48<T>::forEachChild(uint8_t from, Fn &&fn) const {
+  for (int partialKey = from; partialKey < 256; ++partialKey) {
+    uint8_t index = indexes_[partialKey];
+    if (index != Node48<T>::EMPTY &&
+        !fn(static_cast<uint8_t>(partialKey), children_[index])) {
+      return false;
+    }
+  }
+  return true;
+}
+
 } // namespace art
 
 #endif // ART_NODE_48_HPP
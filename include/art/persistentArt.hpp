@@ -0,0 +1,677 @@
+#ifndef ART_PERSISTENT_ART_HPP
+#define ART_PERSISTENT_ART_HPP
+
+#include "art.hpp"
+#include "innerNode.hpp"
+#include "leafNode.hpp"
+#include "node.hpp"
+#include "treeIt.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace art {
+
+/**
+ * Allocator over the file-backed region of a PersistentArt.
+ *
+ * Blocks are rounded up to slotAlign and carved from the end of the
+ * allocated part of the region, which is grown along with its file. Freed
+ * blocks up to maxSlotSize are kept on a free list per size, bigger ones on
+ * a list of large blocks that serves any request, the rest of a block going
+ * back to the lists. The lists are linked through the free blocks by their
+ * offset in the region.
+ */
+class RegionAllocator {
+public:
+  RegionAllocator() = default;
+  RegionAllocator(const RegionAllocator &other) = delete;
+  RegionAllocator &operator=(const RegionAllocator &other) = delete;
+
+  /**
+   * Allocates a block of at least size bytes aligned on slotAlign.
+   *
+   * @throws std::bad_alloc if the region is full.
+   */
+  void *allocate(std::size_t size);
+
+  /**
+   * Returns a block obtained through allocate() with the same size.
+   */
+  void deallocate(void *p, std::size_t size);
+
+  /**
+   * Frees all blocks at once. Every block handed out so far becomes
+   * invalid.
+   */
+  void release();
+
+  static constexpr std::size_t slotAlign = 16;
+  static constexpr std::size_t maxSlotSize = 4096;
+
+  /* the region's file grows by multiples of growSize */
+  static constexpr std::size_t growSize = 1 << 20;
+
+private:
+  template <typename> friend class PersistentArt;
+
+  static constexpr std::size_t nFreeLists = maxSlotSize / slotAlign;
+
+  static std::size_t blockSize(std::size_t size) {
+    return (size + slotAlign - 1) & ~(slotAlign - 1);
+  }
+
+  uint64_t &link(uint64_t offset) {
+    return *reinterpret_cast<uint64_t *>(base_ + offset);
+  }
+
+  /**
+   * Adds the free block at the given offset to the lists.
+   */
+  void push(uint64_t offset, std::size_t size);
+
+  /**
+   * Maps more of the file, growing it if needed, so that the region spans
+   * at least size bytes.
+   */
+  void extend(std::size_t size);
+
+  char *base_ = nullptr;
+  int fd_ = -1;
+  /* first byte after the region's header */
+  std::size_t start_ = 0;
+  /* end of the allocated part */
+  std::size_t top_ = 0;
+  std::size_t mapped_ = 0;
+  std::size_t capacity_ = 0;
+
+  uint64_t freeLists_[nFreeLists] = {};
+  /* large free blocks hold the offset of the next one and their size */
+  uint64_t largeFree_ = 0;
+};
+
+/**
+ * Adaptive radix tree whose nodes live in a memory-mapped file, so that a
+ * process can reopen it right away after a restart instead of inserting
+ * every key again.
+ *
+ * The file is mapped into an address range reserved up front for its whole
+ * capacity, so the nodes never move while the file grows and child
+ * pointers amount to offsets from the range's start. A file is mapped at
+ * the address it was written at when that address is free. Otherwise the
+ * tree is copied into the region's free space with its pointers adjusted
+ * to the new base.
+ *
+ * checkpoint() makes the current version durable. It takes a snapshot of
+ * the tree, so that later modifications copy the nodes they change rather
+ * than overwrite them, flushes the region with msync() and then commits
+ * the root into whichever of the two checksummed root slots in the file's
+ * header is not in use. Opening a file picks the valid slot with the higher
+ * sequence number, i.e. the last complete checkpoint; the nodes of the
+ * previous checkpoint are only reused once the next one is committed.
+ *
+ * Closing the tree checkpoints it and stores the allocator's free lists.
+ * After a crash, they are rebuilt by walking the last checkpoint.
+ *
+ * T must be trivially copyable, and pointer values are only meaningful to
+ * the process that stored them. The file uses the byte order and the
+ * pointer size of the machine that wrote it.
+ *
+ *   art::PersistentArt<uint64_t> index("index.art");
+ *   index.set(key, row);
+ *   index.checkpoint();
+ */
+template <typename T> class PersistentArt {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "persistent values are stored byte by byte");
+
+public:
+  /**
+   * Opens the tree stored in the file at the given path, or creates the
+   * file.
+   *
+   * @param path - The file holding the tree.
+   * @param countKeys - Whether a new tree counts its keys, see Art. An
+   * existing tree keeps its setting.
+   * @param capacity - The size up to which the file may grow.
+   */
+  explicit PersistentArt(const char *path, bool countKeys = false,
+                         std::size_t capacity = defaultCapacity);
+  PersistentArt(const PersistentArt &other) = delete;
+  PersistentArt &operator=(const PersistentArt &other) = delete;
+
+  /**
+   * Checkpoints the tree and closes its file.
+   */
+  ~PersistentArt();
+
+  /**
+   * Finds the value associated with the given key.
+   *
+   * @param key - The key to find.
+   * @param keyLen - The length of the key in bytes.
+   * @return the value associated with the key or a default constructed value.
+   */
+  T get(const uint8_t *key, std::size_t keyLen) const;
+  T get(std::string_view key) const;
+  T get(const char *key) const;
+
+  /**
+   * Associates the given key with the given value.
+   *
+   * @param key - The key to associate with the value.
+   * @param keyLen - The length of the key in bytes.
+   * @param value - The value to be associated with the key.
+   * @return the previously associated value or a default constructed value.
+   */
+  T set(const uint8_t *key, std::size_t keyLen, T value);
+  T set(std::string_view key, T value);
+  T set(const char *key, T value);
+
+  /**
+   * Deletes the given key and returns its associated value.
+   *
+   * @param key - The key to delete.
+   * @param keyLen - The length of the key in bytes.
+   * @return the value associated with the key or a default constructed value.
+   */
+  T del(const uint8_t *key, std::size_t keyLen);
+  T del(std::string_view key);
+  T del(const char *key);
+
+  /**
+   * Forward iterator that traverses the tree in lexicographic order,
+   * optionally starting from the provided key.
+   */
+  treeIt<T> begin();
+  treeIt<T> begin(std::string_view key);
+
+  /**
+   * Iterator to the end of the lexicographic order.
+   */
+  treeIt<T> end();
+
+  /**
+   * The tree itself, for the rest of the read-only API.
+   */
+  const Art<T, RegionAllocator> &tree() const;
+
+  /**
+   * Makes the current version of the tree durable, see above.
+   *
+   * @throws std::system_error if the file could not be flushed.
+   */
+  void checkpoint();
+
+  static constexpr std::size_t defaultCapacity = std::size_t(1) << 36;
+
+private:
+  /* version of the tree committed by a checkpoint */
+  struct rootSlot {
+    uint64_t sequence;
+    uint64_t base;
+    uint64_t root;
+    uint64_t top;
+    uint32_t generation;
+    uint8_t countKeys;
+    uint8_t clean;
+    uint8_t unused[2];
+    uint64_t checksum;
+  };
+
+  /* first page of the file, the allocator's lists are only valid if the
+   * tree was closed cleanly */
+  struct regionHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t valueSize;
+    rootSlot slots[2];
+    uint64_t largeFree;
+    uint64_t freeLists[RegionAllocator::nFreeLists];
+  };
+
+  static constexpr std::size_t headerSize = 4096;
+  static_assert(sizeof(regionHeader) <= headerSize);
+
+  static constexpr char magic[8] = {'A', 'R', 'T', 'R', 'E', 'G', 'O', 'N'};
+  static constexpr uint32_t formatVersion = 1;
+
+  static uint64_t checksum(const rootSlot &slot);
+
+  /**
+   * Slot of the last complete checkpoint, or a null pointer.
+   */
+  static const rootSlot *lastSlot(const regionHeader &header);
+
+  void open(bool countKeys, std::size_t capacity);
+
+  /**
+   * Writes the given version of the tree to the unused root slot once the
+   * region is flushed.
+   */
+  void commit(Node<T> *root, uint32_t generation, bool countKeys,
+              bool clean);
+
+  /**
+   * Flushes the first size bytes of the region to the file.
+   */
+  void sync(std::size_t size);
+
+  /**
+   * Copies the subtree rooted in the given node, whose pointers are off by
+   * delta, into newly allocated blocks.
+   */
+  Node<T> *relocate(Node<T> *node, std::ptrdiff_t delta);
+
+  /**
+   * Rebuilds the allocator's lists from the blocks that are not reachable
+   * from the given root.
+   */
+  void sweep(Node<T> *root);
+
+  /**
+   * Hands the tree's nodes back to the file before the tree is destroyed.
+   */
+  void detach();
+
+  regionHeader &header() { return *reinterpret_cast<regionHeader *>(base_); }
+
+  int fd_ = -1;
+  char *base_ = nullptr;
+  std::size_t capacity_ = 0;
+  uint64_t sequence_ = 0;
+
+  Art<T, RegionAllocator> tree_;
+  /* the last checkpoint, whose nodes must not change */
+  std::optional<typename Art<T, RegionAllocator>::Snapshot> checkpoint_;
+};
+
+inline void *RegionAllocator::allocate(std::size_t size) {
+  size = blockSize(size);
+  if (size <= maxSlotSize) {
+    uint64_t &head = freeLists_[size / slotAlign - 1];
+    if (head != 0) {
+      uint64_t offset = head;
+      head = link(offset);
+      return base_ + offset;
+    }
+  }
+
+  /* first large block that fits, the rest of it is freed */
+  for (uint64_t *next = &largeFree_; *next != 0; next = &link(*next)) {
+    uint64_t offset = *next;
+    uint64_t freeSize = (&link(offset))[1];
+    if (freeSize >= size) {
+      *next = link(offset);
+      if (freeSize > size)
+        push(offset + size, freeSize - size);
+      return base_ + offset;
+    }
+  }
+
+  if (top_ + size > mapped_)
+    extend(top_ + size);
+  uint64_t offset = top_;
+  top_ += size;
+  return base_ + offset;
+}
+
+inline void RegionAllocator::deallocate(void *p, std::size_t size) {
+  push(static_cast<char *>(p) - base_, blockSize(size));
+}
+
+inline void RegionAllocator::release() {
+  top_ = start_;
+  std::fill(freeLists_, freeLists_ + nFreeLists, 0);
+  largeFree_ = 0;
+}
+
+inline void RegionAllocator::push(uint64_t offset, std::size_t size) {
+  if (size <= maxSlotSize) {
+    uint64_t &head = freeLists_[size / slotAlign - 1];
+    link(offset) = head;
+    head = offset;
+    return;
+  }
+  link(offset) = largeFree_;
+  (&link(offset))[1] = size;
+  largeFree_ = offset;
+}
+
+inline void RegionAllocator::extend(std::size_t size) {
+  if (size > capacity_)
+    throw std::bad_alloc();
+  std::size_t newSize = std::min(
+      std::max(mapped_ * 2, (size + growSize - 1) / growSize * growSize),
+      capacity_);
+  if (::ftruncate(fd_, newSize) != 0)
+    throw std::bad_alloc();
+  void *p = ::mmap(base_ + mapped_, newSize - mapped_,
+                   PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd_,
+                   mapped_);
+  if (p == MAP_FAILED)
+    throw std::bad_alloc();
+  mapped_ = newSize;
+}
+
+template <typename T>
+PersistentArt<T>::PersistentArt(const char *path, bool countKeys,
+                                std::size_t capacity) {
+  fd_ = ::open(path, O_RDWR | O_CREAT, 0644);
+  if (fd_ < 0)
+    throw std::system_error(errno, std::generic_category(), path);
+  try {
+    open(countKeys, capacity);
+  } catch (...) {
+    checkpoint_.reset();
+    detach();
+    if (base_ != nullptr)
+      ::munmap(base_, capacity_);
+    ::close(fd_);
+    throw;
+  }
+}
+
+template <typename T> PersistentArt<T>::~PersistentArt() {
+  try {
+    /* the nodes only the last checkpoint refers to are freed below, the
+     * current version has to be committed first */
+    commit(tree_.root, tree_.generation_, tree_.countKeys_, false);
+    checkpoint_.reset();
+    tree_.reclaimSnapshots();
+    RegionAllocator &alloc = tree_.allocator_;
+    header().largeFree = alloc.largeFree_;
+    std::copy(alloc.freeLists_, alloc.freeLists_ + RegionAllocator::nFreeLists,
+              header().freeLists);
+    commit(tree_.root, tree_.generation_, tree_.countKeys_, true);
+  } catch (...) {
+    /* the file is reopened from the last checkpoint */
+  }
+  checkpoint_.reset();
+  detach();
+  ::munmap(base_, capacity_);
+  ::close(fd_);
+}
+
+template <typename T> void PersistentArt<T>::open(bool countKeys,
+                                                  std::size_t capacity) {
+  struct stat st;
+  if (::fstat(fd_, &st) != 0)
+    throw std::system_error(errno, std::generic_category(), "fstat");
+  std::size_t size = st.st_size;
+  bool created = size == 0;
+  regionHeader h;
+  const rootSlot *slot = nullptr;
+  if (created) {
+    size = RegionAllocator::growSize;
+    if (::ftruncate(fd_, size) != 0)
+      throw std::system_error(errno, std::generic_category(), "ftruncate");
+  } else {
+    if (size < headerSize ||
+        ::pread(fd_, &h, sizeof(h), 0) != static_cast<ssize_t>(sizeof(h)) ||
+        std::memcmp(h.magic, magic, sizeof(magic)) != 0)
+      throw std::invalid_argument("not a persistent tree file");
+    if (h.version != formatVersion)
+      throw std::invalid_argument("unsupported persistent tree version");
+    if (h.valueSize != sizeof(T))
+      throw std::invalid_argument("persistent tree of another value type");
+    slot = lastSlot(h);
+    if (slot == nullptr)
+      throw std::invalid_argument("persistent tree without a valid root");
+  }
+
+  /* reserve the whole capacity so that the file can grow in place,
+   * preferably where the file was mapped before */
+  capacity_ = (std::max(capacity, size) + RegionAllocator::growSize - 1) /
+              RegionAllocator::growSize * RegionAllocator::growSize;
+  void *hint = slot != nullptr ? reinterpret_cast<void *>(slot->base)
+                               : nullptr;
+  void *range = ::mmap(hint, capacity_, PROT_NONE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (range == MAP_FAILED)
+    throw std::system_error(errno, std::generic_category(), "mmap");
+  base_ = static_cast<char *>(range);
+  if (::mmap(base_, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd_,
+             0) == MAP_FAILED)
+    throw std::system_error(errno, std::generic_category(), "mmap");
+
+  RegionAllocator &alloc = tree_.allocator_;
+  alloc.base_ = base_;
+  alloc.fd_ = fd_;
+  alloc.start_ = headerSize;
+  alloc.mapped_ = size;
+  alloc.capacity_ = capacity_;
+
+  Node<T> *root = nullptr;
+  uint32_t generation = 1;
+  if (created) {
+    std::memcpy(header().magic, magic, sizeof(magic));
+    header().version = formatVersion;
+    header().valueSize = sizeof(T);
+    alloc.top_ = headerSize;
+  } else {
+    sequence_ = slot->sequence;
+    alloc.top_ = slot->top;
+    root = reinterpret_cast<Node<T> *>(slot->root);
+    generation = slot->generation;
+    countKeys = slot->countKeys != 0;
+    std::ptrdiff_t delta = base_ - reinterpret_cast<char *>(slot->base);
+    if (delta != 0) {
+      /* the old nodes stay untouched until the copy is committed */
+      if (root != nullptr)
+        root = relocate(root, delta);
+      commit(root, generation, countKeys, false);
+      sweep(root);
+    } else if (slot->clean) {
+      alloc.largeFree_ = header().largeFree;
+      std::copy(header().freeLists,
+                header().freeLists + RegionAllocator::nFreeLists,
+                alloc.freeLists_);
+    } else {
+      sweep(root);
+    }
+  }
+
+  tree_.root = root;
+  tree_.generation_ = generation;
+  tree_.countKeys_ = countKeys;
+  checkpoint_.emplace(tree_.snapshot());
+  /* the allocator's lists change from now on */
+  commit(tree_.root, tree_.generation_, countKeys, false);
+}
+
+template <typename T>
+uint64_t PersistentArt<T>::checksum(const rootSlot &slot) {
+  /* FNV-1a over the fields before the checksum */
+  const auto *p = reinterpret_cast<const uint8_t *>(&slot);
+  uint64_t hash = 0xcbf29ce484222325;
+  for (std::size_t i = 0; i < offsetof(rootSlot, checksum); ++i)
+    hash = (hash ^ p[i]) * 0x100000001b3;
+  return hash;
+}
+
+template <typename T>
+const typename PersistentArt<T>::rootSlot *
+PersistentArt<T>::lastSlot(const regionHeader &header) {
+  const rootSlot *last = nullptr;
+  for (const rootSlot &slot : header.slots) {
+    if (slot.sequence != 0 && slot.checksum == checksum(slot) &&
+        (last == nullptr || slot.sequence > last->sequence))
+      last = &slot;
+  }
+  return last;
+}
+
+template <typename T>
+void PersistentArt<T>::commit(Node<T> *root, uint32_t generation,
+                              bool countKeys, bool clean) {
+  sync(tree_.allocator_.mapped_);
+  rootSlot slot{};
+  slot.sequence = sequence_ + 1;
+  slot.base = reinterpret_cast<uint64_t>(base_);
+  slot.root = reinterpret_cast<uint64_t>(root);
+  slot.top = tree_.allocator_.top_;
+  slot.generation = generation;
+  slot.countKeys = countKeys;
+  slot.clean = clean;
+  slot.checksum = checksum(slot);
+  header().slots[slot.sequence % 2] = slot;
+  sync(headerSize);
+  sequence_ = slot.sequence;
+}
+
+template <typename T> void PersistentArt<T>::sync(std::size_t size) {
+  if (::msync(base_, size, MS_SYNC) != 0 || ::fsync(fd_) != 0)
+    throw std::system_error(errno, std::generic_category(), "msync");
+}
+
+template <typename T>
+Node<T> *PersistentArt<T>::relocate(Node<T> *node, std::ptrdiff_t delta) {
+  if (isEmbedded(node))
+    return node;
+  node = reinterpret_cast<Node<T> *>(reinterpret_cast<char *>(node) + delta);
+  RegionAllocator &alloc = tree_.allocator_;
+  if (isLeaf(node)) {
+    LeafNode<T> *leaf = asLeaf(node);
+    std::size_t size = leaf->nodeSize();
+    void *copy = alloc.allocate(size);
+    std::memcpy(copy, static_cast<void *>(leaf), size);
+    return tagLeaf(static_cast<LeafNode<T> *>(copy));
+  }
+
+  auto inner = static_cast<innerNode<T> *>(node);
+  innerNode<T> *copy = inner->copy(alloc);
+  copy->setGeneration(inner->generation());
+  copy->setKeyCount(inner->keyCount());
+  if (copy->leaf_ != nullptr)
+    copy->leaf_ = relocate(copy->leaf_, delta);
+  copy->forEachChild(0, [&](uint8_t partialKey, Node<T> *child) {
+    *copy->findChild(partialKey) = relocate(child, delta);
+    return true;
+  });
+  return copy;
+}
+
+template <typename T> void PersistentArt<T>::sweep(Node<T> *root) {
+  RegionAllocator &alloc = tree_.allocator_;
+  std::vector<std::pair<uint64_t, uint64_t>> blocks;
+  auto mark = [&](auto &self, Node<T> *node) -> void {
+    if (node == nullptr || isEmbedded(node))
+      return;
+    if (isLeaf(node)) {
+      LeafNode<T> *leaf = asLeaf(node);
+      blocks.emplace_back(reinterpret_cast<char *>(leaf) - base_,
+                          RegionAllocator::blockSize(leaf->nodeSize()));
+      return;
+    }
+    auto inner = static_cast<innerNode<T> *>(node);
+    blocks.emplace_back(reinterpret_cast<char *>(inner) - base_,
+                        RegionAllocator::blockSize(inner->nodeSize()));
+    self(self, inner->leaf_);
+    inner->forEachChild(0, [&](uint8_t, Node<T> *child) {
+      self(self, child);
+      return true;
+    });
+  };
+  mark(mark, root);
+  std::sort(blocks.begin(), blocks.end());
+
+  alloc.release();
+  alloc.top_ = blocks.empty() ? alloc.start_
+                              : blocks.back().first + blocks.back().second;
+  uint64_t free = alloc.start_;
+  for (auto [offset, size] : blocks) {
+    if (offset > free)
+      alloc.push(free, offset - free);
+    free = offset + size;
+  }
+}
+
+template <typename T> void PersistentArt<T>::detach() {
+  tree_.root = nullptr;
+  tree_.retired_.clear();
+  tree_.allocator_.base_ = nullptr;
+}
+
+template <typename T>
+T PersistentArt<T>::get(const uint8_t *key, std::size_t keyLen) const {
+  return tree_.get(key, keyLen);
+}
+
+template <typename T> T PersistentArt<T>::get(std::string_view key) const {
+  return tree_.get(key);
+}
+
+template <typename T> T PersistentArt<T>::get(const char *key) const {
+  return tree_.get(key);
+}
+
+template <typename T>
+T PersistentArt<T>::set(const uint8_t *key, std::size_t keyLen, T value) {
+  return tree_.set(key, keyLen, value);
+}
+
+template <typename T>
+T PersistentArt<T>::set(std::string_view key, T value) {
+  return tree_.set(key, value);
+}
+
+template <typename T> T PersistentArt<T>::set(const char *key, T value) {
+  return tree_.set(key, value);
+}
+
+template <typename T>
+T PersistentArt<T>::del(const uint8_t *key, std::size_t keyLen) {
+  return tree_.del(key, keyLen);
+}
+
+template <typename T> T PersistentArt<T>::del(std::string_view key) {
+  return tree_.del(key);
+}
+
+template <typename T> T PersistentArt<T>::del(const char *key) {
+  return tree_.del(key);
+}
+
+template <typename T> treeIt<T> PersistentArt<T>::begin() {
+  return tree_.begin();
+}
+
+template <typename T> treeIt<T> PersistentArt<T>::begin(std::string_view key) {
+  return tree_.begin(key);
+}
+
+template <typename T> treeIt<T> PersistentArt<T>::end() {
+  return tree_.end();
+}
+
+template <typename T>
+const Art<T, RegionAllocator> &PersistentArt<T>::tree() const {
+  return tree_;
+}
+
+template <typename T> void PersistentArt<T>::checkpoint() {
+  typename Art<T, RegionAllocator>::Snapshot next = tree_.snapshot();
+  commit(tree_.root, tree_.generation_, tree_.countKeys_, false);
+  /* the previous checkpoint's nodes are reclaimed by the next
+   * modification */
+  checkpoint_ = next;
+}
+
+} // namespace art
+
+#endif // !ART_PERSISTENT_ART_HPP
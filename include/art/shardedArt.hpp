@@ -0,0 +1,442 @@
+#ifndef ART_SHARDED_ART_HPP
+#define ART_SHARDED_ART_HPP
+
+#include "allocator.hpp"
+#include "art.hpp"
+#include "treeIt.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace art {
+
+/**
+ * Adaptive radix tree partitioned into independent shards by key range,
+ * each guarded by its own reader-writer lock.
+ *
+ * Shard i holds the keys in [boundaries[i - 1], boundaries[i]), so writers
+ * only contend on keys that fall into the same range and the shards taken
+ * in order hold the keys in lexicographic order. The boundaries either
+ * split the leading key bits evenly or are derived from a sample of the
+ * keys through splitSample(), since an even split puts most keys of
+ * natural language or prefixed identifiers into a few shards.
+ *
+ * Iterators read a snapshot of the shard they are on, see Art::snapshot(),
+ * and hold no lock: each shard is seen at the point in time the iterator
+ * entered it.
+ */
+template <typename T, class Allocator = SlabAllocator> class ShardedArt {
+public:
+  /**
+   * Splits the key space into 2^shardBits shards by the leading bits of
+   * the keys.
+   *
+   * @param shardBits - Number of leading key bits selecting the shard, at
+   * most 16.
+   */
+  explicit ShardedArt(unsigned shardBits = 4);
+
+  /**
+   * Splits the key space at the given keys.
+   *
+   * @param boundaries - Smallest key of every shard but the first, in
+   * strictly ascending order and not empty.
+   */
+  explicit ShardedArt(std::vector<std::string> boundaries);
+
+  ShardedArt(const ShardedArt &other) = delete;
+  ShardedArt &operator=(const ShardedArt &other) = delete;
+
+  /**
+   * Picks the boundaries that split the given sample of keys into nShards
+   * shards of about the same size. An empty sample gives no boundaries,
+   * i.e. a single shard.
+   */
+  template <class InputIt>
+  static std::vector<std::string> splitSample(InputIt first, InputIt last,
+                                              std::size_t nShards);
+
+  /**
+   * Finds the value associated with the given key.
+   *
+   * @param key - The key to find.
+   * @param keyLen - The length of the key in bytes.
+   * @return the value associated with the key or a default constructed value.
+   */
+  T get(const uint8_t *key, std::size_t keyLen) const;
+  T get(std::string_view key) const;
+  T get(const char *key) const;
+
+  /**
+   * Associates the given key with the given value.
+   *
+   * @param key - The key to associate with the value.
+   * @param keyLen - The length of the key in bytes.
+   * @param value - The value to be associated with the key.
+   * @return the previously associated value or a default constructed value.
+   */
+  T set(const uint8_t *key, std::size_t keyLen, T value);
+  T set(std::string_view key, T value);
+  T set(const char *key, T value);
+
+  /**
+   * Deletes the given key and returns its associated value.
+   *
+   * @param key - The key to delete.
+   * @param keyLen - The length of the key in bytes.
+   * @return the value associated with the key or a default constructed value.
+   */
+  T del(const uint8_t *key, std::size_t keyLen);
+  T del(std::string_view key);
+  T del(const char *key);
+
+  /**
+   * Forward iterator on the keys of all shards in lexicographic order.
+   */
+  class iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = int;
+    using pointer = value_type *;
+
+    iterator() = default;
+
+    value_type operator*();
+    pointer operator->();
+    iterator &operator++();
+    iterator operator++(int);
+    bool operator==(const iterator &rhs) const;
+    bool operator!=(const iterator &rhs) const;
+
+    /**
+     * Key of the current leaf, valid until the iterator moves.
+     */
+    std::string_view key() const;
+
+  private:
+    friend class ShardedArt;
+    iterator(const ShardedArt *tree, std::size_t shard, const uint8_t *key,
+             std::size_t keyLen);
+
+    /**
+     * Moves on to the next shards until one has a key left.
+     */
+    void skipExhausted();
+
+    const ShardedArt *tree_ = nullptr;
+    std::size_t shard_ = 0;
+    /* empty on the end iterator */
+    std::optional<typename Art<T, Allocator>::Snapshot> snapshot_;
+    treeIt<T> it_;
+  };
+
+  /**
+   * Iterator on the smallest key.
+   */
+  iterator begin() const;
+
+  /**
+   * Iterator on the smallest key not less than the provided one.
+   */
+  iterator begin(const uint8_t *key, std::size_t keyLen) const;
+  iterator begin(std::string_view key) const;
+
+  /**
+   * Iterator to the end of the lexicographic order.
+   */
+  iterator end() const;
+
+  /**
+   * Number of shards.
+   */
+  std::size_t nShards() const;
+
+  /**
+   * Index of the shard responsible for the given key.
+   */
+  std::size_t shardOf(const uint8_t *key, std::size_t keyLen) const;
+
+private:
+  struct alignas(64) shard {
+    mutable std::shared_mutex mutex;
+    Art<T, Allocator> tree;
+  };
+
+  /**
+   * Takes a snapshot of the given shard.
+   */
+  typename Art<T, Allocator>::Snapshot snapshot(std::size_t shard) const;
+
+  std::vector<std::string> boundaries_;
+  std::unique_ptr<shard[]> shards_;
+
+  /* keys starting with byte b belong to the shards
+   * [firstShard_[b], lastShard_[b]] */
+  uint32_t firstShard_[256];
+  uint32_t lastShard_[256];
+};
+
+template <typename T, class Allocator>
+ShardedArt<T, Allocator>::ShardedArt(unsigned shardBits)
+    : ShardedArt([shardBits] {
+        if (shardBits > 16) {
+          throw std::invalid_argument("at most 16 shard bits are supported");
+        }
+        /* the boundaries are the leading bits followed by zeros, a trailing
+         * zero byte is left out since the key ending there sorts first */
+        std::vector<std::string> boundaries;
+        for (uint32_t i = 1; i < (1u << shardBits); ++i) {
+          uint32_t bits = i << (16 - shardBits);
+          std::string boundary(1, static_cast<char>(bits >> 8));
+          if (bits & 0xff)
+            boundary.push_back(static_cast<char>(bits & 0xff));
+          boundaries.push_back(boundary);
+        }
+        return boundaries;
+      }()) {}
+
+template <typename T, class Allocator>
+ShardedArt<T, Allocator>::ShardedArt(std::vector<std::string> boundaries)
+    : boundaries_(std::move(boundaries)),
+      shards_(new shard[boundaries_.size() + 1]) {
+  for (std::size_t i = 0; i < boundaries_.size(); ++i) {
+    if (boundaries_[i].empty() ||
+        (i > 0 && boundaries_[i - 1] >= boundaries_[i])) {
+      throw std::invalid_argument(
+          "shard boundaries must be non-empty and strictly ascending");
+    }
+  }
+
+  /* a key starting with b is at least "b" and less than "b + 1" */
+  for (int b = 0; b < 256; ++b) {
+    std::string first(1, static_cast<char>(b));
+    firstShard_[b] =
+        std::upper_bound(boundaries_.begin(), boundaries_.end(), first) -
+        boundaries_.begin();
+    if (b == 255) {
+      lastShard_[b] = boundaries_.size();
+    } else {
+      std::string next(1, static_cast<char>(b + 1));
+      lastShard_[b] =
+          std::lower_bound(boundaries_.begin(), boundaries_.end(), next) -
+          boundaries_.begin();
+    }
+  }
+}
+
+template <typename T, class Allocator>
+template <class InputIt>
+std::vector<std::string>
+ShardedArt<T, Allocator>::splitSample(InputIt first, InputIt last,
+                                      std::size_t nShards) {
+  std::vector<std::string> sample;
+  for (; first != last; ++first)
+    sample.emplace_back(std::string_view(*first));
+  std::sort(sample.begin(), sample.end());
+  sample.erase(std::unique(sample.begin(), sample.end()), sample.end());
+
+  std::vector<std::string> boundaries;
+  if (sample.empty())
+    return boundaries;
+  for (std::size_t i = 1; i < nShards; ++i) {
+    const std::string &boundary = sample[i * sample.size() / nShards];
+    if (!boundary.empty() &&
+        (boundaries.empty() || boundaries.back() < boundary))
+      boundaries.push_back(boundary);
+  }
+  return boundaries;
+}
+
+template <typename T, class Allocator>
+T ShardedArt<T, Allocator>::get(const uint8_t *key,
+                                std::size_t keyLen) const {
+  shard &s = shards_[shardOf(key, keyLen)];
+  std::shared_lock<std::shared_mutex> lock(s.mutex);
+  return s.tree.get(key, keyLen);
+}
+
+template <typename T, class Allocator>
+T ShardedArt<T, Allocator>::get(std::string_view key) const {
+  return get(reinterpret_cast<const uint8_t *>(key.data()), key.size());
+}
+
+template <typename T, class Allocator>
+T ShardedArt<T, Allocator>::get(const char *key) const {
+  return get(std::string_view(key));
+}
+
+template <typename T, class Allocator>
+T ShardedArt<T, Allocator>::set(const uint8_t *key, std::size_t keyLen,
+                                T value) {
+  shard &s = shards_[shardOf(key, keyLen)];
+  std::unique_lock<std::shared_mutex> lock(s.mutex);
+  return s.tree.set(key, keyLen, value);
+}
+
+template <typename T, class Allocator>
+T ShardedArt<T, Allocator>::set(std::string_view key, T value) {
+  return set(reinterpret_cast<const uint8_t *>(key.data()), key.size(),
+             value);
+}
+
+template <typename T, class Allocator>
+T ShardedArt<T, Allocator>::set(const char *key, T value) {
+  return set(std::string_view(key), value);
+}
+
+template <typename T, class Allocator>
+T ShardedArt<T, Allocator>::del(const uint8_t *key, std::size_t keyLen) {
+  shard &s = shards_[shardOf(key, keyLen)];
+  std::unique_lock<std::shared_mutex> lock(s.mutex);
+  return s.tree.del(key, keyLen);
+}
+
+template <typename T, class Allocator>
+T ShardedArt<T, Allocator>::del(std::string_view key) {
+  return del(reinterpret_cast<const uint8_t *>(key.data()), key.size());
+}
+
+template <typename T, class Allocator>
+T ShardedArt<T, Allocator>::del(const char *key) {
+  return del(std::string_view(key));
+}
+
+template <typename T, class Allocator>
+typename ShardedArt<T, Allocator>::iterator
+ShardedArt<T, Allocator>::begin() const {
+  return iterator(this, 0, nullptr, 0);
+}
+
+template <typename T, class Allocator>
+typename ShardedArt<T, Allocator>::iterator
+ShardedArt<T, Allocator>::begin(const uint8_t *key, std::size_t keyLen) const {
+  return iterator(this, shardOf(key, keyLen), key, keyLen);
+}
+
+template <typename T, class Allocator>
+typename ShardedArt<T, Allocator>::iterator
+ShardedArt<T, Allocator>::begin(std::string_view key) const {
+  return begin(reinterpret_cast<const uint8_t *>(key.data()), key.size());
+}
+
+template <typename T, class Allocator>
+typename ShardedArt<T, Allocator>::iterator
+ShardedArt<T, Allocator>::end() const {
+  return iterator();
+}
+
+template <typename T, class Allocator>
+std::size_t ShardedArt<T, Allocator>::nShards() const {
+  return boundaries_.size() + 1;
+}
+
+template <typename T, class Allocator>
+std::size_t ShardedArt<T, Allocator>::shardOf(const uint8_t *key,
+                                              std::size_t keyLen) const {
+  if (keyLen == 0)
+    return 0;
+  uint32_t first = firstShard_[key[0]], last = lastShard_[key[0]];
+  if (first == last)
+    return first;
+
+  /* the shard is the number of boundaries not greater than the key */
+  std::string_view k(reinterpret_cast<const char *>(key), keyLen);
+  return std::upper_bound(boundaries_.begin() + first,
+                          boundaries_.begin() + last, k,
+                          [](std::string_view key, const std::string &b) {
+                            return key < b;
+                          }) -
+         boundaries_.begin();
+}
+
+template <typename T, class Allocator>
+typename Art<T, Allocator>::Snapshot
+ShardedArt<T, Allocator>::snapshot(std::size_t shard) const {
+  /* taking a snapshot modifies the tree's bookkeeping */
+  std::unique_lock<std::shared_mutex> lock(shards_[shard].mutex);
+  return shards_[shard].tree.snapshot();
+}
+
+template <typename T, class Allocator>
+ShardedArt<T, Allocator>::iterator::iterator(const ShardedArt *tree,
+                                             std::size_t shard,
+                                             const uint8_t *key,
+                                             std::size_t keyLen)
+    : tree_(tree), shard_(shard), snapshot_(tree->snapshot(shard)),
+      it_(key != nullptr ? snapshot_->begin(key, keyLen)
+                         : snapshot_->begin()) {
+  skipExhausted();
+}
+
+template <typename T, class Allocator>
+void ShardedArt<T, Allocator>::iterator::skipExhausted() {
+  while (it_ == snapshot_->end()) {
+    if (++shard_ == tree_->nShards()) {
+      *this = iterator();
+      return;
+    }
+    snapshot_ = tree_->snapshot(shard_);
+    it_ = snapshot_->begin();
+  }
+}
+
+template <typename T, class Allocator>
+typename ShardedArt<T, Allocator>::iterator::value_type
+ShardedArt<T, Allocator>::iterator::operator*() {
+  return *it_;
+}
+
+template <typename T, class Allocator>
+typename ShardedArt<T, Allocator>::iterator::pointer
+ShardedArt<T, Allocator>::iterator::operator->() {
+  return it_.operator->();
+}
+
+template <typename T, class Allocator>
+typename ShardedArt<T, Allocator>::iterator &
+ShardedArt<T, Allocator>::iterator::operator++() {
+  ++it_;
+  skipExhausted();
+  return *this;
+}
+
+template <typename T, class Allocator>
+typename ShardedArt<T, Allocator>::iterator
+ShardedArt<T, Allocator>::iterator::operator++(int) {
+  auto old = *this;
+  ++*this;
+  return old;
+}
+
+template <typename T, class Allocator>
+bool ShardedArt<T, Allocator>::iterator::operator==(
+    const iterator &rhs) const {
+  if (!snapshot_ || !rhs.snapshot_)
+    return !snapshot_ && !rhs.snapshot_;
+  return shard_ == rhs.shard_ && it_ == rhs.it_;
+}
+
+template <typename T, class Allocator>
+bool ShardedArt<T, Allocator>::iterator::operator!=(
+    const iterator &rhs) const {
+  return !(*this == rhs);
+}
+
+template <typename T, class Allocator>
+std::string_view ShardedArt<T, Allocator>::iterator::key() const {
+  return it_.key();
+}
+
+} // namespace art
+
+#endif // !ART_SHARDED_ART_HPP
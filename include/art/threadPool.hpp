@@ -0,0 +1,231 @@
+#ifndef ART_THREAD_POOL_HPP
+#define ART_THREAD_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace art {
+
+/**
+ * Work-stealing thread pool for the tree's parallel operations.
+ *
+ * Every worker has its own task deque: tasks spawned by a worker are pushed
+ * to and popped from the back of its deque, which keeps recursively split
+ * work local, while idle workers steal from the front of the others' deques,
+ * i.e. the biggest pieces of work. Tasks are spawned and awaited through a
+ * taskGroup, whose wait() runs pending tasks instead of blocking, so tasks
+ * may spawn and wait for tasks of their own.
+ *
+ *   ThreadPool pool;
+ *   ThreadPool::taskGroup group(pool);
+ *   for (auto &part : parts)
+ *     group.run([&part] { process(part); });
+ *   group.wait();
+ */
+class ThreadPool {
+public:
+  /**
+   * Set of tasks that can be waited for together.
+   */
+  class taskGroup {
+  public:
+    explicit taskGroup(ThreadPool &pool);
+    taskGroup(const taskGroup &other) = delete;
+    taskGroup &operator=(const taskGroup &other) = delete;
+    ~taskGroup();
+
+    /**
+     * Schedules fn() on the pool.
+     */
+    template <class Fn> void run(Fn &&fn);
+
+    /**
+     * Runs tasks until all tasks of the group are done and rethrows the
+     * first exception thrown by one of them.
+     */
+    void wait();
+
+  private:
+    ThreadPool &pool_;
+    std::atomic<std::size_t> pending_{0};
+    std::mutex errorMutex_;
+    std::exception_ptr error_;
+  };
+
+  /**
+   * Starts the given number of workers, one per hardware thread by default.
+   */
+  explicit ThreadPool(std::size_t nThreads = 0);
+  ThreadPool(const ThreadPool &other) = delete;
+  ThreadPool &operator=(const ThreadPool &other) = delete;
+  ~ThreadPool();
+
+  std::size_t nThreads() const;
+
+private:
+  struct alignas(64) queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  void push(std::function<void()> task);
+
+  /**
+   * Runs a task from the calling worker's deque or stolen from another
+   * one.
+   *
+   * @return false if there was no task to run.
+   */
+  bool runOne();
+  void work(std::size_t index);
+
+  /* index of the calling thread's queue, the last one for other threads */
+  std::size_t self() const;
+
+  std::vector<std::thread> threads_;
+  std::size_t nQueues_;
+  std::unique_ptr<queue[]> queues_;
+  std::atomic<std::size_t> nextQueue_{0};
+
+  std::atomic<std::size_t> nQueued_{0};
+  std::mutex sleepMutex_;
+  std::condition_variable wakeUp_;
+  bool stop_ = false;
+
+  static thread_local const ThreadPool *currentPool_;
+  static thread_local std::size_t currentIndex_;
+};
+
+inline thread_local const ThreadPool *ThreadPool::currentPool_ = nullptr;
+inline thread_local std::size_t ThreadPool::currentIndex_ = 0;
+
+inline ThreadPool::taskGroup::taskGroup(ThreadPool &pool) : pool_(pool) {}
+
+inline ThreadPool::taskGroup::~taskGroup() {
+  /* the tasks may refer to the group's scope, they have to finish */
+  while (pending_.load(std::memory_order_acquire) > 0) {
+    if (!pool_.runOne())
+      std::this_thread::yield();
+  }
+}
+
+template <class Fn> void ThreadPool::taskGroup::run(Fn &&fn) {
+  pending_.fetch_add(1, std::memory_order_relaxed);
+  pool_.push([this, fn = std::forward<Fn>(fn)]() mutable {
+    try {
+      fn();
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(errorMutex_);
+      if (!error_)
+        error_ = std::current_exception();
+    }
+    pending_.fetch_sub(1, std::memory_order_release);
+  });
+}
+
+inline void ThreadPool::taskGroup::wait() {
+  while (pending_.load(std::memory_order_acquire) > 0) {
+    if (!pool_.runOne())
+      std::this_thread::yield();
+  }
+  std::lock_guard<std::mutex> lock(errorMutex_);
+  if (error_) {
+    std::exception_ptr error = std::exchange(error_, nullptr);
+    std::rethrow_exception(error);
+  }
+}
+
+inline ThreadPool::ThreadPool(std::size_t nThreads)
+    : nQueues_((nThreads != 0
+                    ? nThreads
+                    : std::max(1u, std::thread::hardware_concurrency())) +
+               1),
+      queues_(new queue[nQueues_]) {
+  for (std::size_t i = 0; i + 1 < nQueues_; ++i)
+    threads_.emplace_back([this, i] { work(i); });
+}
+
+inline ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex_);
+    stop_ = true;
+  }
+  wakeUp_.notify_all();
+  for (std::thread &thread : threads_)
+    thread.join();
+}
+
+inline std::size_t ThreadPool::nThreads() const { return threads_.size(); }
+
+inline void ThreadPool::push(std::function<void()> task) {
+  /* tasks of threads outside of the pool are spread over the workers */
+  std::size_t index = self();
+  if (index == nQueues_ - 1)
+    index = nextQueue_.fetch_add(1, std::memory_order_relaxed) %
+            (nQueues_ - 1);
+  {
+    std::lock_guard<std::mutex> lock(queues_[index].mutex);
+    queues_[index].tasks.push_back(std::move(task));
+  }
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex_);
+    nQueued_.fetch_add(1, std::memory_order_relaxed);
+  }
+  wakeUp_.notify_one();
+}
+
+inline bool ThreadPool::runOne() {
+  std::function<void()> task;
+  std::size_t index = self();
+  for (std::size_t i = 0; i < nQueues_ && !task; ++i) {
+    queue &q = queues_[(index + i) % nQueues_];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.tasks.empty())
+      continue;
+    if (i == 0) {
+      task = std::move(q.tasks.back());
+      q.tasks.pop_back();
+    } else {
+      task = std::move(q.tasks.front());
+      q.tasks.pop_front();
+    }
+  }
+  if (!task)
+    return false;
+  nQueued_.fetch_sub(1, std::memory_order_relaxed);
+  task();
+  return true;
+}
+
+inline void ThreadPool::work(std::size_t index) {
+  currentPool_ = this;
+  currentIndex_ = index;
+  while (true) {
+    if (runOne())
+      continue;
+    std::unique_lock<std::mutex> lock(sleepMutex_);
+    wakeUp_.wait(lock, [this] {
+      return stop_ || nQueued_.load(std::memory_order_relaxed) > 0;
+    });
+    if (stop_)
+      return;
+  }
+}
+
+inline std::size_t ThreadPool::self() const {
+  return currentPool_ == this ? currentIndex_ : nQueues_ - 1;
+}
+
+} // namespace art
+
+#endif // !ART_THREAD_POOL_HPP
@@ -1,45 +1,43 @@
-#ifndef ART_treeIt_HPP
-#define ART_treeIt_HPP
+#ifndef ART_TREE_IT_HPP
+#define ART_TREE_IT_HPP
 
 #include "childIt.hpp"
+#include "innerNode.hpp"
+#include "leafNode.hpp"
 #include "node.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <string>
-namespace art {
+#include <string_view>
+#include <vector>
 
-template <typename T> class node;
-template <typename T> class inner_node;
-template <typename T> class leaf_node;
+namespace art {
 
+/**
+ * Bidirectional iterator on the leaves of a tree in lexicographic order of
+ * their keys. Moving before the first leaf or after the last one yields the
+ * end iterator.
+ *
+ * The iterator keeps the inner nodes on the path to the current leaf in a
+ * stack of frames, the first inlineFrames of which are stored inline, and
+ * the key bytes of that path in a single buffer that is truncated and
+ * appended to as the iterator moves up and down. Once the buffer has grown
+ * to the longest path, iterating performs no allocations.
+ */
 template <typename T> class treeIt {
 public:
-  struct step {
-    Node<T> *childNode_;
-    int depth_;
-    char *key_;
-    childIt<T> childIt_;
-    childIt<T> childItEnd_;
-
-    step();
-    step(int depth, childIt<T> c_it, childIt<T> c_it_end);
-    step(node<T> *node, int depth, const char *key, childIt<T> c_it,
-         childIt<T> c_it_end);
-    step(const step &other);
-    step(step &&other);
-    ~step();
-
-    step &operator=(const step &other);
-    step &operator=(step &&other) noexcept;
-    step &operator++();
-    step operator++(int);
-  };
-
   treeIt();
-  explicit treeIt(node<T> *root, std::vector<step> traversal_stack);
 
-  static treeIt<T> min(node<T> *root);
-  static treeIt<T> greater_equal(node<T> *root, const char *key);
+  static treeIt<T> min(Node<T> *root);
+  static treeIt<T> max(Node<T> *root);
+  static treeIt<T> greaterEqual(Node<T> *root, const uint8_t *key,
+                                int keyLen);
+  static treeIt<T> lessEqual(Node<T> *root, const uint8_t *key, int keyLen);
 
-  using iterator_category = std::forward_iterator_tag;
+  using iterator_category = std::bidirectional_iterator_tag;
   using value_type = T;
   using difference_type = int;
   using pointer = value_type *;
@@ -48,200 +46,312 @@ public:
   pointer operator->();
   treeIt<T> &operator++();
   treeIt<T> operator++(int);
+  treeIt<T> &operator--();
+  treeIt<T> operator--(int);
   bool operator==(const treeIt<T> &rhs) const;
   bool operator!=(const treeIt<T> &rhs) const;
 
   template <typename OutputIt> void key(OutputIt key) const;
-  int get_key_len() const;
-  const std::string key() const;
+  int getKeyLen() const;
+
+  /**
+   * Key of the current leaf. The view refers to the leaf or to the
+   * iterator's key buffer and is valid until the iterator moves.
+   */
+  std::string_view key() const;
+
+  /* frames stored inside the iterator, deeper paths spill to the heap */
+  static constexpr std::size_t inlineFrames = 24;
 
 private:
-  step &getStep();
-  const step &getStep() const;
-  node<T> *getNode() const;
-  const char *getKey() const;
-  int getDepth() const;
+  /* inner node on the path to the current leaf, the key buffer holds depth
+   * bytes before its prefix */
+  struct frame {
+    innerNode<T> *node;
+    childIt<T> it;
+    childIt<T> itEnd;
+    int depth;
+  };
 
-  void seek_leaf();
+  class frameStack {
+  public:
+    bool empty() const { return size_ == 0; }
+    std::size_t size() const { return size_; }
+    frame &back() { return (*this)[size_ - 1]; }
+    const frame &back() const { return (*this)[size_ - 1]; }
+    void push_back(const frame &f);
+    void pop_back();
+
+  private:
+    frame &operator[](std::size_t i);
+    const frame &operator[](std::size_t i) const;
+
+    frame inline_[inlineFrames];
+    std::vector<frame> spilled_;
+    std::size_t size_ = 0;
+  };
 
-  node<T> *root_;
-  std::vector<step> traversalStack_;
+  explicit treeIt(Node<T> *root);
+
+  /**
+   * Appends the prefix of the given node to the key buffer, which holds
+   * the bytes leading to the node.
+   */
+  void appendPrefix(innerNode<T> *node);
+
+  /**
+   * Pushes a frame on the given child of the given node and appends its
+   * partial key. The key buffer must hold the bytes through the node's
+   * prefix.
+   */
+  void pushFrame(innerNode<T> *node, int depth, childIt<T> cIt);
+
+  /**
+   * Moves to the smallest leaf of the given subtree, whose path the key
+   * buffer holds.
+   */
+  void descendMin(Node<T> *node);
+
+  /**
+   * Moves to the greatest leaf of the given subtree, whose path the key
+   * buffer holds.
+   */
+  void descendMax(Node<T> *node);
+
+  /**
+   * Moves to the smallest leaf after the current child of the top frame.
+   */
+  void advance();
+
+  /**
+   * Moves to the greatest leaf before the current child of the top frame.
+   */
+  void retreat();
+
+  Node<T> *root_ = nullptr;
+  /* current leaf, a null pointer at the end */
+  Node<T> *leaf_ = nullptr;
+  frameStack frames_;
+  std::string key_;
+
+  /* copy of the current value if it is embedded in its slot */
+  T embedded_;
 };
 
 template <class T>
-treeIt<T>::step::step() : step(nullptr, 0, nullptr, {}, {}) {}
+void treeIt<T>::frameStack::push_back(const treeIt<T>::frame &f) {
+  if (size_ < inlineFrames)
+    inline_[size_] = f;
+  else
+    spilled_.push_back(f);
+  ++size_;
+}
 
-template <class T>
-treeIt<T>::step::step(int depth, childIt<T> c_it, childIt<T> c_it_end)
-    : childNode_(c_it != c_it_end ? c_it.get_child_node() : nullptr),
-      depth_(depth), key_(depth ? new char[depth] : nullptr), childIt_(c_it),
-      childItEnd_(c_it_end) {}
+template <class T> void treeIt<T>::frameStack::pop_back() {
+  assert(size_ > 0);
+  if (--size_ >= inlineFrames)
+    spilled_.pop_back();
+}
 
 template <class T>
-treeIt<T>::step::step(node<T> *node, int depth, const char *key,
-                      childIt<T> c_it, childIt<T> c_it_end)
-    : childNode_(node), depth_(depth), key_(depth ? new char[depth] : nullptr),
-      childIt_(c_it), childItEnd_(c_it_end) {
-  std::copy_n(key, depth, key_);
+typename treeIt<T>::frame &treeIt<T>::frameStack::operator[](std::size_t i) {
+  return i < inlineFrames ? inline_[i] : spilled_[i - inlineFrames];
 }
 
-template <class T> typename treeIt<T>::step &treeIt<T>::step::operator++() {
-  assert(childIt_ != childItEnd_);
-  ++childIt_;
-  childNode_ = childIt_ != childItEnd_ ? childIt_.get_child_node() : nullptr;
-  key_[depth_ - 1] =
-      childIt_ != childItEnd_ ? childIt_.get_partial_key() : '\0';
-  return *this;
+template <class T>
+const typename treeIt<T>::frame &
+treeIt<T>::frameStack::operator[](std::size_t i) const {
+  return i < inlineFrames ? inline_[i] : spilled_[i - inlineFrames];
 }
 
-template <class T> typename treeIt<T>::step treeIt<T>::step::operator++(int) {
-  auto old = *this;
-  operator++();
-  return old;
-}
+template <class T> treeIt<T>::treeIt() : embedded_() {}
 
 template <class T>
-treeIt<T>::step::step(const treeIt<T>::step &other)
-    : step(other.childNode_, other.depth_, other.key_, other.childIt_,
-           other.childItEnd_) {}
+treeIt<T>::treeIt(Node<T> *root) : root_(root), embedded_() {}
 
-template <class T>
-treeIt<T>::step::step(treeIt<T>::step &&other)
-    : childNode_(other.childNode_), depth_(other.depth_), key_(other.key_),
-      childIt_(other.childIt_), childItEnd_(other.childIt_) {
-  other.childNode_ = nullptr;
-  other.depth_ = 0;
-  other.key_ = nullptr;
-  other.childIt_ = {};
-  other.childItEnd_ = {};
+template <class T> treeIt<T> treeIt<T>::min(Node<T> *root) {
+  treeIt<T> it(root);
+  if (root != nullptr)
+    it.descendMin(root);
+  return it;
 }
 
-template <class T> treeIt<T>::step::~step() { delete[] key_; }
-
-template <class T>
-typename treeIt<T>::step &
-treeIt<T>::step::operator=(const treeIt<T>::step &other) {
-  if (this != &other) {
-    node<T> *node = other.childNode_;
-    int depth = other.depth_;
-    char *key = depth ? new char[depth] : nullptr;
-    std::copy_n(other.key_, other.depth_, key);
-    childIt<T> c_it = other.childIt_;
-    childIt<T> c_it_end = other.childItEnd_;
-
-    childNode_ = node;
-    depth_ = depth;
-    delete[] key_;
-    key_ = key;
-    childIt_ = c_it;
-    childItEnd_ = c_it_end;
-  }
-  return *this;
+template <class T> treeIt<T> treeIt<T>::max(Node<T> *root) {
+  treeIt<T> it(root);
+  if (root != nullptr)
+    it.descendMax(root);
+  return it;
 }
 
 template <class T>
-typename treeIt<T>::step &
-treeIt<T>::step::operator=(treeIt<T>::step &&other) noexcept {
-  if (this != &other) {
-    childNode_ = other.child_node_;
-    other.childNode_ = nullptr;
-
-    depth_ = other.depth_;
-    other.depth_ = 0;
+treeIt<T> treeIt<T>::greaterEqual(Node<T> *root, const uint8_t *key,
+                                  int keyLen) {
+  treeIt<T> it(root);
+  Node<T> *node = root;
+  while (node != nullptr) {
+    if (isLeaf(node)) {
+      /* the leaf was reached through the search key's bytes, compare the
+       * rest of its key */
+      it.leaf_ = node;
+      std::string_view leafKey = it.key();
+      if (std::lexicographical_compare(leafKey.begin(), leafKey.end(), key,
+                                       key + keyLen, [](char a, uint8_t b) {
+                                         return static_cast<uint8_t>(a) < b;
+                                       })) {
+        it.advance();
+      }
+      return it;
+    }
 
-    delete[] key_;
-    key_ = other.key_;
-    other.key_ = nullptr;
+    auto curInner = static_cast<innerNode<T> *>(node);
+    int curDepth = it.key_.size();
+    it.appendPrefix(curInner);
+    const uint8_t *prefix =
+        reinterpret_cast<const uint8_t *>(it.key_.data()) + curDepth;
+    int prefixLen = curInner->prefixLen_;
+    int prefixMatchLen = 0;
+    while (prefixMatchLen < prefixLen && curDepth + prefixMatchLen < keyLen &&
+           key[curDepth + prefixMatchLen] == prefix[prefixMatchLen])
+      ++prefixMatchLen;
+
+    int depth = curDepth + prefixLen;
+    if (prefixMatchLen < prefixLen || depth == keyLen) {
+      if (prefixMatchLen < prefixLen && curDepth + prefixMatchLen < keyLen &&
+          key[curDepth + prefixMatchLen] > prefix[prefixMatchLen]) {
+        /* the search key is greater than the whole subtree */
+        it.key_.resize(curDepth);
+        it.advance();
+      } else {
+        /* the search key is at most the subtree's smallest key */
+        it.key_.resize(curDepth);
+        it.descendMin(curInner);
+      }
+      return it;
+    }
 
-    childIt_ = other.childIt_;
-    other.childIt_ = {};
+    // seek subtree where search key is "lesser than or equal" the subtree
+    // partial key, the leaf slot holds a key that is smaller
+    childIt<T> cIt = curInner->begin();
+    childIt<T> cItEnd = curInner->end();
+    if (cIt != cItEnd && cIt.isLeafSlot()) {
+      ++cIt;
+    }
+    for (; cIt != cItEnd && cIt.getPartialKey() < key[depth]; ++cIt) {
+    }
+    if (cIt == cItEnd) {
+      it.key_.resize(curDepth);
+      it.advance();
+      return it;
+    }
 
-    childItEnd_ = other.childItEnd_;
-    other.childItEnd_ = {};
+    it.pushFrame(curInner, curDepth, cIt);
+    node = cIt.getChildNode();
+    if (cIt.getPartialKey() != key[depth]) {
+      it.descendMin(node);
+      return it;
+    }
   }
-  return *this;
+  return it;
 }
 
-template <class T> treeIt<T>::treeIt() {}
-
 template <class T>
-treeIt<T>::treeIt(node<T> *root, std::vector<step> traversal_stack)
-    : root_(root), traversalStack_(traversal_stack) {
-  seek_leaf();
-}
-
-template <class T> treeIt<T> treeIt<T>::min(node<T> *root) {
-  return treeIt<T>::greater_equal(root, "");
-}
+treeIt<T> treeIt<T>::lessEqual(Node<T> *root, const uint8_t *key,
+                               int keyLen) {
+  treeIt<T> it(root);
+  Node<T> *node = root;
+  while (node != nullptr) {
+    if (isLeaf(node)) {
+      /* the leaf was reached through the search key's bytes, compare the
+       * rest of its key */
+      it.leaf_ = node;
+      std::string_view leafKey = it.key();
+      if (std::lexicographical_compare(key, key + keyLen, leafKey.begin(),
+                                       leafKey.end(), [](uint8_t a, char b) {
+                                         return a < static_cast<uint8_t>(b);
+                                       })) {
+        it.retreat();
+      }
+      return it;
+    }
 
-template <class T>
-treeIt<T> treeIt<T>::greater_equal(node<T> *root, const char *key) {
-  assert(root != nullptr);
-
-  int key_len = std::strlen(key);
-  std::vector<treeIt<T>::step> traversal_stack;
-
-  // sentinel child iterator for root
-  traversal_stack.push_back({root, 0, nullptr, {nullptr, -2}, {nullptr, -1}});
-
-  while (true) {
-    treeIt<T>::step &cur_step = traversal_stack.back();
-    node<T> *cur_node = cur_step.childNode_;
-    int cur_depth = cur_step.depth_;
-
-    int prefix_match_len = std::min<int>(
-        cur_node->check_prefix(key + cur_depth, key_len - cur_depth),
-        key_len - cur_depth);
-    // if search key "equals" the prefix
-    if (key_len == cur_depth + prefix_match_len) {
-      return treeIt<T>(root, traversal_stack);
+    auto curInner = static_cast<innerNode<T> *>(node);
+    int curDepth = it.key_.size();
+    it.appendPrefix(curInner);
+    const uint8_t *prefix =
+        reinterpret_cast<const uint8_t *>(it.key_.data()) + curDepth;
+    int prefixLen = curInner->prefixLen_;
+    int prefixMatchLen = 0;
+    while (prefixMatchLen < prefixLen && curDepth + prefixMatchLen < keyLen &&
+           key[curDepth + prefixMatchLen] == prefix[prefixMatchLen])
+      ++prefixMatchLen;
+
+    if (prefixMatchLen < prefixLen) {
+      bool greater = curDepth + prefixMatchLen < keyLen &&
+                     key[curDepth + prefixMatchLen] > prefix[prefixMatchLen];
+      it.key_.resize(curDepth);
+      if (greater) {
+        /* the search key is greater than the whole subtree */
+        it.descendMax(curInner);
+      } else {
+        /* the search key is smaller than the subtree's smallest key */
+        it.retreat();
+      }
+      return it;
     }
-    // if search key is "greater than" the prefix
-    if (prefix_match_len < cur_node->prefix_len_ &&
-        key[cur_depth + prefix_match_len] >
-            cur_node->prefix_[prefix_match_len]) {
-      ++cur_step;
-      return treeIt<T>(root, traversal_stack);
+
+    // seek the last entry whose keys are "lesser than or equal" the search
+    // key, the leaf slot holds the key that ends at the node
+    int depth = curDepth + prefixLen;
+    childIt<T> cIt = curInner->begin();
+    childIt<T> cItEnd = curInner->end();
+    bool exact = false;
+    if (depth == keyLen) {
+      exact = cIt != cItEnd && cIt.isLeafSlot();
+      if (!exact)
+        --cIt;
+    } else {
+      if (cIt != cItEnd && cIt.isLeafSlot()) {
+        ++cIt;
+      }
+      for (; cIt != cItEnd && cIt.getPartialKey() < key[depth]; ++cIt) {
+      }
+      exact = cIt != cItEnd && cIt.getPartialKey() == key[depth];
+      if (!exact)
+        --cIt;
     }
-    if (cur_node->is_leaf()) {
-      continue;
+    if (cIt == childIt<T>(curInner, -1)) {
+      it.key_.resize(curDepth);
+      it.retreat();
+      return it;
     }
-    // seek subtree where search key is "lesser than or equal" the subtree
-    // partial key
-    inner_node<T> *cur_inner_node = static_cast<inner_node<T> *>(cur_node);
-    childIt<T> c_it = cur_inner_node->begin();
-    childIt<T> c_it_end = cur_inner_node->end();
-    // TODO more efficient with specialized node search method?
-    for (; c_it != c_it_end; ++c_it) {
-      if (key[cur_depth + cur_node->prefix_len_] <= c_it.get_partial_key()) {
-        break;
-      }
+
+    it.pushFrame(curInner, curDepth, cIt);
+    node = cIt.getChildNode();
+    if (!exact) {
+      it.descendMax(node);
+      return it;
     }
-    int depth = cur_depth + cur_node->prefix_len_ + 1;
-    treeIt<T>::step child(depth, c_it, c_it_end);
-    /* compute child key: cur_key + cur_node->prefix_ + child_partial_key */
-    std::copy_n(cur_step.key_, cur_depth, child.key_);
-    std::copy_n(cur_node->prefix_, cur_node->prefix_len_,
-                child.key_ + cur_depth);
-    child.key_[cur_depth + cur_node->prefix_len_] = c_it.get_partial_key();
-    traversal_stack.push_back(child);
   }
+  return it;
 }
 
 template <class T> typename treeIt<T>::value_type treeIt<T>::operator*() {
-  assert(getNode()->is_leaf());
-  return static_cast<leaf_node<T> *>(getNode())->value_;
+  assert(leaf_ != nullptr);
+  return leafValue(leaf_);
 }
 
 template <class T> typename treeIt<T>::pointer treeIt<T>::operator->() {
-  assert(getNode()->is_leaf());
-  return &static_cast<leaf_node<T> *>(getNode())->value_;
+  assert(leaf_ != nullptr);
+  if (isEmbedded(leaf_)) {
+    embedded_ = leafValue(leaf_);
+    return &embedded_;
+  }
+  return &asLeaf(leaf_)->value;
 }
 
 template <class T> treeIt<T> &treeIt<T>::operator++() {
-  assert(getNode()->is_leaf());
-  ++getStep();
-  seek_leaf();
+  assert(leaf_ != nullptr);
+  advance();
   return *this;
 }
 
@@ -251,16 +361,28 @@ template <class T> treeIt<T> treeIt<T>::operator++(int) {
   return old;
 }
 
+template <class T> treeIt<T> &treeIt<T>::operator--() {
+  assert(leaf_ != nullptr);
+  retreat();
+  return *this;
+}
+
+template <class T> treeIt<T> treeIt<T>::operator--(int) {
+  auto old = *this;
+  operator--();
+  return old;
+}
+
 template <class T> bool treeIt<T>::operator==(const treeIt<T> &rhs) const {
-  if (traversalStack_.empty() && rhs.traversalStack_.empty()) {
-    /* both are empty */
-    return true;
+  if (leaf_ == nullptr || rhs.leaf_ == nullptr) {
+    /* at most one of them is not at the end */
+    return leaf_ == rhs.leaf_;
   }
-  if (traversalStack_.empty() || rhs.traversalStack_.empty()) {
-    /* one is empty */
+  if (leaf_ != rhs.leaf_ || frames_.size() != rhs.frames_.size()) {
     return false;
   }
-  return getNode() == rhs.getNode();
+  /* embedded values are identified by their slot rather than the node */
+  return frames_.empty() || frames_.back().it == rhs.frames_.back().it;
 }
 
 template <class T> bool treeIt<T>::operator!=(const treeIt<T> &rhs) const {
@@ -270,67 +392,107 @@ template <class T> bool treeIt<T>::operator!=(const treeIt<T> &rhs) const {
 template <class T>
 template <class OutputIt>
 void treeIt<T>::key(OutputIt key) const {
-  std::copy_n(getKey(), getDepth(), key);
-  std::copy_n(getNode()->prefix_, getNode()->prefix_len_, key + getDepth());
+  std::string_view k = this->key();
+  std::copy(k.begin(), k.end(), key);
 }
 
-template <class T> int treeIt<T>::get_key_len() const {
-  return getDepth() + getNode()->prefix_len_;
+template <class T> int treeIt<T>::getKeyLen() const {
+  return static_cast<int>(key().size());
 }
 
-template <class T> const std::string treeIt<T>::key() const {
-  std::string str(getDepth() + getNode()->prefix_len_ - 1, 0);
-  key(str.begin());
-  return str;
-}
-
-template <class T> void treeIt<T>::seek_leaf() {
-  /* traverse up until a node on the right is found or stack gets empty */
-  for (; getStep().childIt_ == getStep().childIt_; ++getStep()) {
-    traversalStack_.pop_back();
-    if (getStep().childNode_ == root_) { // root guard
-      traversalStack_.pop_back();
-      assert(traversalStack_.empty());
-      return;
-    }
+template <class T> std::string_view treeIt<T>::key() const {
+  assert(leaf_ != nullptr);
+  if (isEmbedded(leaf_)) {
+    /* the path spells the key, the leaf slot adds no partial key */
+    return key_;
   }
+  return std::string_view(reinterpret_cast<const char *>(asLeaf(leaf_)->key()),
+                          asLeaf(leaf_)->keyLen_);
+}
 
-  /* find leftmost leaf node */
-  while (!getNode()->is_leaf()) {
-    inner_node<T> *cur_inner_node = static_cast<inner_node<T> *>(getNode());
-    int depth = getDepth() + getNode()->prefix_len_ + 1;
-    childIt<T> c_it = cur_inner_node->begin();
-    childIt<T> c_it_end = cur_inner_node->end();
-    treeIt<T>::step child(depth, c_it, c_it_end);
-    /* compute child key: cur_key + cur_node->prefix_ + child_partial_key */
-    std::copy_n(getKey(), getDepth(), child.key_);
-    std::copy_n(getNode()->prefix_, getNode()->prefix_len_,
-                child.key_ + getDepth());
-    child.key_[getDepth() + getNode()->prefix_len_] = c_it.get_partial_key();
-    traversalStack_.push_back(child);
-  }
+template <class T> void treeIt<T>::appendPrefix(innerNode<T> *node) {
+  /* bytes of the prefix that are not stored inline are taken from a leaf
+   * below the node */
+  const uint8_t *prefix = node->prefixLen_ <= Node<T>::maxPrefixLen
+                              ? node->prefix_
+                              : node->minLeaf()->key() + key_.size();
+  key_.append(reinterpret_cast<const char *>(prefix), node->prefixLen_);
 }
 
-template <class T> node<T> *treeIt<T>::getNode() const {
-  return getStep().childNode_;
+template <class T>
+void treeIt<T>::pushFrame(innerNode<T> *node, int depth, childIt<T> cIt) {
+  frames_.push_back({node, cIt, node->end(), depth});
+  if (!cIt.isLeafSlot())
+    key_.push_back(static_cast<char>(cIt.getPartialKey()));
 }
 
-template <class T> int treeIt<T>::getDepth() const { return getStep().depth_; }
+template <class T> void treeIt<T>::descendMin(Node<T> *node) {
+  /* find leftmost leaf node */
+  while (!isLeaf(node)) {
+    auto inner = static_cast<innerNode<T> *>(node);
+    int depth = key_.size();
+    appendPrefix(inner);
+    childIt<T> cIt = inner->begin();
+    assert(cIt != inner->end());
+    pushFrame(inner, depth, cIt);
+    node = cIt.getChildNode();
+  }
+  leaf_ = node;
+}
 
-template <class T> const char *treeIt<T>::getKey() const {
-  return getStep().key_;
+template <class T> void treeIt<T>::descendMax(Node<T> *node) {
+  /* find rightmost leaf node */
+  while (!isLeaf(node)) {
+    auto inner = static_cast<innerNode<T> *>(node);
+    int depth = key_.size();
+    appendPrefix(inner);
+    childIt<T> cIt = inner->end();
+    assert(cIt != inner->begin());
+    pushFrame(inner, depth, --cIt);
+    node = cIt.getChildNode();
+  }
+  leaf_ = node;
 }
 
-template <class T> typename treeIt<T>::step &treeIt<T>::getStep() {
-  assert(!traversalStack_.empty());
-  return traversalStack_.back();
+template <class T> void treeIt<T>::advance() {
+  /* traverse up until a node on the right is found or the stack gets
+   * empty */
+  while (!frames_.empty()) {
+    frame &f = frames_.back();
+    ++f.it;
+    if (f.it != f.itEnd) {
+      key_.resize(f.depth + f.node->prefixLen_);
+      key_.push_back(static_cast<char>(f.it.getPartialKey()));
+      descendMin(f.it.getChildNode());
+      return;
+    }
+    key_.resize(f.depth);
+    frames_.pop_back();
+  }
+  leaf_ = nullptr;
+  key_.clear();
 }
 
-template <class T> const typename treeIt<T>::step &treeIt<T>::getStep() const {
-  assert(!traversalStack_.empty());
-  return traversalStack_.back();
+template <class T> void treeIt<T>::retreat() {
+  /* traverse up until a node on the left is found or the stack gets
+   * empty */
+  while (!frames_.empty()) {
+    frame &f = frames_.back();
+    --f.it;
+    if (f.it != childIt<T>(f.node, -1)) {
+      key_.resize(f.depth + f.node->prefixLen_);
+      if (!f.it.isLeafSlot())
+        key_.push_back(static_cast<char>(f.it.getPartialKey()));
+      descendMax(f.it.getChildNode());
+      return;
+    }
+    key_.resize(f.depth);
+    frames_.pop_back();
+  }
+  leaf_ = nullptr;
+  key_.clear();
 }
 
 } // namespace art
 
-#endif // !ART_treeIt_HPP
+#endif // !ART_TREE_IT_HPP
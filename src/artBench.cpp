@@ -0,0 +1,250 @@
+#include "../include/art.hpp"
+#include "workload.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <malloc.h>
+#include <map>
+#include <new>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using std::string;
+
+/* heap bytes in use, kept by the replaced operator new and delete so that
+ * every container is measured the same way, key strings included */
+static std::size_t heapBytes = 0;
+
+void *operator new(std::size_t size) {
+  void *p = std::malloc(size != 0 ? size : 1);
+  if (p == nullptr)
+    throw std::bad_alloc();
+  heapBytes += malloc_usable_size(p);
+  return p;
+}
+
+void operator delete(void *p) noexcept {
+  if (p != nullptr) {
+    heapBytes -= malloc_usable_size(p);
+    std::free(p);
+  }
+}
+
+void operator delete(void *p, std::size_t) noexcept { operator delete(p); }
+
+/* sink for the values read, so that the lookups are not optimized away */
+static volatile uint64_t checksum = 0;
+
+/**
+ * The containers compared, behind a common interface. Ordered containers
+ * support seek(), which reads the values of the n keys from the given one.
+ */
+struct artTree {
+  static constexpr const char *name = "art";
+  static constexpr bool ordered = true;
+
+  void insert(const string &key, uint64_t value) { m.set(key, value); }
+  uint64_t get(const string &key) { return m.get(key); }
+  void del(const string &key) { m.del(key); }
+
+  uint64_t iterate() {
+    uint64_t sum = 0;
+    for (auto it = m.begin(), itEnd = m.end(); it != itEnd; ++it) {
+      sum += *it;
+    }
+    return sum;
+  }
+
+  uint64_t seek(const string &key, int n) {
+    uint64_t sum = 0;
+    for (auto it = m.begin(key), itEnd = m.end(); n > 0 && it != itEnd;
+         ++it, --n) {
+      sum += *it;
+    }
+    return sum;
+  }
+
+  art::Art<uint64_t> m;
+};
+
+struct mapTree {
+  static constexpr const char *name = "std::map";
+  static constexpr bool ordered = true;
+
+  void insert(const string &key, uint64_t value) { m[key] = value; }
+  uint64_t get(const string &key) { return m.find(key)->second; }
+  void del(const string &key) { m.erase(key); }
+
+  uint64_t iterate() {
+    uint64_t sum = 0;
+    for (const auto &e : m) {
+      sum += e.second;
+    }
+    return sum;
+  }
+
+  uint64_t seek(const string &key, int n) {
+    uint64_t sum = 0;
+    for (auto it = m.lower_bound(key); n > 0 && it != m.end(); ++it, --n) {
+      sum += it->second;
+    }
+    return sum;
+  }
+
+  std::map<string, uint64_t> m;
+};
+
+struct unorderedTree {
+  static constexpr const char *name = "std::unordered_map";
+  static constexpr bool ordered = false;
+
+  void insert(const string &key, uint64_t value) { m[key] = value; }
+  uint64_t get(const string &key) { return m.find(key)->second; }
+  void del(const string &key) { m.erase(key); }
+
+  uint64_t iterate() {
+    uint64_t sum = 0;
+    for (const auto &e : m) {
+      sum += e.second;
+    }
+    return sum;
+  }
+
+  uint64_t seek(const string &, int) { return 0; }
+
+  std::unordered_map<string, uint64_t> m;
+};
+
+/**
+ * Measures, for one container on one set of keys, the throughput of
+ * inserting the keys, of looking them up in uniform order and in Zipf
+ * order, of iterating over them, of seeking to a key and reading the next
+ * ten and of deleting the keys, along with the heap bytes per key once the
+ * keys are inserted. Throughputs are in millions of operations per second.
+ */
+template <class Tree>
+void art_bench_run(const char *dataset, const std::vector<string> &keys,
+                   const std::vector<uint32_t> &uniform,
+                   const std::vector<uint32_t> &zipf, int rounds) {
+  using clock = std::chrono::steady_clock;
+  std::chrono::duration<double> insertElapsed(0), getElapsed(0),
+      zipfElapsed(0), iterateElapsed(0), seekElapsed(0), delElapsed(0);
+  const std::size_t nSeeks = std::min<std::size_t>(uniform.size(), 100000);
+  std::size_t bytes = 0;
+  uint64_t sum = 0;
+  for (int r = 0; r < rounds; ++r) {
+    std::size_t heapBefore = heapBytes;
+    Tree t;
+    auto start = clock::now();
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      t.insert(keys[i], i);
+    }
+    insertElapsed += clock::now() - start;
+    bytes = heapBytes - heapBefore;
+
+    start = clock::now();
+    for (uint32_t i : uniform) {
+      sum += t.get(keys[i]);
+    }
+    getElapsed += clock::now() - start;
+
+    start = clock::now();
+    for (uint32_t i : zipf) {
+      sum += t.get(keys[i]);
+    }
+    zipfElapsed += clock::now() - start;
+
+    start = clock::now();
+    sum += t.iterate();
+    iterateElapsed += clock::now() - start;
+
+    start = clock::now();
+    for (std::size_t i = 0; Tree::ordered && i < nSeeks; ++i) {
+      sum += t.seek(keys[uniform[i]], 10);
+    }
+    seekElapsed += clock::now() - start;
+
+    start = clock::now();
+    for (uint32_t i : uniform) {
+      t.del(keys[i]);
+    }
+    delElapsed += clock::now() - start;
+  }
+  checksum = checksum + sum;
+
+  auto mops = [&](std::size_t n, std::chrono::duration<double> elapsed) {
+    return n * rounds / elapsed.count() / 1e6;
+  };
+  std::cout << std::left << std::setw(10) << dataset << std::setw(20)
+            << Tree::name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(9) << mops(keys.size(), insertElapsed)
+            << std::setw(9) << mops(uniform.size(), getElapsed)
+            << std::setw(9) << mops(zipf.size(), zipfElapsed)
+            << std::setw(9) << mops(keys.size(), iterateElapsed);
+  if (Tree::ordered) {
+    std::cout << std::setw(9) << mops(nSeeks, seekElapsed);
+  } else {
+    std::cout << std::setw(9) << "-";
+  }
+  std::cout << std::setw(9) << mops(keys.size(), delElapsed) << std::setw(11)
+            << std::setprecision(1) << static_cast<double>(bytes) / keys.size()
+            << std::endl;
+}
+
+/**
+ * Runs every container on the given keys, looked up in a shuffled order
+ * and in a Zipf distributed order whose popular keys are spread over the
+ * key space.
+ */
+void art_bench_dataset(const char *dataset, const std::vector<string> &keys,
+                       int rounds) {
+  std::vector<uint32_t> uniform(keys.size());
+  for (std::size_t i = 0; i < uniform.size(); ++i) {
+    uniform[i] = i;
+  }
+  std::mt19937_64 rng(3);
+  std::shuffle(uniform.begin(), uniform.end(), rng);
+  zipfian ranks(keys.size());
+  std::vector<uint32_t> zipf(keys.size());
+  for (auto &i : zipf) {
+    i = uniform[ranks(rng)];
+  }
+
+  art_bench_run<artTree>(dataset, keys, uniform, zipf, rounds);
+  art_bench_run<mapTree>(dataset, keys, uniform, zipf, rounds);
+  art_bench_run<unorderedTree>(dataset, keys, uniform, zipf, rounds);
+}
+
+/**
+ * Compares the tree to std::map and std::unordered_map on the words of the
+ * given file, on random 64-bit integers and on URLs.
+ */
+void art_bench(const char *path, std::size_t n, int rounds) {
+  std::vector<string> words = wordKeys(path);
+  std::vector<string> integers = integerKeys(n);
+  std::vector<string> urls = urlKeys(n, words);
+
+  std::cout << std::left << std::setw(10) << "keys" << std::setw(20)
+            << "container" << std::right << std::setw(9) << "insert"
+            << std::setw(9) << "get" << std::setw(9) << "zipf" << std::setw(9)
+            << "iterate" << std::setw(9) << "seek10" << std::setw(9) << "del"
+            << std::setw(11) << "bytes/key" << std::endl;
+  art_bench_dataset("words", words, rounds);
+  art_bench_dataset("integers", integers, rounds);
+  art_bench_dataset("urls", urls, rounds);
+  std::cout << "(millions of operations per second, checksum " << checksum
+            << ")" << std::endl;
+}
+
+int main(int argc, char **argv) {
+  art_bench(argc > 1 ? argv[1] : "resources/artTest.txt",
+            argc > 2 ? std::stoul(argv[2]) : 1000000,
+            argc > 3 ? std::stoi(argv[3]) : 3);
+  return 0;
+}
@@ -0,0 +1,218 @@
+#include "../include/art.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+using std::string;
+
+/**
+ * Measures how long it takes to build a tree from the sorted words of the
+ * given file, once through set(), once through bulkLoad() and once through
+ * parallelBulkLoad() on shuffled words, and how long it takes to tear the
+ * tree down through clear() on the pool.
+ */
+void art_bulk_load_bench(const char *path, int rounds) {
+  std::ifstream file(path);
+  std::vector<std::pair<string, int *>> entries;
+  string line;
+  int v = 1;
+  while (std::getline(file, line)) {
+    entries.emplace_back(line, &v);
+  }
+  file.close();
+
+  std::sort(entries.begin(), entries.end());
+  entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+
+  std::vector<std::pair<string, int *>> shuffled(entries);
+  std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937_64(42));
+
+  art::ThreadPool pool;
+  std::chrono::duration<double> setElapsed(0), bulkElapsed(0),
+      parallelElapsed(0), clearElapsed(0);
+  for (int r = 0; r < rounds; ++r) {
+    auto start = std::chrono::steady_clock::now();
+    {
+      art::Art<int *> m;
+      for (const auto &e : entries) {
+        m.set(e.first, e.second);
+      }
+    }
+    setElapsed += std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    {
+      art::Art<int *> m;
+      m.bulkLoad(entries.begin(), entries.end());
+    }
+    bulkElapsed += std::chrono::steady_clock::now() - start;
+
+    art::Art<int *> m;
+    start = std::chrono::steady_clock::now();
+    m.parallelBulkLoad(shuffled.begin(), shuffled.end(), pool);
+    parallelElapsed += std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    m.clear(pool);
+    clearElapsed += std::chrono::steady_clock::now() - start;
+  }
+
+  std::cout << "keys:          " << entries.size() << std::endl;
+  std::cout << "set keys/s:    " << entries.size() * rounds / setElapsed.count()
+            << std::endl;
+  std::cout << "bulk keys/s:   "
+            << entries.size() * rounds / bulkElapsed.count() << std::endl;
+  std::cout << "parallel keys/s: "
+            << entries.size() * rounds / parallelElapsed.count()
+            << " (threads: " << pool.nThreads() << ")" << std::endl;
+  std::cout << "clear keys/s:  "
+            << entries.size() * rounds / clearElapsed.count() << std::endl;
+}
+
+/**
+ * Measures how long it takes to fill a PersistentArt with the shuffled
+ * words of the given file and checkpoint it, and to reopen it afterwards,
+ * once after closing it and once after a crash, which has to rebuild the
+ * allocator's free lists.
+ */
+void art_persistent_bench(const char *path) {
+  std::ifstream file(path);
+  std::vector<string> words;
+  string line;
+  while (std::getline(file, line)) {
+    words.push_back(line);
+  }
+  file.close();
+  std::shuffle(words.begin(), words.end(), std::mt19937_64(42));
+
+  const char *treePath = "bulkLoadBench.persistent";
+  std::remove(treePath);
+  auto start = std::chrono::steady_clock::now();
+  {
+    art::PersistentArt<uint64_t> m(treePath);
+    for (std::size_t i = 0; i < words.size(); ++i) {
+      m.set(words[i], i);
+    }
+    m.checkpoint();
+  }
+  std::chrono::duration<double> fillElapsed =
+      std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  std::size_t found = 0;
+  {
+    art::PersistentArt<uint64_t> m(treePath);
+    found += m.get(words.front()) == 0;
+  }
+  std::chrono::duration<double> openElapsed =
+      std::chrono::steady_clock::now() - start;
+
+  /* a process that exits without closing the tree leaves it as a crash
+   * would */
+  pid_t pid = fork();
+  if (pid == 0) {
+    art::PersistentArt<uint64_t> m(treePath);
+    m.set(words.back(), 1);
+    m.checkpoint();
+    _exit(0);
+  }
+  waitpid(pid, nullptr, 0);
+  start = std::chrono::steady_clock::now();
+  {
+    art::PersistentArt<uint64_t> m(treePath);
+    found += m.get(words.back()) == 1;
+  }
+  std::chrono::duration<double> recoverElapsed =
+      std::chrono::steady_clock::now() - start;
+  std::remove(treePath);
+
+  std::cout << "persistent fill s: " << fillElapsed.count()
+            << " reopen s: " << openElapsed.count()
+            << " recover s: " << recoverElapsed.count() << " (" << found
+            << ")" << std::endl;
+}
+
+/**
+ * Measures how long it takes to fill a tree from the given file, once read
+ * line by line through std::getline() into strings and once loaded in place
+ * through a KeyFile, and from a sorted copy of the file, which KeyFile
+ * loads through bulkLoad().
+ */
+void art_key_file_bench(const char *path, int rounds) {
+  std::ifstream file(path);
+  std::vector<string> words;
+  string line;
+  while (std::getline(file, line)) {
+    words.push_back(line);
+  }
+  file.close();
+  std::sort(words.begin(), words.end());
+  words.erase(std::unique(words.begin(), words.end()), words.end());
+  const char *sortedPath = "bulkLoadBench.sorted";
+  {
+    std::ofstream sorted(sortedPath);
+    for (const auto &word : words) {
+      sorted << word << '\n';
+    }
+  }
+
+  int v = 1;
+  std::size_t nLines = 0;
+  std::chrono::duration<double> getlineElapsed(0), mappedElapsed(0),
+      sortedElapsed(0);
+  for (int r = 0; r < rounds; ++r) {
+    auto start = std::chrono::steady_clock::now();
+    {
+      std::ifstream file(path);
+      std::vector<string> lines;
+      while (std::getline(file, line)) {
+        lines.push_back(line);
+      }
+      art::Art<int *> m;
+      for (const auto &l : lines) {
+        m.set(l, &v);
+      }
+    }
+    getlineElapsed += std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    {
+      art::KeyFile file(path);
+      art::Art<int *> m;
+      nLines = file.load(m, [&](std::string_view) { return &v; });
+    }
+    mappedElapsed += std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    {
+      art::KeyFile file(sortedPath);
+      art::Art<int *> m;
+      file.load(m, [&](std::string_view) { return &v; });
+    }
+    sortedElapsed += std::chrono::steady_clock::now() - start;
+  }
+  std::remove(sortedPath);
+
+  std::cout << "getline lines/s: " << nLines * rounds / getlineElapsed.count()
+            << " key file lines/s: "
+            << nLines * rounds / mappedElapsed.count()
+            << " sorted key file lines/s: "
+            << words.size() * rounds / sortedElapsed.count() << std::endl;
+}
+
+int main(int argc, char **argv) {
+  art_bulk_load_bench(argc > 1 ? argv[1] : "resources/artTest.txt", 10);
+  art_persistent_bench(argc > 1 ? argv[1] : "resources/artTest.txt");
+  art_key_file_bench(argc > 1 ? argv[1] : "resources/artTest.txt", 10);
+  return 0;
+}
@@ -0,0 +1,239 @@
+#include "../include/art.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using std::string;
+
+/**
+ * Art behind a single mutex, the baseline ConcurrentArt is compared to.
+ */
+template <typename T> class lockedArt {
+public:
+  T get(std::string_view key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return art_.get(key);
+  }
+
+  T set(std::string_view key, T value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return art_.set(key, value);
+  }
+
+private:
+  std::mutex mutex_;
+  art::Art<T> art_;
+};
+
+/**
+ * Runs the given number of threads, each performing random gets and sets on
+ * the words, and returns the overall operations per second.
+ *
+ * @param setPercent - The share of sets among the operations.
+ */
+template <class Tree>
+double art_concurrent_run(Tree &m, const std::vector<string> &words,
+                          int nThreads, int setPercent, int opsPerThread) {
+  int v = 1;
+  std::atomic<std::size_t> found{0};
+  std::vector<std::thread> threads;
+  auto start = std::chrono::steady_clock::now();
+  for (int t = 0; t < nThreads; ++t) {
+    threads.emplace_back([&, t] {
+      std::mt19937_64 rng(t);
+      std::size_t threadFound = 0;
+      for (int i = 0; i < opsPerThread; ++i) {
+        const string &word = words[rng() % words.size()];
+        if (static_cast<int>(rng() % 100) < setPercent) {
+          m.set(word, &v);
+        } else {
+          threadFound += m.get(word) != nullptr;
+        }
+      }
+      found += threadFound;
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return nThreads * static_cast<double>(opsPerThread) / elapsed.count();
+}
+
+/**
+ * Measures the throughput of mixed workloads on the words of the given file
+ * for an increasing number of threads, for ConcurrentArt, a ShardedArt split
+ * on a sample of the words and a mutex protected Art. Half of the words are
+ * loaded up front.
+ */
+void art_concurrent_bench(const char *path, int maxThreads) {
+  std::ifstream file(path);
+  std::vector<string> words;
+  string line;
+  while (std::getline(file, line)) {
+    words.push_back(line);
+  }
+  file.close();
+
+  const int opsPerThread = 1000000;
+  const std::size_t nShards = 64;
+  std::vector<string> boundaries = art::ShardedArt<int *>::splitSample(
+      words.begin(), words.end(), nShards);
+  int v = 1;
+  for (int setPercent : {10, 50}) {
+    std::cout << "get/set " << 100 - setPercent << "/" << setPercent
+              << std::endl;
+    for (int nThreads = 1; nThreads <= maxThreads; nThreads *= 2) {
+      art::ConcurrentArt<int *> concurrent;
+      art::ShardedArt<int *> sharded(boundaries);
+      lockedArt<int *> locked;
+      for (std::size_t i = 0; i < words.size(); i += 2) {
+        concurrent.set(words[i], &v);
+        sharded.set(words[i], &v);
+        locked.set(words[i], &v);
+      }
+
+      std::cout << "  threads: " << nThreads << " concurrent ops/s: "
+                << art_concurrent_run(concurrent, words, nThreads,
+                                      setPercent, opsPerThread)
+                << " sharded ops/s: "
+                << art_concurrent_run(sharded, words, nThreads, setPercent,
+                                      opsPerThread)
+                << " locked ops/s: "
+                << art_concurrent_run(locked, words, nThreads, setPercent,
+                                      opsPerThread)
+                << std::endl;
+    }
+  }
+}
+
+/**
+ * Measures the throughput of full scans of the words of the given file,
+ * through the iterator and through parallelScan() in both of its modes.
+ */
+void art_scan_bench(const char *path, int rounds) {
+  std::ifstream file(path);
+  art::Art<int *> m;
+  string line;
+  int v = 1;
+  std::size_t nKeys = 0;
+  while (std::getline(file, line)) {
+    nKeys += m.set(line, &v) == nullptr;
+  }
+  file.close();
+
+  art::ThreadPool pool;
+  auto measure = [&](auto &&scan) {
+    std::atomic<std::size_t> bytes{0};
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+      scan(bytes);
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return nKeys * rounds / elapsed.count();
+  };
+  std::cout << "scan threads: " << pool.nThreads() << " iterator keys/s: "
+            << measure([&](std::atomic<std::size_t> &bytes) {
+                 std::size_t n = 0;
+                 for (auto it = m.begin(), itEnd = m.end(); it != itEnd;
+                      ++it) {
+                   n += it.key().size();
+                 }
+                 bytes += n;
+               })
+            << " unordered keys/s: "
+            << measure([&](std::atomic<std::size_t> &bytes) {
+                 m.parallelScan(
+                     [&](std::string_view key, int *) {
+                       bytes.fetch_add(key.size(), std::memory_order_relaxed);
+                     },
+                     pool);
+               })
+            << " ordered keys/s: "
+            << measure([&](std::atomic<std::size_t> &bytes) {
+                 std::size_t n = 0;
+                 m.parallelScan([&](std::string_view key,
+                                    int *) { n += key.size(); },
+                                pool, true);
+                 bytes += n;
+               })
+            << std::endl;
+}
+
+/**
+ * Measures the throughput of sets on a DurableArt for an increasing number
+ * of threads, waiting for every set to be synced, which the threads share
+ * through group commit, and with the log synced in batches.
+ */
+void art_durable_bench(const char *path, int maxThreads) {
+  std::ifstream file(path);
+  std::vector<string> words;
+  string line;
+  while (std::getline(file, line)) {
+    words.push_back(line);
+  }
+  file.close();
+
+  const string treePath = "concurrentBench.durable";
+  auto removeFiles = [&] {
+    std::remove((treePath + ".checkpoint").c_str());
+    for (int s = 0;
+         std::remove((treePath + ".wal." + std::to_string(s)).c_str()) == 0;
+         ++s) {
+    }
+  };
+  auto run = [&](art::WalOptions options, int nThreads, int opsPerThread) {
+    removeFiles();
+    art::DurableArt<uint64_t> m(treePath.c_str(), options);
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < nThreads; ++t) {
+      threads.emplace_back([&, t] {
+        std::mt19937_64 rng(t);
+        for (int i = 0; i < opsPerThread; ++i) {
+          m.set(words[rng() % words.size()], i);
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    m.sync();
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return nThreads * static_cast<double>(opsPerThread) / elapsed.count();
+  };
+
+  art::WalOptions batched;
+  batched.syncCommit = false;
+  for (int nThreads = 1; nThreads <= std::max(maxThreads, 8); nThreads *= 2) {
+    std::cout << "durable threads: " << nThreads
+              << " sync commit sets/s: "
+              << run(art::WalOptions(), nThreads, 500)
+              << " batched sets/s: " << run(batched, nThreads, 200000)
+              << std::endl;
+  }
+  removeFiles();
+}
+
+int main(int argc, char **argv) {
+  int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+  art_concurrent_bench(argc > 1 ? argv[1] : "resources/artTest.txt",
+                       argc > 2 ? std::stoi(argv[2]) : maxThreads);
+  art_scan_bench(argc > 1 ? argv[1] : "resources/artTest.txt", 10);
+  art_durable_bench(argc > 1 ? argv[1] : "resources/artTest.txt", maxThreads);
+  return 0;
+}
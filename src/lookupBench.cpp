@@ -0,0 +1,271 @@
+#include "../include/art.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using std::string;
+
+/**
+ * Slab allocator that keeps track of the bytes handed out to the tree.
+ */
+class countingAllocator : public art::SlabAllocator {
+public:
+  void *allocate(std::size_t size) {
+    bytes += size;
+    return art::SlabAllocator::allocate(size);
+  }
+
+  void deallocate(void *p, std::size_t size) {
+    bytes -= size;
+    art::SlabAllocator::deallocate(p, size);
+  }
+
+  std::size_t bytes = 0;
+};
+
+/**
+ * Measures the throughput of batched lookups through multiGet().
+ */
+template <std::size_t Batch, class Tree>
+void art_multi_get_bench(const Tree &m,
+                         const std::vector<std::string_view> &lookups,
+                         int rounds) {
+  std::vector<int *> values(lookups.size());
+  std::size_t found = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; ++r) {
+    m.template multiGet<Batch>(lookups.data(), lookups.size(), values.data());
+    for (int *v : values) {
+      found += v != nullptr;
+    }
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  std::cout << "multiGet<" << Batch << ">/s: " << found / elapsed.count()
+            << std::endl;
+}
+
+/**
+ * Measures the throughput of prefix scans on the first bytes of the given
+ * keys, pulled through the iterator and pushed through scanPrefix().
+ */
+template <class Tree>
+void art_prefix_scan_bench(const Tree &m,
+                           const std::vector<std::string_view> &lookups,
+                           std::size_t prefixLen, int rounds) {
+  Tree &tree = const_cast<Tree &>(m);
+  std::size_t itKeys = 0, scanKeys = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; ++r) {
+    for (std::string_view k : lookups) {
+      std::string_view prefix = k.substr(0, prefixLen);
+      for (auto it = tree.begin(prefix), itEnd = tree.end();
+           it != itEnd && it.key().substr(0, prefix.size()) == prefix; ++it) {
+        ++itKeys;
+      }
+    }
+  }
+  std::chrono::duration<double> itElapsed =
+      std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; ++r) {
+    for (std::string_view k : lookups) {
+      m.scanPrefix(k.substr(0, prefixLen), [&](std::string_view, int *) {
+        ++scanKeys;
+        return true;
+      });
+    }
+  }
+  std::chrono::duration<double> scanElapsed =
+      std::chrono::steady_clock::now() - start;
+
+  std::cout << "prefix " << prefixLen
+            << " iterator keys/s: " << itKeys / itElapsed.count()
+            << " scanPrefix keys/s: " << scanKeys / scanElapsed.count()
+            << std::endl;
+}
+
+/**
+ * Measures the throughput of rank() and select() on a tree counting its
+ * keys, built from the given keys.
+ */
+void art_rank_select_bench(const std::vector<std::string_view> &lookups,
+                           int rounds) {
+  art::Art<int *> m(true);
+  int v = 1;
+  for (std::string_view k : lookups) {
+    m.set(k, &v);
+  }
+
+  std::size_t sum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; ++r) {
+    for (std::string_view k : lookups) {
+      sum += m.rank(k);
+    }
+  }
+  std::chrono::duration<double> rankElapsed =
+      std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; ++r) {
+    for (std::size_t i = 0; i < lookups.size(); ++i) {
+      sum += m.select(i * 7919 % m.size()).getKeyLen();
+    }
+  }
+  std::chrono::duration<double> selectElapsed =
+      std::chrono::steady_clock::now() - start;
+
+  std::cout << "rank/s: " << lookups.size() * rounds / rankElapsed.count()
+            << " select/s: "
+            << lookups.size() * rounds / selectElapsed.count() << " ("
+            << sum << ")" << std::endl;
+}
+
+/**
+ * Measures the time to freeze the tree into a file and to map it back, and
+ * the throughput of lookups and of a full scan on the frozen tree.
+ */
+template <class Tree>
+void art_frozen_bench(const Tree &m,
+                      const std::vector<std::string_view> &lookups,
+                      int rounds) {
+  const char *path = "lookupBench.frozen";
+  auto start = std::chrono::steady_clock::now();
+  m.freeze(path);
+  std::chrono::duration<double> freezeElapsed =
+      std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  art::FrozenArt<int *> frozen(path);
+  std::chrono::duration<double> openElapsed =
+      std::chrono::steady_clock::now() - start;
+
+  std::size_t found = 0;
+  start = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; ++r) {
+    for (std::string_view k : lookups) {
+      found += frozen.get(k) != nullptr;
+    }
+  }
+  std::chrono::duration<double> getElapsed =
+      std::chrono::steady_clock::now() - start;
+
+  std::size_t scanned = 0;
+  start = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; ++r) {
+    for (auto it = frozen.begin(), itEnd = frozen.end(); it != itEnd; ++it) {
+      scanned += it.key().size() != 0 || *it != nullptr;
+    }
+  }
+  std::chrono::duration<double> scanElapsed =
+      std::chrono::steady_clock::now() - start;
+
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  std::cout << "frozen freeze s: " << freezeElapsed.count()
+            << " open s: " << openElapsed.count() << " bytes/key: "
+            << static_cast<double>(file.tellg()) / frozen.size()
+            << std::endl;
+  std::cout << "frozen lookups/s: " << found / getElapsed.count()
+            << " iterator keys/s: " << scanned / scanElapsed.count()
+            << std::endl;
+  file.close();
+  std::remove(path);
+}
+
+/**
+ * Prints the node counts, bytes and fill factors by node type along with
+ * the prefix length and leaf depth distributions of a tree.
+ */
+void art_stats_print(const art::ArtStats &stats) {
+  const char *names[] = {"Node4", "Node16", "Node48", "Node256"};
+  for (int i = 0; i < 4; ++i) {
+    std::cout << "  " << names[i] << " nodes: " << stats.inner[i].count
+              << " bytes: " << stats.inner[i].bytes
+              << " fill: " << stats.inner[i].fillFactor() << std::endl;
+  }
+  std::cout << "  leaves: " << stats.leaves << " bytes: " << stats.leafBytes
+            << " embedded: " << stats.embedded << std::endl;
+  std::cout << "  allocations: " << stats.allocations()
+            << " bytes/key: " << stats.bytesPerKey()
+            << " prefix bytes: " << stats.prefixBytes << std::endl;
+  std::cout << "  prefix lengths:";
+  for (std::size_t len = 0; len < stats.prefixLengths.size(); ++len) {
+    if (stats.prefixLengths[len] != 0)
+      std::cout << " " << len << ":" << stats.prefixLengths[len];
+  }
+  std::cout << std::endl << "  leaf depths:";
+  for (std::size_t depth = 0; depth < stats.leafDepths.size(); ++depth) {
+    std::cout << " " << depth << ":" << stats.leafDepths[depth];
+  }
+  std::cout << std::endl;
+}
+
+/**
+ * Measures point lookup throughput and the memory used per key for the
+ * words of the given file.
+ */
+void art_lookup_bench(const char *path, int rounds) {
+  std::ifstream file(path);
+  std::vector<string> keys;
+  string line;
+  while (std::getline(file, line)) {
+    keys.push_back(line);
+  }
+  file.close();
+
+  art::Art<int *, countingAllocator> m;
+  int v = 1;
+  for (const auto &k : keys) {
+    m.set(k.c_str(), &v);
+  }
+
+  std::vector<std::string_view> lookups(keys.begin(), keys.end());
+  std::shuffle(lookups.begin(), lookups.end(), std::mt19937_64(0));
+
+  std::size_t found = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; ++r) {
+    for (std::string_view k : lookups) {
+      found += m.get(k) != nullptr;
+    }
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  std::cout << "keys:          " << keys.size() << std::endl;
+  std::cout << "found:         " << found << std::endl;
+  std::cout << "lookups/s:     " << found / elapsed.count() << std::endl;
+  std::cout << "bytes/key:     "
+            << static_cast<double>(m.getAllocator().bytes) / keys.size()
+            << std::endl;
+  std::cout << "stats:" << std::endl;
+  art_stats_print(m.stats());
+
+  art_multi_get_bench<8>(m, lookups, rounds);
+  art_multi_get_bench<16>(m, lookups, rounds);
+  art_multi_get_bench<32>(m, lookups, rounds);
+  art_frozen_bench(m, lookups, rounds);
+
+  std::vector<std::string_view> prefixes(lookups.begin(),
+                                         lookups.begin() +
+                                             std::min<std::size_t>(
+                                                 lookups.size(), 20000));
+  art_prefix_scan_bench(m, prefixes, 3, 1);
+  art_prefix_scan_bench(m, prefixes, 5, rounds);
+  art_rank_select_bench(prefixes, rounds);
+}
+
+int main(int argc, char **argv) {
+  art_lookup_bench(argc > 1 ? argv[1] : "resources/artTest.txt", 10);
+  return 0;
+}
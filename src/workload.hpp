@@ -0,0 +1,198 @@
+#ifndef ART_WORKLOAD_HPP
+#define ART_WORKLOAD_HPP
+
+#include "../include/art.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Zipf distributed ranks in [0, n), rank 0 being the most frequent, drawn
+ * as in YCSB's ZipfianGenerator (Gray et al., "Quickly Generating
+ * Billion-Record Synthetic Databases").
+ */
+class zipfian {
+public:
+  /**
+   * @param n - The number of ranks.
+   * @param theta - The skew, 0.99 in YCSB.
+   */
+  explicit zipfian(std::size_t n, double theta = 0.99)
+      : n_(0), theta_(theta), alpha_(1 / (1 - theta)), zetan_(0),
+        zeta2_(zeta(2, 0, 0)) {
+    resize(n);
+  }
+
+  /**
+   * Extends the ranks to [0, n), n not being smaller than before, updating
+   * the normalization constant incrementally.
+   */
+  void resize(std::size_t n) {
+    zetan_ = zeta(n, n_, zetan_);
+    n_ = n;
+    eta_ = (1 - std::pow(2.0 / n_, 1 - theta_)) / (1 - zeta2_ / zetan_);
+  }
+
+  template <class Rng> std::size_t operator()(Rng &rng) {
+    double u = std::uniform_real_distribution<double>(0, 1)(rng);
+    double uz = u * zetan_;
+    if (uz < 1)
+      return 0;
+    if (uz < 1 + std::pow(0.5, theta_))
+      return 1;
+    auto rank = static_cast<std::size_t>(
+        n_ * std::pow(eta_ * u - eta_ + 1, alpha_));
+    return std::min(rank, n_ - 1);
+  }
+
+private:
+  /**
+   * Sum of 1 / i^theta for i in [1, n], knowing the sum up to from.
+   */
+  double zeta(std::size_t n, std::size_t from, double sum) const {
+    for (std::size_t i = from + 1; i <= n; ++i)
+      sum += 1 / std::pow(static_cast<double>(i), theta_);
+    return sum;
+  }
+
+  std::size_t n_;
+  double theta_, alpha_, zetan_, zeta2_, eta_;
+};
+
+/**
+ * Log-linear histogram of latencies in nanoseconds, after HdrHistogram:
+ * values below 2^subBits have a bucket each, every further power of two is
+ * split into 2^subBits buckets, which bounds the relative error of the
+ * reported percentiles by 2^-subBits.
+ */
+class latencyHistogram {
+public:
+  static constexpr int subBits = 7;
+  static constexpr std::size_t nBuckets = (64 - subBits + 1) << subBits;
+
+  latencyHistogram() : counts_(nBuckets, 0) {}
+
+  void record(uint64_t value) {
+    ++counts_[bucket(value)];
+    ++count_;
+    sum_ += value;
+    max_ = std::max(max_, value);
+  }
+
+  void merge(const latencyHistogram &other) {
+    for (std::size_t i = 0; i < nBuckets; ++i)
+      counts_[i] += other.counts_[i];
+    count_ += other.count_;
+    sum_ += other.sum_;
+    max_ = std::max(max_, other.max_);
+  }
+
+  uint64_t count() const { return count_; }
+  uint64_t max() const { return max_; }
+  double mean() const { return count_ != 0 ? double(sum_) / count_ : 0; }
+
+  /**
+   * The highest value equivalent to the value at the given percentile.
+   */
+  uint64_t percentile(double p) const {
+    auto rank = static_cast<uint64_t>(std::ceil(p / 100 * count_));
+    uint64_t seen = 0;
+    for (std::size_t i = 0; i < nBuckets; ++i) {
+      seen += counts_[i];
+      if (seen >= std::max<uint64_t>(rank, 1))
+        return std::min(highest(i), max_);
+    }
+    return max_;
+  }
+
+private:
+  static std::size_t bucket(uint64_t value) {
+    if (value < (uint64_t(1) << subBits))
+      return value;
+    int shift = 63 - __builtin_clzll(value) - subBits;
+    return ((shift + 1) << subBits) + (value >> shift) -
+           (uint64_t(1) << subBits);
+  }
+
+  static uint64_t highest(std::size_t bucket) {
+    if (bucket < (std::size_t(1) << subBits))
+      return bucket;
+    int shift = (bucket >> subBits) - 1;
+    uint64_t sub = (bucket & ((1 << subBits) - 1)) + (1 << subBits);
+    return ((sub + 1) << shift) - 1;
+  }
+
+  std::vector<uint64_t> counts_;
+  uint64_t count_ = 0, sum_ = 0, max_ = 0;
+};
+
+/**
+ * Sorts the keys, drops duplicates and shuffles the rest.
+ */
+inline void uniqueShuffle(std::vector<std::string> &keys, uint64_t seed) {
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  std::shuffle(keys.begin(), keys.end(), std::mt19937_64(seed));
+}
+
+/**
+ * The distinct lines of the given file, shuffled.
+ */
+inline std::vector<std::string> wordKeys(const char *path) {
+  std::vector<std::string> keys;
+  art::KeyFile(path).forEach([&](std::string_view key, std::string_view) {
+    keys.emplace_back(key);
+  });
+  uniqueShuffle(keys, 0);
+  return keys;
+}
+
+/**
+ * About n distinct random 64-bit integers in their binary-comparable
+ * encoding, shuffled.
+ */
+inline std::vector<std::string> integerKeys(std::size_t n) {
+  std::mt19937_64 rng(1);
+  std::vector<std::string> keys(n, std::string(8, '\0'));
+  for (auto &key : keys) {
+    art::KeyTraits<uint64_t>::encode(rng(),
+                                     reinterpret_cast<uint8_t *>(&key[0]));
+  }
+  uniqueShuffle(keys, 1);
+  return keys;
+}
+
+/**
+ * About n distinct URLs made of the given words, with a few thousand hosts
+ * of skewed popularity and paths of one to four segments, shuffled.
+ */
+inline std::vector<std::string>
+urlKeys(std::size_t n, const std::vector<std::string> &words) {
+  std::mt19937_64 rng(2);
+  auto word = [&] { return words[rng() % words.size()]; };
+  std::vector<std::string> hosts;
+  for (int i = 0; i < 4096; ++i) {
+    hosts.push_back("https://www." + word() + (i % 4 ? ".com/" : ".org/"));
+  }
+  zipfian host(hosts.size());
+  std::vector<std::string> keys;
+  for (std::size_t i = 0; i < n; ++i) {
+    std::string url = hosts[host(rng)] + word();
+    for (int segments = rng() % 4; segments > 0; --segments) {
+      url += '/' + word();
+    }
+    if (rng() % 4 == 0) {
+      url += "?id=" + std::to_string(rng() % 100000);
+    }
+    keys.push_back(std::move(url));
+  }
+  uniqueShuffle(keys, 2);
+  return keys;
+}
+
+#endif // !ART_WORKLOAD_HPP
@@ -0,0 +1,307 @@
+#include "../include/art.hpp"
+#include "workload.hpp"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using std::string;
+
+/**
+ * Operation mix and key distribution of a YCSB core workload.
+ */
+struct ycsbWorkload {
+  char name;
+  int read, update, insert, scan, readModifyWrite;
+  enum { uniform, zipf, latest } distribution;
+};
+
+const ycsbWorkload ycsbWorkloads[] = {
+    {'A', 50, 50, 0, 0, 0, ycsbWorkload::zipf},
+    {'B', 95, 5, 0, 0, 0, ycsbWorkload::zipf},
+    {'C', 100, 0, 0, 0, 0, ycsbWorkload::zipf},
+    {'D', 95, 0, 5, 0, 0, ycsbWorkload::latest},
+    {'E', 0, 0, 5, 95, 0, ycsbWorkload::zipf},
+    {'F', 50, 0, 0, 0, 50, ycsbWorkload::zipf},
+};
+
+enum ycsbOp {
+  opRead,
+  opUpdate,
+  opInsert,
+  opScan,
+  opReadModifyWrite,
+  nOpTypes
+};
+const char *const opNames[nOpTypes] = {"read", "update", "insert", "scan",
+                                       "rmw"};
+
+/**
+ * The operation of the workload's mix that the given roll in [0, 100)
+ * falls on.
+ */
+ycsbOp pickOp(const ycsbWorkload &w, int dice) {
+  if ((dice -= w.read) < 0)
+    return opRead;
+  if ((dice -= w.update) < 0)
+    return opUpdate;
+  if ((dice -= w.insert) < 0)
+    return opInsert;
+  if ((dice -= w.scan) < 0)
+    return opScan;
+  return opReadModifyWrite;
+}
+
+/* longest scan, scans read a uniform number of keys up to it */
+constexpr int maxScanLength = 100;
+
+/**
+ * FNV-1a hash of the bytes of the given number, as used by YCSB.
+ */
+uint64_t fnvHash(uint64_t value) {
+  uint64_t hash = 0xcbf29ce484222325;
+  for (int i = 0; i < 8; ++i) {
+    hash = (hash ^ ((value >> (8 * i)) & 0xff)) * 0x100000001b3;
+  }
+  return hash;
+}
+
+/**
+ * Writes the key of the record with the given number into the buffer, the
+ * number being hashed as in YCSB so that records are not inserted in key
+ * order.
+ */
+std::string_view ycsbKey(uint64_t record, char (&buffer)[32]) {
+  std::copy_n("user", 4, buffer);
+  char *end =
+      std::to_chars(buffer + 4, buffer + sizeof(buffer), fnvHash(record)).ptr;
+  return std::string_view(buffer, end - buffer);
+}
+
+/**
+ * The trees driven, behind a common interface. scan() reads the values of
+ * up to n keys from the given one and is only supported by trees with
+ * scans set.
+ */
+struct concurrentTree {
+  static constexpr const char *name = "concurrent";
+  static constexpr bool scans = false;
+
+  uint64_t get(std::string_view key) { return m.get(key); }
+  void set(std::string_view key, uint64_t value) { m.set(key, value); }
+  uint64_t scan(std::string_view, int) { return 0; }
+
+  art::ConcurrentArt<uint64_t> m;
+};
+
+struct shardedTree {
+  static constexpr const char *name = "sharded";
+  static constexpr bool scans = true;
+
+  explicit shardedTree(std::vector<string> boundaries)
+      : m(std::move(boundaries)) {}
+
+  uint64_t get(std::string_view key) { return m.get(key); }
+  void set(std::string_view key, uint64_t value) { m.set(key, value); }
+
+  uint64_t scan(std::string_view key, int n) {
+    uint64_t sum = 0;
+    for (auto it = m.begin(key), itEnd = m.end(); n > 0 && it != itEnd;
+         ++it, --n) {
+      sum += *it;
+    }
+    return sum;
+  }
+
+  art::ShardedArt<uint64_t> m;
+};
+
+struct lockedTree {
+  static constexpr const char *name = "locked";
+  static constexpr bool scans = true;
+
+  uint64_t get(std::string_view key) {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return m.get(key);
+  }
+
+  void set(std::string_view key, uint64_t value) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    m.set(key, value);
+  }
+
+  uint64_t scan(std::string_view key, int n) {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    uint64_t sum = 0;
+    for (auto it = m.begin(key), itEnd = m.end(); n > 0 && it != itEnd;
+         ++it, --n) {
+      sum += *it;
+    }
+    return sum;
+  }
+
+  std::shared_mutex mutex;
+  art::Art<uint64_t> m;
+};
+
+/**
+ * Loads the records into the tree, then runs the workload's operations on
+ * the given number of threads, timing every operation, and prints the
+ * throughput along with the latency percentiles of every operation type.
+ */
+template <class Tree>
+void ycsb_run(Tree &t, const ycsbWorkload &w, std::size_t nRecords,
+              std::size_t nOperations, int nThreads) {
+  char buffer[32];
+  for (std::size_t i = 0; i < nRecords; ++i) {
+    t.set(ycsbKey(i, buffer), i);
+  }
+
+  /* records that exist, inserts take the next number */
+  std::atomic<std::size_t> nKeys{nRecords};
+  std::vector<std::vector<latencyHistogram>> histograms(
+      nThreads, std::vector<latencyHistogram>(nOpTypes));
+  std::atomic<uint64_t> checksum{0};
+  std::vector<std::thread> threads;
+  auto start = std::chrono::steady_clock::now();
+  for (int thread = 0; thread < nThreads; ++thread) {
+    threads.emplace_back([&, thread] {
+      using clock = std::chrono::steady_clock;
+      std::mt19937_64 rng(thread);
+      zipfian ranks(nRecords);
+      char buffer[32];
+      uint64_t sum = 0;
+      auto pickRecord = [&] {
+        std::size_t n = nKeys.load(std::memory_order_relaxed);
+        if (w.distribution == ycsbWorkload::uniform) {
+          return rng() % n;
+        }
+        ranks.resize(n);
+        std::size_t rank = ranks(rng);
+        if (w.distribution == ycsbWorkload::latest) {
+          return n - 1 - rank;
+        }
+        /* spread the popular records over the key space */
+        return fnvHash(rank) % n;
+      };
+      std::size_t opsPerThread = nOperations / nThreads;
+      for (std::size_t i = 0; i < opsPerThread; ++i) {
+        ycsbOp op = pickOp(w, rng() % 100);
+        auto opStart = clock::now();
+        switch (op) {
+        case opRead:
+          sum += t.get(ycsbKey(pickRecord(), buffer));
+          break;
+        case opUpdate:
+          t.set(ycsbKey(pickRecord(), buffer), i);
+          break;
+        case opInsert:
+          t.set(ycsbKey(nKeys.fetch_add(1), buffer), i);
+          break;
+        case opScan:
+          sum += t.scan(ycsbKey(pickRecord(), buffer),
+                        1 + rng() % maxScanLength);
+          break;
+        default: {
+          std::string_view key = ycsbKey(pickRecord(), buffer);
+          t.set(key, t.get(key) + 1);
+        }
+        }
+        histograms[thread][op].record(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                clock::now() - opStart)
+                .count());
+      }
+      checksum += sum;
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  std::size_t done = nOperations / nThreads * nThreads;
+  std::cout << "workload " << w.name << "  tree: " << Tree::name
+            << "  threads: " << nThreads << "  ops/s: " << std::fixed
+            << std::setprecision(0) << done / elapsed.count() << std::endl;
+  for (int op = 0; op < nOpTypes; ++op) {
+    latencyHistogram h;
+    for (auto &threadHistograms : histograms) {
+      h.merge(threadHistograms[op]);
+    }
+    if (h.count() == 0) {
+      continue;
+    }
+    std::cout << "  " << std::left << std::setw(8) << opNames[op]
+              << std::right << std::setw(9) << h.count() << std::setw(8)
+              << h.mean();
+    for (double p : {50.0, 90.0, 99.0, 99.9, 99.99}) {
+      std::cout << std::setw(9) << h.percentile(p);
+    }
+    std::cout << std::setw(10) << h.max() << std::endl;
+  }
+}
+
+/**
+ * Runs the given YCSB workloads on ConcurrentArt, on a ShardedArt and on an
+ * Art behind a reader-writer lock, on a fresh tree for every workload,
+ * tree and number of threads. Latencies are in nanoseconds.
+ *
+ * @param workloads - The names of the workloads to run, e.g. "ABCDEF".
+ */
+void ycsb_bench(const string &workloads, std::size_t nRecords,
+                std::size_t nOperations, int maxThreads) {
+  std::vector<string> sample;
+  char buffer[32];
+  for (std::size_t i = 0; i < nRecords; i += 64) {
+    sample.emplace_back(ycsbKey(i, buffer));
+  }
+  std::vector<string> boundaries = art::ShardedArt<uint64_t>::splitSample(
+      sample.begin(), sample.end(), 64);
+
+  std::cout << "records: " << nRecords << "  operations: " << nOperations
+            << std::endl;
+  std::cout << "  " << std::left << std::setw(8) << "op" << std::right
+            << std::setw(9) << "count" << std::setw(8) << "mean"
+            << std::setw(9) << "p50" << std::setw(9) << "p90" << std::setw(9)
+            << "p99" << std::setw(9) << "p99.9" << std::setw(9) << "p99.99"
+            << std::setw(10) << "max" << "  (ns)" << std::endl;
+  for (const auto &w : ycsbWorkloads) {
+    if (workloads.find(w.name) == string::npos) {
+      continue;
+    }
+    for (int nThreads = 1; nThreads <= maxThreads; nThreads *= 2) {
+      if (concurrentTree::scans || w.scan == 0) {
+        concurrentTree concurrent;
+        ycsb_run(concurrent, w, nRecords, nOperations, nThreads);
+      }
+      {
+        shardedTree sharded(boundaries);
+        ycsb_run(sharded, w, nRecords, nOperations, nThreads);
+      }
+      lockedTree locked;
+      ycsb_run(locked, w, nRecords, nOperations, nThreads);
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+  ycsb_bench(argc > 1 ? argv[1] : "ABCDEF",
+             argc > 2 ? std::stoul(argv[2]) : 1000000,
+             argc > 3 ? std::stoul(argv[3]) : 1000000,
+             argc > 4 ? std::stoi(argv[4]) : maxThreads);
+  return 0;
+}
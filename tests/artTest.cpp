@@ -0,0 +1,429 @@
+#include "../include/art.hpp"
+#include "test.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using std::string;
+
+/**
+ * Runs a tree operation on a heap copy of the key of its exact length, so
+ * that the sanitizer catches reads past the key.
+ */
+template <class Fn> auto withKey(const string &key, Fn fn) {
+  std::vector<uint8_t> copy(key.begin(), key.end());
+  return fn(copy.data(), copy.size());
+}
+
+/**
+ * Checks that the tree holds exactly the reference's keys, in the same
+ * order both ways, and that seeking from the given keys lands where
+ * lower_bound() and the predecessor of upper_bound() do.
+ */
+template <typename T>
+void checkSame(art::Art<T> &m, const std::map<string, T> &ref,
+               const std::vector<string> &probes) {
+  auto it = m.begin();
+  for (const auto &[key, value] : ref) {
+    ART_CHECK(it != m.end());
+    ART_CHECK(it.key() == key);
+    ART_CHECK(*it == value);
+    ++it;
+  }
+  ART_CHECK(it == m.end());
+
+  auto rit = m.rbegin();
+  for (auto refIt = ref.rbegin(); refIt != ref.rend(); ++refIt) {
+    ART_CHECK(rit != m.end());
+    ART_CHECK(rit.key() == refIt->first);
+    --rit;
+  }
+  ART_CHECK(rit == m.end());
+
+  for (const string &probe : probes) {
+    auto lower = ref.lower_bound(probe);
+    auto seek = m.begin(probe);
+    if (lower == ref.end()) {
+      ART_CHECK(seek == m.end());
+    } else {
+      ART_CHECK(seek != m.end() && seek.key() == lower->first);
+    }
+    auto upper = ref.upper_bound(probe);
+    auto rseek = m.rbegin(probe);
+    if (upper == ref.begin()) {
+      ART_CHECK(rseek == m.end());
+    } else {
+      ART_CHECK(rseek != m.end() && rseek.key() == std::prev(upper)->first);
+    }
+  }
+}
+
+/**
+ * Applies random sets and deletes to the tree and to a std::map, comparing
+ * the returned and looked up values after every operation and the whole
+ * contents every so often.
+ */
+template <typename T> void testAgainstMap() {
+  std::mt19937_64 rng(1);
+  art::Art<T> m;
+  std::map<string, T> ref;
+  std::vector<string> probes;
+  for (int i = 0; i < 200; ++i)
+    probes.push_back(randomKey(rng));
+
+  for (int round = 0; round < 20; ++round) {
+    /* grow the tree, then shrink it to exercise collapses */
+    int setPercent = round % 2 == 0 ? 80 : 30;
+    for (int i = 0; i < 5000; ++i) {
+      string key = randomKey(rng);
+      auto found = ref.find(key);
+      T expected = found != ref.end() ? found->second : T();
+      if (static_cast<int>(rng() % 100) < setPercent) {
+        T value = randomValue<T>(rng);
+        ART_CHECK(withKey(key, [&](const uint8_t *k, std::size_t n) {
+                    return m.set(k, n, value);
+                  }) == expected);
+        ref[key] = value;
+      } else {
+        ART_CHECK(withKey(key, [&](const uint8_t *k, std::size_t n) {
+                    return m.del(k, n);
+                  }) == expected);
+        ref.erase(key);
+      }
+      ART_CHECK(withKey(key, [&](const uint8_t *k, std::size_t n) {
+                  return m.get(k, n);
+                }) == (ref.count(key) != 0 ? ref[key] : T()));
+    }
+    checkSame(m, ref, probes);
+    for (const auto &[key, value] : ref)
+      ART_CHECK(m.get(key) == value);
+  }
+
+  for (const auto &[key, value] : ref)
+    ART_CHECK(m.del(key) == value);
+  ART_CHECK(m.begin() == m.end());
+}
+
+/**
+ * Builds the tree from sorted keys in one go and compares it with a
+ * std::map, along with multiGet() and range scans.
+ */
+void testBulkLoad() {
+  std::mt19937_64 rng(2);
+  std::map<string, uint64_t> ref;
+  for (int i = 0; i < 20000; ++i)
+    ref[randomKey(rng)] = rng() | 1;
+  std::vector<std::pair<string, uint64_t>> entries(ref.begin(), ref.end());
+
+  art::Art<uint64_t> m;
+  m.bulkLoad(entries.begin(), entries.end());
+  std::vector<string> probes;
+  for (int i = 0; i < 200; ++i)
+    probes.push_back(randomKey(rng));
+  checkSame(m, ref, probes);
+
+  std::vector<std::string_view> keys(probes.begin(), probes.end());
+  std::vector<uint64_t> values(keys.size());
+  m.multiGet(keys.data(), keys.size(), values.data());
+  for (std::size_t i = 0; i < keys.size(); ++i)
+    ART_CHECK(values[i] == (ref.count(probes[i]) != 0 ? ref[probes[i]] : 0));
+
+  for (std::size_t i = 0; i + 1 < probes.size(); i += 2) {
+    string lo = std::min(probes[i], probes[i + 1]);
+    string hi = std::max(probes[i], probes[i + 1]);
+    auto expected = ref.lower_bound(lo);
+    m.scan(lo, hi, [&](std::string_view key, const uint64_t &value) {
+      ART_CHECK(expected != ref.end() && key == expected->first);
+      ART_CHECK(value == expected->second);
+      ++expected;
+      return true;
+    });
+    ART_CHECK(expected == ref.lower_bound(hi));
+  }
+}
+
+/**
+ * Checks rank(), select(), count() and size() of a tree counting its keys
+ * against the reference.
+ */
+void checkCounts(art::Art<uint64_t> &m, const std::map<string, uint64_t> &ref,
+                 const std::vector<string> &probes) {
+  ART_CHECK(m.size() == ref.size());
+  std::size_t k = 0;
+  for (const auto &[key, value] : ref) {
+    ART_CHECK(m.rank(key) == k);
+    auto it = m.select(k);
+    ART_CHECK(it != m.end() && it.key() == key && *it == value);
+    ++k;
+  }
+  ART_CHECK(m.select(k) == m.end());
+  for (std::size_t i = 0; i < probes.size(); ++i) {
+    auto lower = ref.lower_bound(probes[i]);
+    ART_CHECK(m.rank(probes[i]) ==
+              static_cast<std::size_t>(std::distance(ref.begin(), lower)));
+    const string &other = probes[(i + 1) % probes.size()];
+    std::size_t expected =
+        probes[i] < other ? std::distance(lower, ref.lower_bound(other)) : 0;
+    ART_CHECK(m.count(probes[i], other) == expected);
+  }
+}
+
+/**
+ * Keeps the key counts of a tree up to date through random sets and
+ * deletes, including the copies of shared nodes made while snapshots are
+ * alive, which keep seeing their version.
+ */
+void testKeyCounts() {
+  std::mt19937_64 rng(3);
+  art::Art<uint64_t> m(true);
+  std::map<string, uint64_t> ref;
+  std::vector<string> probes = {string(), string(1, '\0'),
+                                string(3, '\xff')};
+  for (int i = 0; i < 200; ++i)
+    probes.push_back(randomKey(rng));
+
+  std::vector<std::pair<art::Art<uint64_t>::Snapshot,
+                        std::map<string, uint64_t>>>
+      snapshots;
+  for (int round = 0; round < 12; ++round) {
+    int setPercent = round % 2 == 0 ? 80 : 30;
+    for (int i = 0; i < 3000; ++i) {
+      string key = randomKey(rng);
+      if (static_cast<int>(rng() % 100) < setPercent) {
+        uint64_t value = randomValue<uint64_t>(rng);
+        m.set(key, value);
+        ref[key] = value;
+      } else {
+        m.del(key);
+        ref.erase(key);
+      }
+      if (i % 1000 == 0)
+        snapshots.emplace_back(m.snapshot(), ref);
+    }
+    checkCounts(m, ref, probes);
+    if (round % 3 == 2)
+      snapshots.erase(snapshots.begin(), snapshots.begin() + 3);
+  }
+  for (const auto &[snapshot, keys] : snapshots) {
+    auto it = snapshot.begin();
+    for (const auto &[key, value] : keys) {
+      ART_CHECK(it != snapshot.end() && it.key() == key && *it == value);
+      ++it;
+    }
+    ART_CHECK(it == snapshot.end());
+  }
+}
+
+/**
+ * Scans prefixes against a std::map: the empty prefix, prefixes longer
+ * than the inline prefix of a node and prefixes ending in 0xff bytes,
+ * whose keys have no successor of the same length.
+ */
+void testScanPrefix() {
+  std::mt19937_64 rng(4);
+  art::Art<uint64_t> m;
+  std::map<string, uint64_t> ref;
+  std::vector<string> keys = {string(), string(1, '\xff'), string(2, '\xff'),
+                              string(3, '\xff') + 'a', "a\xff", "a\xff\xff",
+                              "a\xff\xff" "b", "b", string(20, 'p'),
+                              string(20, 'p') + '\xff'};
+  for (int i = 0; i < 5000; ++i) {
+    string key = randomKey(rng);
+    keys.push_back(key);
+    keys.push_back(key + '\xff');
+  }
+  for (const string &key : keys) {
+    uint64_t value = randomValue<uint64_t>(rng);
+    m.set(key, value);
+    ref[key] = value;
+  }
+
+  std::vector<string> prefixes = {string(),
+                                  string(1, '\xff'),
+                                  string(2, '\xff'),
+                                  string(4, '\xff'),
+                                  "a\xff",
+                                  "a\xff\xff",
+                                  string(9, 'p'),
+                                  string(12, 'p'),
+                                  string(12, 'p') + '\xff',
+                                  string(20, 'p'),
+                                  string(21, 'p')};
+  for (int i = 0; i < 300; ++i) {
+    string prefix = randomKey(rng);
+    prefixes.push_back(prefix);
+    prefixes.push_back(prefix + '\xff');
+  }
+  for (const string &prefix : prefixes) {
+    auto expected = ref.lower_bound(prefix);
+    ART_CHECK(m.scanPrefix(prefix, [&](std::string_view key,
+                                       const uint64_t &value) {
+      ART_CHECK(expected != ref.end() && key == expected->first);
+      ART_CHECK(value == expected->second);
+      ++expected;
+      return true;
+    }));
+    ART_CHECK(expected == ref.end() ||
+              expected->first.compare(0, prefix.size(), prefix) != 0);
+
+    /* the scan stops once the callback returns false */
+    std::size_t nCalls = 0;
+    bool finished =
+        m.scanPrefix(prefix, [&](std::string_view, const uint64_t &) {
+          return ++nCalls < 2;
+        });
+    ART_CHECK(finished == (nCalls < 2));
+  }
+}
+
+/**
+ * Stats of a tree of uint64_t values, which are never embedded, holding
+ * the given keys.
+ */
+art::ArtStats statsOf(const std::vector<string> &keys) {
+  art::Art<uint64_t> m;
+  for (const string &key : keys)
+    m.set(key, key.size() + 1);
+  return m.stats();
+}
+
+/**
+ * Number of inner nodes of each type in the stats.
+ */
+std::vector<std::size_t> innerCounts(const art::ArtStats &stats) {
+  std::vector<std::size_t> counts;
+  for (const auto &type : stats.inner)
+    counts.push_back(type.count);
+  return counts;
+}
+
+/**
+ * Reports the stats of trees whose shape is known: node types by fan-out,
+ * prefixes, keys in leaf slots, leaf depths and bytes, embedded values, and
+ * keys of a random tree whether or not a snapshot shares its nodes.
+ */
+void testStats() {
+  using art::NodeType;
+  using leaf = art::LeafNode<uint64_t>;
+  using counts = std::vector<std::size_t>;
+
+  art::ArtStats empty = statsOf({});
+  ART_CHECK(empty.keys() == 0 && empty.innerNodes() == 0);
+  ART_CHECK(empty.bytes() == 0 && empty.bytesPerKey() == 0);
+  ART_CHECK(empty.leafDepths.empty() && empty.prefixLengths.empty());
+
+  art::ArtStats one = statsOf({"abc"});
+  ART_CHECK(one.keys() == 1 && one.leaves == 1 && one.innerNodes() == 0);
+  ART_CHECK(one.leafBytes == leaf::size(3) && one.bytes() == leaf::size(3));
+  ART_CHECK(one.leafDepths == counts({1}));
+
+  /* the root grows from a Node4 through all types as children are added */
+  std::vector<string> keys;
+  std::size_t leafBytes = 0;
+  for (int n = 1; n <= 256; ++n) {
+    keys.push_back(string(1, static_cast<char>(n - 1)));
+    leafBytes += leaf::size(1);
+    if (n == 1)
+      continue;
+    art::ArtStats stats = statsOf(keys);
+    int type = n <= 4 ? 0 : n <= 16 ? 1 : n <= 48 ? 2 : 3;
+    counts expected(4, 0);
+    expected[type] = 1;
+    ART_CHECK(innerCounts(stats) == expected);
+    ART_CHECK(stats.inner[type].children == static_cast<std::size_t>(n));
+    ART_CHECK(stats.inner[type].fillFactor() ==
+              double(n) / stats.inner[type].capacity);
+    ART_CHECK(stats.keys() == keys.size() && stats.leaves == keys.size());
+    ART_CHECK(stats.leafBytes == leafBytes);
+    ART_CHECK(stats.bytes() == leafBytes + stats.inner[type].bytes);
+    ART_CHECK(stats.allocations() == keys.size() + 1);
+    ART_CHECK(stats.leafDepths == counts({0, keys.size()}));
+    ART_CHECK(stats.prefixBytes == 0 && stats.prefixLengths == counts({1}));
+  }
+  ART_CHECK(statsOf({"a", "b"}).inner[static_cast<int>(NodeType::Node4)]
+                .bytes == sizeof(art::Node4<uint64_t>));
+
+  /* a shared prefix, longer than the inline one, with a key ending in the
+   * node's leaf slot */
+  string p(20, 'p');
+  art::ArtStats prefixed = statsOf({p, p + 'a', p + 'b'});
+  ART_CHECK(innerCounts(prefixed) == counts({1, 0, 0, 0}));
+  ART_CHECK(prefixed.inner[0].children == 2 && prefixed.keys() == 3);
+  ART_CHECK(prefixed.prefixBytes == 20 && prefixed.prefixLengths.size() == 21 &&
+            prefixed.prefixLengths[20] == 1);
+  ART_CHECK(prefixed.leafDepths == counts({0, 3}));
+
+  /* "a" moves into the leaf slot of a Node4 below the root */
+  art::ArtStats nested = statsOf({"a", "ab", "b"});
+  ART_CHECK(innerCounts(nested) == counts({2, 0, 0, 0}));
+  ART_CHECK(nested.inner[0].children == 3);
+  ART_CHECK(nested.prefixLengths == counts({2}));
+  ART_CHECK(nested.leafDepths == counts({0, 1, 2}));
+  ART_CHECK(nested.leafBytes == 2 * leaf::size(1) + leaf::size(2));
+
+  /* a value whose key ends at its child slot is embedded in it, the first
+   * key stays in its leaf record */
+  uint64_t values[3] = {1, 2, 3};
+  art::Art<const uint64_t *> pointers;
+  pointers.set("a", &values[0]);
+  pointers.set("b", &values[1]);
+  pointers.set("c", &values[2]);
+  art::ArtStats embedded = pointers.stats();
+  ART_CHECK(embedded.keys() == 3 && embedded.leaves == 1 &&
+            embedded.embedded == 2);
+  ART_CHECK(embedded.allocations() == 2);
+  ART_CHECK(embedded.leafBytes == art::LeafNode<const uint64_t *>::size(1));
+
+  std::mt19937_64 rng(5);
+  art::Art<uint64_t> m;
+  std::map<string, uint64_t> ref;
+  for (int i = 0; i < 20000; ++i) {
+    string key = randomKey(rng);
+    uint64_t value = randomValue<uint64_t>(rng);
+    m.set(key, value);
+    ref[key] = value;
+  }
+  auto snapshot = m.snapshot();
+  for (int i = 0; i < 2000; ++i) {
+    string key = randomKey(rng);
+    m.del(key);
+    ref.erase(key);
+  }
+  art::ArtStats stats = m.stats();
+  ART_CHECK(stats.keys() == ref.size() && stats.embedded == 0);
+  std::size_t depthKeys = 0, prefixNodes = 0, prefixBytes = 0;
+  for (std::size_t depth = 0; depth < stats.leafDepths.size(); ++depth)
+    depthKeys += stats.leafDepths[depth];
+  for (std::size_t len = 0; len < stats.prefixLengths.size(); ++len) {
+    prefixNodes += stats.prefixLengths[len];
+    prefixBytes += len * stats.prefixLengths[len];
+  }
+  ART_CHECK(depthKeys == ref.size());
+  ART_CHECK(prefixNodes == stats.innerNodes());
+  ART_CHECK(prefixBytes == stats.prefixBytes);
+  std::size_t refBytes = 0;
+  for (const auto &entry : ref)
+    refBytes += leaf::size(static_cast<int>(entry.first.size()));
+  ART_CHECK(stats.leafBytes == refBytes);
+  for (const auto &type : stats.inner)
+    ART_CHECK(type.children <= type.count * type.capacity);
+}
+
+int main() {
+  testAgainstMap<uint64_t>();
+  testAgainstMap<const uint64_t *>();
+  testBulkLoad();
+  testKeyCounts();
+  testScanPrefix();
+  testStats();
+  std::cout << "ok" << std::endl;
+  return 0;
+}
@@ -0,0 +1,106 @@
+#include "../include/art.hpp"
+#include "test.hpp"
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using std::string;
+
+constexpr int nWriters = 4;
+constexpr int nOperations = 100000;
+
+/**
+ * Key owned by the given writer, writers never touch each other's keys.
+ */
+string ownedKey(int writer, uint64_t n) {
+  return "own" + std::to_string(n) + '/' + std::to_string(writer);
+}
+
+/**
+ * Writers set and delete keys of their own, which they check against a
+ * std::map of their own, and race on a small set of shared keys which
+ * makes nodes grow, shrink and split their prefixes under each other.
+ * Readers meanwhile look up keys that are never modified and walk the
+ * tree. Every value of a shared key names the writer that set it.
+ */
+void testStress() {
+  art::ConcurrentArt<uint64_t> m;
+  for (uint64_t i = 0; i < 1000; ++i)
+    m.set("stable" + std::to_string(i), i + 1);
+
+  std::vector<std::map<string, uint64_t>> owned(nWriters);
+  std::atomic<bool> done{false};
+  std::vector<std::thread> threads;
+  for (int writer = 0; writer < nWriters; ++writer) {
+    threads.emplace_back([&, writer] {
+      std::mt19937_64 rng(writer);
+      auto &ref = owned[writer];
+      for (int i = 0; i < nOperations; ++i) {
+        uint64_t value = (static_cast<uint64_t>(i) << 8) | (writer + 1);
+        if (rng() % 2 == 0) {
+          string key = "shared" + std::to_string(rng() % 256);
+          uint64_t old = rng() % 3 == 0 ? m.del(key) : m.set(key, value);
+          ART_CHECK(old == 0 || (old & 0xff) <= nWriters);
+          continue;
+        }
+        string key = ownedKey(writer, rng() % 2000);
+        auto found = ref.find(key);
+        uint64_t expected = found != ref.end() ? found->second : 0;
+        if (rng() % 3 == 0) {
+          ART_CHECK(m.del(key) == expected);
+          ref.erase(key);
+        } else {
+          ART_CHECK(m.set(key, value) == expected);
+          ref[key] = value;
+        }
+        ART_CHECK(m.get(key) == (ref.count(key) != 0 ? ref[key] : 0));
+      }
+    });
+  }
+  threads.emplace_back([&] {
+    std::mt19937_64 rng(nWriters);
+    while (!done.load()) {
+      for (int i = 0; i < 1000; ++i) {
+        uint64_t n = rng() % 1000;
+        ART_CHECK(m.get("stable" + std::to_string(n)) == n + 1);
+      }
+      std::size_t nStable = 0;
+      string prev;
+      m.forEach([&](std::string_view key, uint64_t) {
+        ART_CHECK(prev.empty() || prev < key);
+        prev = key;
+        nStable += key.substr(0, 6) == "stable";
+      });
+      ART_CHECK(nStable == 1000);
+    }
+  });
+  for (int writer = 0; writer < nWriters; ++writer)
+    threads[writer].join();
+  done = true;
+  threads.back().join();
+
+  std::map<string, uint64_t> expected;
+  for (const auto &ref : owned)
+    expected.insert(ref.begin(), ref.end());
+  auto it = expected.begin();
+  m.forEach([&](std::string_view key, uint64_t value) {
+    if (key.substr(0, 3) != "own")
+      return;
+    ART_CHECK(it != expected.end() && key == it->first);
+    ART_CHECK(value == it->second);
+    ++it;
+  });
+  ART_CHECK(it == expected.end());
+}
+
+int main() {
+  testStress();
+  std::cout << "ok" << std::endl;
+  return 0;
+}
@@ -0,0 +1,313 @@
+#include "../include/art.hpp"
+#include "test.hpp"
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <poll.h>
+#include <string>
+#include <string_view>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using std::string;
+
+constexpr int nWriters = 4;
+
+/**
+ * Key of the given operation of the given writer, which deletes the key if
+ * del is set and sets it to op + 1 otherwise. Every third operation is a
+ * delete, and writers have keys of their own.
+ */
+string opKey(int writer, uint64_t op, bool &del) {
+  del = op % 3 == 2;
+  return std::to_string(writer) + '/' +
+         std::to_string(del ? op * 7 % 300 : op % 300);
+}
+
+/**
+ * Applies the given operation of the given writer to the reference.
+ */
+void apply(std::map<string, uint64_t> &ref, int writer, uint64_t op) {
+  bool del;
+  string key = opKey(writer, op, del);
+  if (del)
+    ref.erase(key);
+  else
+    ref[key] = op + 1;
+}
+
+/**
+ * The keys of the given writer in the tree.
+ */
+std::map<string, uint64_t> keysOf(art::DurableArt<uint64_t> &m, int writer) {
+  string prefix = std::to_string(writer) + '/';
+  std::map<string, uint64_t> keys;
+  auto snapshot = m.snapshot();
+  for (auto it = snapshot.begin(prefix), itEnd = snapshot.end(); it != itEnd;
+       ++it) {
+    std::string_view key = it.key();
+    if (key.substr(0, prefix.size()) != prefix)
+      break;
+    keys.emplace(key, *it);
+  }
+  return keys;
+}
+
+/**
+ * Reads the reports of two words the child writes to the pipe while it runs
+ * for the given number of milliseconds, so that its writes never block,
+ * then kills it and reads the remaining reports.
+ */
+template <class Fn> void killAfter(pid_t pid, int fd, int ms, Fn onReport) {
+  auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+  uint64_t report[2];
+  std::size_t have = 0;
+  auto readSome = [&] {
+    ssize_t n = ::read(fd, reinterpret_cast<char *>(report) + have,
+                       sizeof(report) - have);
+    if (n <= 0)
+      return false;
+    have += n;
+    if (have == sizeof(report)) {
+      onReport(report);
+      have = 0;
+    }
+    return true;
+  };
+  for (auto now = std::chrono::steady_clock::now(); now < deadline;
+       now = std::chrono::steady_clock::now()) {
+    pollfd readable{fd, POLLIN, 0};
+    auto left =
+        std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now);
+    if (::poll(&readable, 1, static_cast<int>(left.count()) + 1) > 0 &&
+        !readSome())
+      break;
+  }
+  ::kill(pid, SIGKILL);
+  int status;
+  ART_CHECK(::waitpid(pid, &status, 0) == pid);
+  ART_CHECK(WIFSIGNALED(status) && WTERMSIG(status) == SIGKILL);
+  while (readSome()) {
+  }
+}
+
+/**
+ * Kills a process whose writers set and delete keys through group commit
+ * while checkpoints are taken, each writer reporting the operations that
+ * returned. In the reopened tree, every writer's keys must be those after
+ * its last reported operation, or after the next one, which may have been
+ * committed without being reported.
+ */
+void testKill() {
+  tempDir dir;
+  string path = dir.file("kill");
+  art::WalOptions options;
+  options.checkpointBytes = 64 << 10;
+  std::vector<uint64_t> done(nWriters, 0);
+  for (int round = 0; round < 6; ++round) {
+    int fds[2];
+    ART_CHECK(::pipe(fds) == 0);
+    pid_t pid = ::fork();
+    ART_CHECK(pid >= 0);
+    if (pid == 0) {
+      ::close(fds[0]);
+      art::DurableArt<uint64_t> m(path.c_str(), options);
+      std::vector<std::thread> threads;
+      for (int writer = 0; writer < nWriters; ++writer) {
+        threads.emplace_back([&, writer] {
+          for (uint64_t op = done[writer];; ++op) {
+            bool del;
+            string key = opKey(writer, op, del);
+            if (del)
+              m.del(key);
+            else
+              m.set(key, op + 1);
+            uint64_t report[2] = {static_cast<uint64_t>(writer), op};
+            if (::write(fds[1], report, sizeof(report)) != sizeof(report))
+              ::_exit(1);
+          }
+        });
+      }
+      for (auto &thread : threads)
+        thread.join();
+    }
+    ::close(fds[1]);
+    std::vector<uint64_t> reported = done;
+    killAfter(pid, fds[0], 50 + 50 * round, [&](const uint64_t *report) {
+      reported[report[0]] = report[1] + 1;
+    });
+    ::close(fds[0]);
+
+    art::DurableArt<uint64_t> m(path.c_str(), options);
+    for (int writer = 0; writer < nWriters; ++writer) {
+      std::map<string, uint64_t> ref;
+      for (uint64_t op = 0; op < reported[writer]; ++op)
+        apply(ref, writer, op);
+      std::map<string, uint64_t> recovered = keysOf(m, writer);
+      done[writer] = reported[writer];
+      if (recovered != ref) {
+        apply(ref, writer, done[writer]++);
+        ART_CHECK(recovered == ref);
+      }
+    }
+  }
+}
+
+/**
+ * Makes writing the log fail through the file size limit. The failed set()
+ * throws, as do all later modifications and syncs, and reopening the tree
+ * recovers the keys set before the failure, the ones whose records reached
+ * the disk.
+ */
+void testWriteFailure() {
+  tempDir dir;
+  string path = dir.file("failure");
+  ::signal(SIGXFSZ, SIG_IGN);
+  int nSet = 0;
+  {
+    art::DurableArt<uint64_t> m(path.c_str());
+    rlimit limit{4096, RLIM_INFINITY};
+    ART_CHECK(::setrlimit(RLIMIT_FSIZE, &limit) == 0);
+    bool threw = false;
+    try {
+      for (;; ++nSet)
+        m.set("key" + std::to_string(nSet), nSet + 1);
+    } catch (const std::system_error &) {
+      threw = true;
+    }
+    ART_CHECK(threw);
+    limit.rlim_cur = RLIM_INFINITY;
+    ART_CHECK(::setrlimit(RLIMIT_FSIZE, &limit) == 0);
+
+    threw = false;
+    try {
+      m.set("after", 1);
+    } catch (const std::system_error &) {
+      threw = true;
+    }
+    ART_CHECK(threw);
+    threw = false;
+    try {
+      m.sync();
+    } catch (const std::system_error &) {
+      threw = true;
+    }
+    ART_CHECK(threw);
+  }
+  ::signal(SIGXFSZ, SIG_DFL);
+
+  {
+    art::DurableArt<uint64_t> m(path.c_str());
+    for (int i = 0; i < nSet; ++i)
+      ART_CHECK(m.get("key" + std::to_string(i)) ==
+                static_cast<uint64_t>(i + 1));
+    ART_CHECK(m.get("after") == 0);
+    m.set("after", 1);
+  }
+  art::DurableArt<uint64_t> m(path.c_str());
+  ART_CHECK(m.get("after") == 1);
+}
+
+/**
+ * Corrupts a record in the middle of a segment followed by another
+ * segment. Replay stops at the corrupt record and must not apply the next
+ * segment, whose records would follow a gap. Keys set after reopening
+ * survive later reopens.
+ */
+void testGap() {
+  tempDir dir;
+  string path = dir.file("gap");
+  art::WalOptions options;
+  options.checkpointBytes = 0;
+  {
+    art::DurableArt<uint64_t> m(path.c_str(), options);
+    for (int i = 1; i <= 10; ++i)
+      m.set("a" + std::to_string(i), i);
+  }
+  {
+    art::DurableArt<uint64_t> m(path.c_str(), options);
+    m.set("c", 3);
+  }
+  {
+    /* the second record of the first segment, "a2" */
+    std::fstream segment(path + ".wal.0",
+                         std::ios::in | std::ios::out | std::ios::binary);
+    segment.seekp(30);
+    segment.put('X');
+  }
+  {
+    art::DurableArt<uint64_t> m(path.c_str(), options);
+    ART_CHECK(m.get("a1") == 1);
+    ART_CHECK(m.get("a2") == 0);
+    ART_CHECK(m.get("a10") == 0);
+    ART_CHECK(m.get("c") == 0);
+    m.set("b", 2);
+  }
+  for (int reopen = 0; reopen < 2; ++reopen) {
+    art::DurableArt<uint64_t> m(path.c_str(), options);
+    ART_CHECK(m.get("a1") == 1);
+    ART_CHECK(m.get("a5") == 0);
+    ART_CHECK(m.get("b") == 2);
+    ART_CHECK(m.get("c") == 0);
+  }
+}
+
+/**
+ * Makes creating the next log segment fail, through a directory in its
+ * place. The checkpoint throws, while the log goes on in the current
+ * segment: later modifications succeed and survive reopening the tree.
+ */
+void testSegmentFailure() {
+  tempDir dir;
+  string path = dir.file("segment");
+  string next = path + ".wal.1";
+  art::WalOptions options;
+  options.checkpointBytes = 0;
+  {
+    art::DurableArt<uint64_t> m(path.c_str(), options);
+    m.set("a", 1);
+    ART_CHECK(::mkdir(next.c_str(), 0755) == 0);
+    bool threw = false;
+    try {
+      m.checkpoint();
+    } catch (const std::system_error &) {
+      threw = true;
+    }
+    ART_CHECK(threw);
+    m.set("b", 2);
+    m.del("a");
+    m.sync();
+  }
+  ART_CHECK(::rmdir(next.c_str()) == 0);
+  {
+    art::DurableArt<uint64_t> m(path.c_str(), options);
+    ART_CHECK(m.get("a") == 0);
+    ART_CHECK(m.get("b") == 2);
+    m.set("c", 3);
+    m.checkpoint();
+    m.set("d", 4);
+  }
+  art::DurableArt<uint64_t> m(path.c_str(), options);
+  ART_CHECK(m.get("b") == 2);
+  ART_CHECK(m.get("c") == 3);
+  ART_CHECK(m.get("d") == 4);
+}
+
+int main() {
+  testKill();
+  testWriteFailure();
+  testGap();
+  testSegmentFailure();
+  std::cout << "ok" << std::endl;
+  return 0;
+}
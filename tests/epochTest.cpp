@@ -0,0 +1,159 @@
+#include "../include/art.hpp"
+#include "test.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+/**
+ * Block handed to the manager, whose reclamation is recorded.
+ */
+struct block {
+  static constexpr uint64_t aliveMagic = 0xa11ea11ea11ea11e;
+  uint64_t magic = aliveMagic;
+};
+
+/**
+ * Blocks reclaimed so far, the owner of the retired blocks.
+ */
+struct reclaimed {
+  std::mutex mutex;
+  std::set<void *> blocks;
+
+  bool contains(void *p) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return blocks.count(p) != 0;
+  }
+
+  static void reclaim(void *owner, void *p, std::size_t size) {
+    ART_CHECK(size == sizeof(block));
+    auto self = static_cast<reclaimed *>(owner);
+    {
+      std::lock_guard<std::mutex> lock(self->mutex);
+      ART_CHECK(self->blocks.insert(p).second);
+    }
+    static_cast<block *>(p)->magic = 0;
+    delete static_cast<block *>(p);
+  }
+};
+
+/**
+ * Pins the calling thread, retires enough blocks to attempt to advance the
+ * global epoch and unpins, the given number of times.
+ */
+void churn(art::EpochManager &epochs, reclaimed &freed, int times) {
+  for (int i = 0; i < times; ++i) {
+    auto guard = epochs.pin();
+    for (std::size_t j = 0; j < art::EpochManager::advanceInterval; ++j)
+      epochs.retire(new block, sizeof(block), reclaimed::reclaim, &freed);
+  }
+}
+
+/**
+ * Thread B is pinned to epoch e while the global epoch moves to e + 1,
+ * thread A then pins to e + 1 and reaches a block which B unlinks and
+ * retires. However often B pins and retires afterwards, the block must not
+ * be reclaimed until A unpins, and must be reclaimed some time after.
+ */
+void testRetireOrdering() {
+  reclaimed freed;
+  art::EpochManager epochs;
+  std::mutex mutex;
+  std::condition_variable changed;
+  int step = 0;
+  auto waitFor = [&](int s) {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [&] { return step >= s; });
+  };
+  auto advanceTo = [&](int s) {
+    std::lock_guard<std::mutex> lock(mutex);
+    step = s;
+    changed.notify_all();
+  };
+
+  auto shared = new block;
+  std::thread a([&] {
+    waitFor(1);
+    {
+      auto guard = epochs.pin();
+      block *reached = shared;
+      advanceTo(2);
+      waitFor(3);
+      ART_CHECK(reached->magic == block::aliveMagic);
+    }
+    advanceTo(4);
+  });
+
+  {
+    auto guard = epochs.pin();
+    /* B alone is pinned and has observed the epoch, which advances */
+    for (std::size_t j = 0; j < art::EpochManager::advanceInterval; ++j)
+      epochs.retire(new block, sizeof(block), reclaimed::reclaim, &freed);
+    advanceTo(1);
+    waitFor(2);
+    epochs.retire(shared, sizeof(block), reclaimed::reclaim, &freed);
+  }
+  churn(epochs, freed, 16);
+  ART_CHECK(!freed.contains(shared));
+  advanceTo(3);
+  waitFor(4);
+  a.join();
+  churn(epochs, freed, 16);
+  ART_CHECK(freed.contains(shared));
+}
+
+/**
+ * Readers pin and check that the block currently published is alive while
+ * writers replace it and retire the previous one. The sanitizer reports a
+ * block read after being reclaimed.
+ */
+void testReadersAndWriters() {
+  reclaimed freed;
+  {
+    art::EpochManager epochs;
+    std::atomic<block *> current{new block};
+    std::atomic<bool> done{false};
+    std::vector<std::thread> threads;
+    for (int reader = 0; reader < 3; ++reader) {
+      threads.emplace_back([&] {
+        while (!done.load()) {
+          auto guard = epochs.pin();
+          block *b = current.load();
+          for (int i = 0; i < 16; ++i) {
+            ART_CHECK(b->magic == block::aliveMagic);
+            std::this_thread::yield();
+          }
+        }
+      });
+    }
+    for (int writer = 0; writer < 2; ++writer) {
+      threads.emplace_back([&] {
+        for (int i = 0; i < 20000; ++i) {
+          auto guard = epochs.pin();
+          block *old = current.exchange(new block);
+          epochs.retire(old, sizeof(block), reclaimed::reclaim, &freed);
+        }
+      });
+    }
+    for (std::size_t i = 3; i < threads.size(); ++i)
+      threads[i].join();
+    done = true;
+    for (int i = 0; i < 3; ++i)
+      threads[i].join();
+    delete current.load();
+  }
+  ART_CHECK(freed.blocks.size() == 2 * 20000);
+}
+
+int main() {
+  testRetireOrdering();
+  testReadersAndWriters();
+  std::cout << "ok" << std::endl;
+  return 0;
+}
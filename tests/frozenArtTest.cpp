@@ -0,0 +1,203 @@
+#include "../include/art.hpp"
+#include "test.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+using std::string;
+
+using entries = std::vector<std::pair<string, uint64_t>>;
+
+/**
+ * Sets or deletes n random keys in the tree and in the reference.
+ */
+void mutate(art::Art<uint64_t> &m, std::map<string, uint64_t> &ref,
+            std::mt19937_64 &rng, int n) {
+  for (int i = 0; i < n; ++i) {
+    string key = randomKey(rng);
+    if (rng() % 4 == 0) {
+      m.del(key);
+      ref.erase(key);
+    } else {
+      uint64_t value = randomValue<uint64_t>(rng);
+      m.set(key, value);
+      ref[key] = value;
+    }
+  }
+}
+
+/**
+ * Probes for lookups, seeks and scans: random keys, the empty key and keys
+ * around the long runs of 'p' and the 0xff bytes.
+ */
+std::vector<string> probes(std::mt19937_64 &rng) {
+  std::vector<string> probes = {string(),          string(1, '\0'),
+                                string(1, '\xff'), string(3, '\xff'),
+                                string(9, 'p'),    string(12, 'p'),
+                                string(12, 'p') + 'a'};
+  for (int i = 0; i < 200; ++i)
+    probes.push_back(randomKey(rng));
+  return probes;
+}
+
+/**
+ * Checks that the frozen tree holds exactly the reference's keys, which the
+ * source tree held when it was frozen, and that lookups, seeks and scans
+ * agree with both.
+ */
+void checkFrozen(const art::FrozenArt<uint64_t> &f, art::Art<uint64_t> &m,
+                 const std::map<string, uint64_t> &ref,
+                 const std::vector<string> &probes) {
+  ART_CHECK(f.size() == ref.size());
+  auto it = f.begin();
+  auto source = m.begin();
+  for (const auto &[key, value] : ref) {
+    ART_CHECK(it != f.end() && it.key() == key && *it == value);
+    ART_CHECK(source != m.end() && source.key() == key);
+    ART_CHECK(f.get(key) == value);
+    ++it;
+    ++source;
+  }
+  ART_CHECK(it == f.end() && source == m.end());
+
+  for (std::size_t i = 0; i < probes.size(); ++i) {
+    const string &probe = probes[i];
+    auto found = ref.find(probe);
+    ART_CHECK(f.get(probe) == (found != ref.end() ? found->second : 0));
+
+    auto lower = ref.lower_bound(probe);
+    auto seek = f.begin(probe);
+    if (lower == ref.end()) {
+      ART_CHECK(seek == f.end());
+    } else {
+      ART_CHECK(seek != f.end() && seek.key() == lower->first);
+    }
+
+    const string &other = probes[(i + 1) % probes.size()];
+    auto collect = [](entries &out) {
+      return [&out](std::string_view key, const uint64_t &value) {
+        out.emplace_back(key, value);
+        return true;
+      };
+    };
+    entries frozen, expected;
+    ART_CHECK(f.scan(probe, other, collect(frozen)));
+    ART_CHECK(m.scan(probe, other, collect(expected)));
+    ART_CHECK(frozen == expected);
+    if (probe < other)
+      ART_CHECK(expected == entries(lower, ref.lower_bound(other)));
+
+    frozen.clear();
+    expected.clear();
+    ART_CHECK(f.scanPrefix(probe, collect(frozen)));
+    ART_CHECK(m.scanPrefix(probe, collect(expected)));
+    ART_CHECK(frozen == expected);
+    auto past = lower;
+    while (past != ref.end() &&
+           past->first.compare(0, probe.size(), probe) == 0)
+      ++past;
+    ART_CHECK(expected == entries(lower, past));
+  }
+
+  /* scans stop as soon as the callback returns false */
+  std::size_t nCalls = 0;
+  bool finished = f.scan("", string(4, '\xff'),
+                         [&](std::string_view, const uint64_t &) {
+                           return ++nCalls < 3;
+                         });
+  ART_CHECK(finished == (ref.size() < 3) &&
+            nCalls == std::min<std::size_t>(ref.size(), 3));
+}
+
+/**
+ * Serves images returned by freeze(), from the empty tree on.
+ */
+void testImage() {
+  std::mt19937_64 rng(1);
+  art::Art<uint64_t> m;
+  std::map<string, uint64_t> ref;
+  std::vector<string> keys = probes(rng);
+  for (int round = 0; round < 5; ++round) {
+    art::FrozenArt<uint64_t> f(m.freeze());
+    checkFrozen(f, m, ref, keys);
+    mutate(m, ref, rng, 2000 << round);
+  }
+}
+
+/**
+ * Maps images written by freeze(path). Freezing to the same path again
+ * replaces the file, while the trees that mapped the previous image keep
+ * reading it, as do frozen snapshots.
+ */
+void testFile() {
+  tempDir dir;
+  string path = dir.file("frozen.art");
+  std::mt19937_64 rng(2);
+  art::Art<uint64_t> m;
+  std::map<string, uint64_t> ref;
+  std::vector<string> keys = probes(rng);
+
+  mutate(m, ref, rng, 20000);
+  m.freeze(path.c_str());
+  art::FrozenArt<uint64_t> old(path.c_str());
+  checkFrozen(old, m, ref, keys);
+
+  std::map<string, uint64_t> oldRef = ref;
+  auto snapshot = m.snapshot();
+  mutate(m, ref, rng, 5000);
+  m.freeze(path.c_str());
+  art::FrozenArt<uint64_t> f(path.c_str());
+  checkFrozen(f, m, ref, keys);
+  ART_CHECK(old.size() == oldRef.size());
+  art::FrozenArt<uint64_t> frozenSnapshot(snapshot.freeze());
+  ART_CHECK(frozenSnapshot.size() == oldRef.size());
+  auto it = old.begin();
+  auto snapshotIt = frozenSnapshot.begin();
+  for (const auto &[key, value] : oldRef) {
+    ART_CHECK(it != old.end() && it.key() == key && *it == value);
+    ART_CHECK(snapshotIt.key() == key && *snapshotIt == value);
+    ++it;
+    ++snapshotIt;
+  }
+
+  /* moving a mapped tree hands over the mapping */
+  art::FrozenArt<uint64_t> moved(std::move(f));
+  ART_CHECK(moved.size() == ref.size());
+  f = std::move(old);
+  ART_CHECK(f.size() == oldRef.size());
+
+  bool threw = false;
+  try {
+    art::FrozenArt<uint64_t> missing(dir.file("missing.art").c_str());
+  } catch (const std::system_error &) {
+    threw = true;
+  }
+  ART_CHECK(threw);
+
+  string shortPath = dir.file("short.art");
+  std::ofstream(shortPath, std::ios::binary) << "art";
+  threw = false;
+  try {
+    art::FrozenArt<uint64_t> truncated(shortPath.c_str());
+  } catch (const std::invalid_argument &) {
+    threw = true;
+  }
+  ART_CHECK(threw);
+}
+
+int main() {
+  testImage();
+  testFile();
+  std::cout << "ok" << std::endl;
+  return 0;
+}
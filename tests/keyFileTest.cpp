@@ -0,0 +1,171 @@
+#include "../include/art.hpp"
+#include "test.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+using std::string;
+
+using lines = std::vector<std::pair<string, string>>;
+
+/**
+ * Writes the given content to the file at the given path.
+ */
+void writeFile(const string &path, const string &content) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file << content;
+  ART_CHECK(file.good());
+}
+
+/**
+ * The keys and values of the file's lines.
+ */
+lines readLines(const art::KeyFile &file) {
+  lines read;
+  std::size_t nLines =
+      file.forEach([&](std::string_view key, std::string_view value) {
+        read.emplace_back(key, value);
+      });
+  ART_CHECK(nLines == read.size());
+  return read;
+}
+
+/**
+ * Value of a line, 1 for lines without one.
+ */
+uint64_t parseValue(std::string_view value) {
+  return value.empty() ? 1 : std::stoull(string(value));
+}
+
+/**
+ * Splits lines at the first tab and drops carriage returns before the
+ * newline. Empty lines are empty keys, and a missing newline at the end of
+ * the file makes no difference.
+ */
+void testParse() {
+  tempDir dir;
+  string path = dir.file("parse.txt");
+
+  writeFile(path, "a\t1\nb\r\nc\t2\r\n\n\td\ne\tx\ty\n\r\nf\rg\t\n");
+  art::KeyFile file(path.c_str());
+  lines expected = {{"a", "1"}, {"b", ""},     {"c", "2"}, {"", ""},
+                    {"", "d"},  {"e", "x\ty"}, {"", ""},   {"f\rg", ""}};
+  ART_CHECK(readLines(file) == expected);
+  std::size_t nLines;
+  ART_CHECK(!file.sorted(nLines) && nLines == expected.size());
+
+  writeFile(path, "a\nb\t2");
+  ART_CHECK(readLines(art::KeyFile(path.c_str())) ==
+            (lines{{"a", ""}, {"b", "2"}}));
+  writeFile(path, "\n");
+  ART_CHECK(readLines(art::KeyFile(path.c_str())) == (lines{{"", ""}}));
+  writeFile(path, "");
+  art::KeyFile empty(path.c_str());
+  ART_CHECK(empty.data().empty() && readLines(empty).empty());
+  ART_CHECK(empty.sorted(nLines) && nLines == 0);
+
+  /* bytes above 0x7f sort after ASCII, like in the tree */
+  writeFile(path, "\na\nab\nb\n\xc3\xa9\n\xff");
+  ART_CHECK(art::KeyFile(path.c_str()).sorted(nLines) && nLines == 6);
+  writeFile(path, "a\nb\nb\n");
+  ART_CHECK(!art::KeyFile(path.c_str()).sorted(nLines) && nLines == 3);
+
+  /* moving hands over the mapping */
+  writeFile(path, "a\t1\n");
+  art::KeyFile moved(path.c_str());
+  art::KeyFile other = std::move(moved);
+  ART_CHECK(readLines(other) == (lines{{"a", "1"}}));
+  moved = std::move(other);
+  ART_CHECK(moved.data() == "a\t1\n");
+
+  bool threw = false;
+  try {
+    art::KeyFile missing(dir.file("missing.txt").c_str());
+  } catch (const std::system_error &) {
+    threw = true;
+  }
+  ART_CHECK(threw);
+}
+
+/**
+ * Loads sorted files through bulkLoad() and unsorted ones, or files with
+ * duplicate keys, through set(), where later lines win, and compares the
+ * trees with a std::map.
+ */
+void testLoad() {
+  tempDir dir;
+  string path = dir.file("load.txt");
+  std::mt19937_64 rng(1);
+
+  std::map<string, uint64_t> unique;
+  for (int i = 0; i < 5000; ++i) {
+    string key = randomKey(rng);
+    /* keys holding line breaks or tabs can't be written to the file */
+    if (key.find_first_of("\n\r\t") == string::npos)
+      unique[key] = rng() % 1000 + 1;
+  }
+  std::vector<std::pair<string, uint64_t>> entries(unique.begin(),
+                                                   unique.end());
+  for (int round = 0; round < 3; ++round) {
+    /* sorted and unique, shuffled, and shuffled with duplicates */
+    std::vector<std::pair<string, uint64_t>> written = entries;
+    if (round > 0)
+      std::shuffle(written.begin(), written.end(), rng);
+    if (round == 2) {
+      for (int i = 0; i < 1000; ++i)
+        written.emplace_back(entries[rng() % entries.size()].first,
+                             rng() % 1000 + 1);
+    }
+    std::map<string, uint64_t> ref;
+    string content;
+    for (const auto &[key, value] : written) {
+      content += key + '\t' + std::to_string(value);
+      content += rng() % 2 ? "\n" : "\r\n";
+      ref[key] = value;
+    }
+    writeFile(path, content);
+
+    art::KeyFile file(path.c_str());
+    std::size_t nLines;
+    ART_CHECK(file.sorted(nLines) == (round == 0) &&
+              nLines == written.size());
+    art::Art<uint64_t> m;
+    ART_CHECK(file.load(m, parseValue) == written.size());
+    auto it = m.begin();
+    for (const auto &[key, value] : ref) {
+      ART_CHECK(it != m.end() && it.key() == key && *it == value);
+      ++it;
+    }
+    ART_CHECK(it == m.end());
+  }
+
+  /* a sorted file is set into a tree that is not empty */
+  writeFile(path, "a\t1\nb\t2\n");
+  art::Art<uint64_t> m;
+  m.set("b", 5);
+  m.set("c", 3);
+  ART_CHECK(art::KeyFile(path.c_str()).load(m, parseValue) == 2);
+  ART_CHECK(m.get("a") == 1 && m.get("b") == 2 && m.get("c") == 3);
+
+  /* adjacent duplicates are not sorted, the last one wins */
+  writeFile(path, "a\t1\na\t2\nb");
+  art::Art<uint64_t> d;
+  ART_CHECK(art::KeyFile(path.c_str()).load(d, parseValue) == 3);
+  ART_CHECK(d.get("a") == 2 && d.get("b") == 1);
+}
+
+int main() {
+  testParse();
+  testLoad();
+  std::cout << "ok" << std::endl;
+  return 0;
+}
@@ -0,0 +1,168 @@
+#include "../include/art.hpp"
+#include "test.hpp"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <random>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+/**
+ * Checks that the encodings of the given keys, which are in ascending
+ * order, are strictly ascending under memcmp and decode to the same bits.
+ */
+template <class K> void checkAscending(const std::vector<K> &keys) {
+  using traits = art::KeyTraits<K>;
+  std::vector<uint8_t> prev(traits::size), cur(traits::size);
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    traits::encode(keys[i], cur.data());
+    ART_CHECK(i == 0 ||
+              std::memcmp(prev.data(), cur.data(), traits::size) < 0);
+    K decoded = traits::decode(cur.data());
+    ART_CHECK(std::memcmp(&decoded, &keys[i], sizeof(K)) == 0 ||
+              decoded == keys[i]);
+    prev.swap(cur);
+  }
+}
+
+/**
+ * Checks that the encodings of random keys compare like the keys, and that
+ * a KeyedArt iterates them in the order of a std::map.
+ */
+template <class K, class Gen> void checkRandom(Gen gen) {
+  using traits = art::KeyTraits<K>;
+  std::mt19937_64 rng(sizeof(K));
+  std::vector<K> keys;
+  for (int i = 0; i < 2000; ++i)
+    keys.push_back(gen(rng));
+  std::vector<uint8_t> a(traits::size), b(traits::size);
+  for (std::size_t i = 0; i + 1 < keys.size(); ++i) {
+    traits::encode(keys[i], a.data());
+    traits::encode(keys[i + 1], b.data());
+    int order = std::memcmp(a.data(), b.data(), traits::size);
+    ART_CHECK((order < 0) == (keys[i] < keys[i + 1]));
+    ART_CHECK((order == 0) == (keys[i] == keys[i + 1]));
+    ART_CHECK(traits::decode(a.data()) == keys[i]);
+  }
+
+  art::KeyedArt<K, uint64_t> m;
+  std::map<K, uint64_t> ref;
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    m.set(keys[i], i + 1);
+    ref[keys[i]] = i + 1;
+  }
+  auto it = m.begin();
+  for (const auto &[key, value] : ref) {
+    ART_CHECK(it != m.end() && m.key(it) == key && *it == value);
+    ART_CHECK(m.get(key) == value);
+    ++it;
+  }
+  ART_CHECK(it == m.end());
+}
+
+/**
+ * Signed integers sort negative numbers first, from the smallest on, and
+ * enums sort like their underlying type.
+ */
+void testIntegers() {
+  checkAscending<int8_t>({-128, -127, -2, -1, 0, 1, 2, 126, 127});
+  checkAscending<int16_t>({INT16_MIN, -256, -255, -1, 0, 1, 255, 256,
+                           INT16_MAX});
+  checkAscending<int32_t>({INT32_MIN, INT32_MIN + 1, -65536, -1, 0, 1, 65536,
+                           INT32_MAX - 1, INT32_MAX});
+  checkAscending<int64_t>({INT64_MIN, INT64_MIN + 1, -(int64_t{1} << 32), -1,
+                           0, 1, int64_t{1} << 32, INT64_MAX});
+  checkAscending<uint32_t>({0, 1, 255, 256, 65536, UINT32_MAX});
+  checkAscending<uint64_t>({0, 1, 256, uint64_t{1} << 63, UINT64_MAX});
+
+  enum class level : int8_t { low = -5, none = 0, high = 5 };
+  checkAscending<level>({level::low, level::none, level::high});
+
+  checkRandom<int64_t>([](std::mt19937_64 &rng) {
+    /* mostly small magnitudes, so that keys repeat */
+    return rng() % 2 ? static_cast<int64_t>(rng())
+                     : static_cast<int64_t>(rng() % 64) - 32;
+  });
+  checkRandom<int16_t>(
+      [](std::mt19937_64 &rng) { return static_cast<int16_t>(rng()); });
+}
+
+/**
+ * Floating point numbers sort from -inf through the negative numbers, the
+ * negative denormals, -0.0 right before 0.0, the positive denormals and
+ * numbers up to inf.
+ */
+template <class F> void testFloats() {
+  using limits = std::numeric_limits<F>;
+  F denorm = limits::denorm_min();
+  checkAscending<F>({-limits::infinity(), -limits::max(), F(-1.5), F(-1),
+                     -limits::min(), -limits::min() / 2, -denorm * 2, -denorm,
+                     F(-0.0), F(0.0), denorm, denorm * 2, limits::min() / 2,
+                     limits::min(), F(1), F(1.5), limits::max(),
+                     limits::infinity()});
+
+  /* -0.0 and 0.0 are different keys that both round-trip with their sign */
+  uint8_t buf[sizeof(F)];
+  art::KeyTraits<F>::encode(F(-0.0), buf);
+  ART_CHECK(std::signbit(art::KeyTraits<F>::decode(buf)));
+  art::KeyTraits<F>::encode(F(0.0), buf);
+  ART_CHECK(!std::signbit(art::KeyTraits<F>::decode(buf)));
+
+  checkRandom<F>([](std::mt19937_64 &rng) {
+    switch (rng() % 4) {
+    case 0:
+      return static_cast<F>(static_cast<int>(rng() % 64) - 32) / 4;
+    case 1:
+      return std::ldexp(F(1), static_cast<int>(rng() % 60) - 30) *
+             (rng() % 2 ? 1 : -1);
+    case 2:
+      /* never zero: -0.0 and 0.0 are equal, but different keys */
+      return limits::denorm_min() * static_cast<F>(rng() % 1000 + 1) *
+             (rng() % 2 ? 1 : -1);
+    default:
+      return static_cast<F>(static_cast<double>(rng()) / 3.0) *
+             (rng() % 2 ? 1 : -1);
+    }
+  });
+}
+
+/**
+ * Tuples and pairs sort element by element, the first element first.
+ */
+void testTuples() {
+  using key = std::tuple<int32_t, double, uint8_t>;
+  checkAscending<key>({{-2, 5.0, 255},
+                       {-1, -1.0, 0},
+                       {-1, -0.0, 0},
+                       {-1, 0.0, 0},
+                       {-1, 0.0, 1},
+                       {0, -std::numeric_limits<double>::infinity(), 0},
+                       {0, 1e-310, 0},
+                       {1, 0.0, 0}});
+  checkAscending<std::pair<int64_t, float>>(
+      {{INT64_MIN, 1.0f}, {-1, -1.0f}, {-1, 1.0f}, {0, -2.0f}, {INT64_MAX, 0}});
+
+  using small = std::tuple<int16_t, int8_t, uint16_t>;
+  checkRandom<small>([](std::mt19937_64 &rng) {
+    return small(static_cast<int>(rng() % 7) - 3, static_cast<int8_t>(rng()),
+                 rng() % 5);
+  });
+  checkRandom<std::pair<int32_t, double>>([](std::mt19937_64 &rng) {
+    return std::make_pair(static_cast<int32_t>(rng() % 5) - 2,
+                          static_cast<int>(rng() % 9) - 4.0);
+  });
+}
+
+int main() {
+  testIntegers();
+  testFloats<float>();
+  testFloats<double>();
+  testTuples();
+  std::cout << "ok" << std::endl;
+  return 0;
+}
@@ -0,0 +1,199 @@
+#include "../include/art.hpp"
+#include "test.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using std::string;
+
+using entries = std::vector<std::pair<string, uint64_t>>;
+
+/**
+ * Checks that the tree holds exactly the given sorted entries.
+ */
+void checkHolds(art::Art<uint64_t> &m, const entries &sorted) {
+  auto it = m.begin();
+  for (const auto &[key, value] : sorted) {
+    ART_CHECK(it != m.end() && it.key() == key && *it == value);
+    ART_CHECK(m.get(key) == value);
+    ++it;
+  }
+  ART_CHECK(it == m.end());
+}
+
+/**
+ * Random unique entries, sorted, whose keys share their first bytes and
+ * start with the given byte unless it is 0, in which case the empty key
+ * is likely among them.
+ */
+entries randomEntries(std::mt19937_64 &rng, int n, char first = 0) {
+  std::map<string, uint64_t> ref;
+  for (int i = 0; i < n; ++i) {
+    string key = randomKey(rng);
+    if (first != 0)
+      key.insert(key.begin(), first);
+    ref[key] = randomValue<uint64_t>(rng);
+  }
+  return entries(ref.begin(), ref.end());
+}
+
+/**
+ * Loads shuffled entries in parallel, with and without the empty key,
+ * into trees counting their keys or not, and compares the result with a
+ * sequential bulkLoad() of the sorted entries.
+ */
+void testBulkLoad(art::ThreadPool &pool) {
+  std::mt19937_64 rng(1);
+  std::vector<entries> inputs = {entries(),
+                                 entries{{"", 7}},
+                                 entries{{"only", 1}},
+                                 randomEntries(rng, 20000),
+                                 randomEntries(rng, 20000, 'p'),
+                                 randomEntries(rng, 500, 'a')};
+  inputs.back().emplace_back("b", 2);
+  for (const entries &sorted : inputs) {
+    art::Art<uint64_t> sequential;
+    sequential.bulkLoad(sorted.begin(), sorted.end());
+    checkHolds(sequential, sorted);
+
+    for (bool countKeys : {false, true}) {
+      entries shuffled = sorted;
+      std::shuffle(shuffled.begin(), shuffled.end(), rng);
+      art::Art<uint64_t> m(countKeys);
+      m.parallelBulkLoad(shuffled.begin(), shuffled.end(), pool);
+      checkHolds(m, sorted);
+      if (countKeys)
+        ART_CHECK(m.size() == sorted.size());
+
+      /* the loaded tree is modified like any other */
+      m.set("added", 3);
+      ART_CHECK(m.get("added") == 3);
+      if (!sorted.empty())
+        ART_CHECK(m.del(sorted.front().first) == sorted.front().second);
+    }
+  }
+}
+
+/**
+ * A duplicate key makes parallelBulkLoad() throw, whether it is found
+ * before the groups are built or by the task building its group, whose
+ * exception comes through taskGroup::wait(). The tree stays empty and can
+ * be loaded again.
+ */
+void testDuplicates(art::ThreadPool &pool) {
+  std::mt19937_64 rng(2);
+  entries sorted = randomEntries(rng, 5000);
+  std::vector<entries> inputs;
+  /* the empty key is added twice, in case it is not among the keys */
+  for (const string &duplicate : {sorted.front().first, sorted[2500].first,
+                                  sorted.back().first, string()}) {
+    entries input = sorted;
+    input.emplace_back(duplicate, 1);
+    if (duplicate.empty())
+      input.emplace_back(duplicate, 2);
+    std::shuffle(input.begin(), input.end(), rng);
+    inputs.push_back(std::move(input));
+  }
+
+  for (const entries &input : inputs) {
+    art::Art<uint64_t> m;
+    bool threw = false;
+    try {
+      m.parallelBulkLoad(input.begin(), input.end(), pool);
+    } catch (const std::invalid_argument &) {
+      threw = true;
+    }
+    ART_CHECK(threw);
+    ART_CHECK(m.begin() == m.end());
+    m.parallelBulkLoad(sorted.begin(), sorted.end(), pool);
+    checkHolds(m, sorted);
+  }
+
+  art::Art<uint64_t> m;
+  m.set("key", 1);
+  bool threw = false;
+  try {
+    m.parallelBulkLoad(sorted.begin(), sorted.end(), pool);
+  } catch (const std::logic_error &) {
+    threw = true;
+  }
+  ART_CHECK(threw);
+}
+
+/**
+ * Scans ranges of trees of different sizes in parallel. Unordered scans
+ * visit every key in [lo, hi) exactly once from any thread, ordered scans
+ * visit them in lexicographic order from the calling thread.
+ */
+void testScan(art::ThreadPool &pool) {
+  std::mt19937_64 rng(3);
+  std::vector<string> bounds = {string(), string(1, '\0'), string(1, 'a'),
+                                string(12, 'p'), string(3, '\xff')};
+  for (int i = 0; i < 40; ++i)
+    bounds.push_back(randomKey(rng));
+
+  for (int n : {0, 1, 30, 20000}) {
+    entries sorted = randomEntries(rng, n);
+    std::map<string, uint64_t> ref(sorted.begin(), sorted.end());
+    art::Art<uint64_t> m;
+    m.bulkLoad(sorted.begin(), sorted.end());
+
+    for (std::size_t i = 0; i <= bounds.size(); ++i) {
+      /* the last round scans the whole tree */
+      bool whole = i == bounds.size();
+      string lo = whole ? string() : bounds[i];
+      string hi = whole ? string() : bounds[(i * 7 + 1) % bounds.size()];
+      entries expected;
+      if (whole || lo < hi) {
+        auto end = whole ? ref.end() : ref.lower_bound(hi);
+        expected.assign(ref.lower_bound(lo), end);
+      }
+
+      std::mutex mutex;
+      entries visited;
+      auto collect = [&](std::string_view key, uint64_t value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        visited.emplace_back(key, value);
+      };
+      if (whole)
+        m.parallelScan(collect, pool);
+      else
+        m.parallelScan(lo, hi, collect, pool);
+      std::sort(visited.begin(), visited.end());
+      ART_CHECK(visited == expected);
+
+      visited.clear();
+      std::thread::id caller = std::this_thread::get_id();
+      auto append = [&](std::string_view key, uint64_t value) {
+        ART_CHECK(std::this_thread::get_id() == caller);
+        visited.emplace_back(key, value);
+      };
+      if (whole)
+        m.parallelScan(append, pool, true);
+      else
+        m.parallelScan(lo, hi, append, pool, true);
+      ART_CHECK(visited == expected);
+    }
+  }
+}
+
+int main() {
+  for (std::size_t nThreads : {1, 4}) {
+    art::ThreadPool pool(nThreads);
+    testBulkLoad(pool);
+    testDuplicates(pool);
+    testScan(pool);
+  }
+  std::cout << "ok" << std::endl;
+  return 0;
+}
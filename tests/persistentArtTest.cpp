@@ -0,0 +1,233 @@
+#include "../include/art.hpp"
+#include "test.hpp"
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <fcntl.h>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <utility>
+
+using std::string;
+
+/* region reserved for the test files, far below the default */
+constexpr std::size_t capacity = std::size_t(1) << 30;
+
+/**
+ * Sets or deletes n random keys in the reference and, unless null, in the
+ * tree, checking the values the tree returns.
+ */
+void mutate(art::PersistentArt<uint64_t> *p, std::map<string, uint64_t> &ref,
+            std::mt19937_64 &rng, int n) {
+  for (int i = 0; i < n; ++i) {
+    string key = randomKey(rng);
+    auto found = ref.find(key);
+    uint64_t expected = found != ref.end() ? found->second : 0;
+    if (rng() % 3 == 0) {
+      if (p != nullptr)
+        ART_CHECK(p->del(key) == expected);
+      ref.erase(key);
+    } else {
+      uint64_t value = randomValue<uint64_t>(rng);
+      if (p != nullptr)
+        ART_CHECK(p->set(key, value) == expected);
+      ref[key] = value;
+    }
+  }
+}
+
+/**
+ * Determines if the tree holds exactly the reference's keys.
+ */
+bool holds(art::PersistentArt<uint64_t> &p,
+           const std::map<string, uint64_t> &ref) {
+  auto it = p.begin();
+  for (const auto &[key, value] : ref) {
+    if (it == p.end() || it.key() != key || *it != value ||
+        p.get(key) != value)
+      return false;
+    ++it;
+  }
+  return it == p.end();
+}
+
+/**
+ * Closes and reopens the tree between rounds of modifications.
+ */
+void testReopen() {
+  tempDir dir;
+  string path = dir.file("reopen.art");
+  std::mt19937_64 rng(5);
+  std::map<string, uint64_t> ref;
+  for (int round = 0; round < 5; ++round) {
+    art::PersistentArt<uint64_t> p(path.c_str(), false, capacity);
+    ART_CHECK(holds(p, ref));
+    mutate(&p, ref, rng, 5000);
+    if (round % 2 == 0)
+      p.checkpoint();
+    mutate(&p, ref, rng, 1000);
+  }
+  art::PersistentArt<uint64_t> p(path.c_str(), false, capacity);
+  ART_CHECK(holds(p, ref));
+}
+
+/**
+ * Kills a process that modifies the tree and checkpoints it in a loop,
+ * reporting every checkpoint that returned. The reopened tree must hold the
+ * last reported checkpoint, or the next one if the process was killed
+ * between committing it and reporting it. It is then modified and closed,
+ * reusing the space freed since the checkpoint.
+ */
+void testKill() {
+  tempDir dir;
+  string path = dir.file("kill.art");
+  std::mt19937_64 rng(6);
+  std::map<string, uint64_t> ref;
+  for (int round = 0; round < 8; ++round) {
+    int fds[2];
+    ART_CHECK(::pipe(fds) == 0);
+    pid_t pid = ::fork();
+    ART_CHECK(pid >= 0);
+    if (pid == 0) {
+      ::close(fds[0]);
+      art::PersistentArt<uint64_t> p(path.c_str(), false, capacity);
+      for (int checkpoint = 0;; ++checkpoint) {
+        mutate(&p, ref, rng, 500);
+        p.checkpoint();
+        if (::write(fds[1], &checkpoint, sizeof(checkpoint)) !=
+            sizeof(checkpoint))
+          ::_exit(1);
+      }
+    }
+    ::close(fds[1]);
+    /* let the child run a varying number of checkpoints */
+    ::usleep(20000 + 40000 * round);
+    ::kill(pid, SIGKILL);
+    int status;
+    ART_CHECK(::waitpid(pid, &status, 0) == pid);
+    ART_CHECK(WIFSIGNALED(status) && WTERMSIG(status) == SIGKILL);
+    int reported = -1, checkpoint;
+    while (::read(fds[0], &checkpoint, sizeof(checkpoint)) ==
+           sizeof(checkpoint))
+      reported = checkpoint;
+    ::close(fds[0]);
+
+    /* replay the child's modifications up to its last reported checkpoint */
+    for (int i = 0; i <= reported; ++i)
+      mutate(nullptr, ref, rng, 500);
+    std::map<string, uint64_t> next = ref;
+    std::mt19937_64 nextRng = rng;
+    mutate(nullptr, next, nextRng, 500);
+    {
+      art::PersistentArt<uint64_t> p(path.c_str(), false, capacity);
+      if (!holds(p, ref)) {
+        ref = std::move(next);
+        rng = nextRng;
+      }
+      ART_CHECK(holds(p, ref));
+      mutate(&p, ref, rng, 2000);
+    }
+    art::PersistentArt<uint64_t> p(path.c_str(), false, capacity);
+    ART_CHECK(holds(p, ref));
+  }
+}
+
+/**
+ * Base address of the last checkpoint of the file. The header's two root
+ * slots start at offset 16, 48 bytes apart, with the sequence number and
+ * the base as their first fields.
+ */
+uint64_t lastBase(const string &path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  ART_CHECK(fd >= 0);
+  uint64_t fields[8];
+  ART_CHECK(::pread(fd, fields, sizeof(fields), 16) == sizeof(fields));
+  ::close(fd);
+  return fields[0] > fields[6] ? fields[1] : fields[7];
+}
+
+/**
+ * Maps a page at the base of the file's last checkpoint, so that the file
+ * is mapped elsewhere and its tree relocated when it is opened.
+ */
+void *blockBase(const string &path) {
+  void *base = reinterpret_cast<void *>(lastBase(path));
+  void *page =
+      ::mmap(base, 4096, PROT_NONE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+  ART_CHECK(page == base);
+  return page;
+}
+
+/**
+ * Opens the file while the address it was written at is taken, so that the
+ * tree is copied to the new base, modifies the relocated tree and reopens
+ * it. Then kills a process that opens the file in a loop, each time at
+ * another base, most likely in the middle of a relocation. The reopened
+ * tree must hold the keys, as relocating commits the copy only once it is
+ * complete.
+ */
+void testRelocate() {
+  tempDir dir;
+  string path = dir.file("relocate.art");
+  std::mt19937_64 rng(7);
+  std::map<string, uint64_t> ref;
+  {
+    art::PersistentArt<uint64_t> p(path.c_str(), false, capacity);
+    mutate(&p, ref, rng, 20000);
+  }
+  for (int round = 0; round < 3; ++round) {
+    uint64_t base = lastBase(path);
+    void *page = blockBase(path);
+    {
+      art::PersistentArt<uint64_t> p(path.c_str(), false, capacity);
+      ART_CHECK(holds(p, ref));
+      mutate(&p, ref, rng, 2000);
+      if (round == 1)
+        p.checkpoint();
+    }
+    ART_CHECK(lastBase(path) != base);
+    ::munmap(page, 4096);
+    art::PersistentArt<uint64_t> p(path.c_str(), false, capacity);
+    ART_CHECK(holds(p, ref));
+  }
+
+  for (int round = 0; round < 8; ++round) {
+    pid_t pid = ::fork();
+    ART_CHECK(pid >= 0);
+    if (pid == 0) {
+      for (;;) {
+        blockBase(path);
+        art::PersistentArt<uint64_t> p(path.c_str(), false, capacity);
+      }
+    }
+    ::usleep(10000 + 15000 * round);
+    ::kill(pid, SIGKILL);
+    int status;
+    ART_CHECK(::waitpid(pid, &status, 0) == pid);
+    ART_CHECK(WIFSIGNALED(status) && WTERMSIG(status) == SIGKILL);
+
+    void *page = round % 2 == 0 ? blockBase(path) : nullptr;
+    {
+      art::PersistentArt<uint64_t> p(path.c_str(), false, capacity);
+      ART_CHECK(holds(p, ref));
+    }
+    if (page != nullptr)
+      ::munmap(page, 4096);
+  }
+  art::PersistentArt<uint64_t> p(path.c_str(), false, capacity);
+  ART_CHECK(holds(p, ref));
+}
+
+int main() {
+  testReopen();
+  testKill();
+  testRelocate();
+  std::cout << "ok" << std::endl;
+  return 0;
+}
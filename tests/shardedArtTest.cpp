@@ -0,0 +1,223 @@
+#include "../include/art.hpp"
+#include "test.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using std::string;
+
+/**
+ * Checks that the tree holds exactly the reference's keys in order across
+ * its shards, and that seeking from the probes and from every shard
+ * boundary lands where lower_bound() does.
+ */
+void checkSame(art::ShardedArt<uint64_t> &m,
+               const std::map<string, uint64_t> &ref,
+               std::vector<string> probes) {
+  auto it = m.begin();
+  for (const auto &[key, value] : ref) {
+    ART_CHECK(it != m.end());
+    ART_CHECK(it.key() == key);
+    ART_CHECK(*it == value);
+    ART_CHECK(m.get(key) == value);
+    ++it;
+  }
+  ART_CHECK(it == m.end());
+
+  for (const string &probe : probes) {
+    auto lower = ref.lower_bound(probe);
+    auto seek = m.begin(probe);
+    if (lower == ref.end()) {
+      ART_CHECK(seek == m.end());
+    } else {
+      ART_CHECK(seek != m.end() && seek.key() == lower->first);
+    }
+  }
+}
+
+/**
+ * Applies random sets and deletes to the tree and to a std::map and
+ * compares them, seeking from the given probes as well.
+ */
+void testAgainstMap(art::ShardedArt<uint64_t> &m,
+                    const std::vector<string> &probes, uint64_t seed) {
+  std::mt19937_64 rng(seed);
+  std::map<string, uint64_t> ref;
+  for (int round = 0; round < 6; ++round) {
+    int setPercent = round % 2 == 0 ? 80 : 30;
+    for (int i = 0; i < 4000; ++i) {
+      string key = randomKey(rng);
+      auto found = ref.find(key);
+      uint64_t expected = found != ref.end() ? found->second : 0;
+      if (static_cast<int>(rng() % 100) < setPercent) {
+        uint64_t value = randomValue<uint64_t>(rng);
+        ART_CHECK(m.set(key, value) == expected);
+        ref[key] = value;
+      } else {
+        ART_CHECK(m.del(key) == expected);
+        ref.erase(key);
+      }
+    }
+    checkSame(m, ref, probes);
+  }
+}
+
+/**
+ * Probes around the given boundaries: each boundary, the key just before
+ * it and keys extending it, along with random keys.
+ */
+std::vector<string> boundaryProbes(const std::vector<string> &boundaries,
+                                   uint64_t seed) {
+  std::mt19937_64 rng(seed);
+  std::vector<string> probes = {string(), string(1, '\0'),
+                                string(3, '\xff')};
+  for (const string &boundary : boundaries) {
+    probes.push_back(boundary);
+    probes.push_back(boundary + '\0');
+    probes.push_back(boundary + 'a');
+    string before = boundary;
+    if (before.back() == '\0') {
+      before.pop_back();
+    } else {
+      --before.back();
+      before += "\xff\xff";
+    }
+    probes.push_back(before);
+  }
+  for (int i = 0; i < 200; ++i)
+    probes.push_back(randomKey(rng));
+  return probes;
+}
+
+/**
+ * Even splits into 4 and 16 shards, boundaries given explicitly and
+ * boundaries derived from a sample of the keys.
+ */
+void testShards() {
+  {
+    art::ShardedArt<uint64_t> m(2);
+    ART_CHECK(m.nShards() == 4);
+    testAgainstMap(m, boundaryProbes({"@", "\x80", "\xc0"}, 1), 1);
+  }
+  {
+    art::ShardedArt<uint64_t> m(4);
+    ART_CHECK(m.nShards() == 16);
+    testAgainstMap(m, boundaryProbes({"\x10", "a", "\xf0"}, 2), 2);
+  }
+  {
+    std::vector<string> boundaries = {"a",  "aa", "ab", "b",  "ba", "c",
+                                      "cd", "d",  "pp", "pppppppppppp", "q"};
+    art::ShardedArt<uint64_t> m(boundaries);
+    ART_CHECK(m.nShards() == 12);
+    testAgainstMap(m, boundaryProbes(boundaries, 3), 3);
+  }
+  {
+    std::mt19937_64 rng(4);
+    std::vector<string> sample;
+    for (int i = 0; i < 2000; ++i)
+      sample.push_back(randomKey(rng));
+    std::vector<string> boundaries =
+        art::ShardedArt<uint64_t>::splitSample(sample.begin(), sample.end(),
+                                               8);
+    art::ShardedArt<uint64_t> m(boundaries);
+    testAgainstMap(m, boundaryProbes(boundaries, 4), 4);
+  }
+}
+
+/**
+ * Boundaries derived from a sample are non-empty and ascending and split
+ * the sample into shards of about the same size.
+ */
+void testSplitSample() {
+  std::vector<string> none;
+  ART_CHECK(art::ShardedArt<uint64_t>::splitSample(none.begin(), none.end(),
+                                                   4)
+                .empty());
+
+  std::vector<string> one = {"x", "x", "x"};
+  auto boundaries =
+      art::ShardedArt<uint64_t>::splitSample(one.begin(), one.end(), 4);
+  ART_CHECK(boundaries.size() <= 1);
+
+  std::vector<string> sample;
+  for (int i = 0; i < 1000; ++i)
+    sample.push_back("key" + std::to_string(i));
+  boundaries =
+      art::ShardedArt<uint64_t>::splitSample(sample.begin(), sample.end(), 10);
+  ART_CHECK(boundaries.size() == 9);
+  for (std::size_t i = 0; i < boundaries.size(); ++i) {
+    ART_CHECK(!boundaries[i].empty());
+    ART_CHECK(i == 0 || boundaries[i - 1] < boundaries[i]);
+  }
+  art::ShardedArt<uint64_t> m(boundaries);
+  std::vector<std::size_t> sizes(m.nShards());
+  for (const string &key : sample)
+    ++sizes[m.shardOf(reinterpret_cast<const uint8_t *>(key.data()),
+                      key.size())];
+  for (std::size_t size : sizes)
+    ART_CHECK(size >= 90 && size <= 110);
+}
+
+/**
+ * Iterates the tree while writers modify every shard. The keys that are
+ * never modified are all visited, in ascending order.
+ */
+void testConcurrentIteration() {
+  art::ShardedArt<uint64_t> m(3);
+  std::map<string, uint64_t> stable;
+  for (int i = 0; i < 256; ++i) {
+    string key = "stable" + std::to_string(i);
+    key[0] = static_cast<char>(i);
+    stable[key] = i + 1;
+    m.set(key, i + 1);
+  }
+
+  std::atomic<int> nRunning{2};
+  std::vector<std::thread> writers;
+  for (int writer = 0; writer < 2; ++writer) {
+    writers.emplace_back([&, writer] {
+      std::mt19937_64 rng(writer);
+      for (int i = 0; i < 20000; ++i) {
+        string key = randomKey(rng) + "/w";
+        if (rng() % 2 == 0)
+          m.del(key);
+        else
+          m.set(key, randomValue<uint64_t>(rng));
+      }
+      --nRunning;
+    });
+  }
+  do {
+    auto expected = stable.begin();
+    string prev;
+    bool first = true;
+    for (auto it = m.begin(), itEnd = m.end(); it != itEnd; ++it) {
+      string key(it.key());
+      ART_CHECK(first || prev < key);
+      first = false;
+      prev = key;
+      if (expected != stable.end() && key == expected->first) {
+        ART_CHECK(*it == expected->second);
+        ++expected;
+      }
+    }
+    ART_CHECK(expected == stable.end());
+  } while (nRunning.load() > 0);
+  for (auto &writer : writers)
+    writer.join();
+}
+
+int main() {
+  testShards();
+  testSplitSample();
+  testConcurrentIteration();
+  std::cout << "ok" << std::endl;
+  return 0;
+}
@@ -0,0 +1,168 @@
+#include "../include/art.hpp"
+#include "test.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using std::string;
+
+/**
+ * Checks that the snapshot holds exactly the reference's keys.
+ */
+template <typename T>
+void checkSnapshot(const typename art::Art<T>::Snapshot &s,
+                   const std::map<string, T> &ref) {
+  auto it = s.begin();
+  for (const auto &[key, value] : ref) {
+    ART_CHECK(it != s.end());
+    ART_CHECK(it.key() == key);
+    ART_CHECK(*it == value);
+    ART_CHECK(s.get(key) == value);
+    ++it;
+  }
+  ART_CHECK(it == s.end());
+}
+
+/**
+ * Takes snapshots while setting and deleting keys, and checks every live
+ * snapshot against a copy of the reference taken along with it. Snapshots
+ * are dropped in random order, so that the nodes of some generations are
+ * reclaimed while older and newer ones are still shared.
+ */
+template <typename T> void testVersions() {
+  std::mt19937_64 rng(3);
+  art::Art<T> m;
+  std::map<string, T> ref;
+  std::vector<std::pair<typename art::Art<T>::Snapshot, std::map<string, T>>>
+      live;
+
+  for (int round = 0; round < 40; ++round) {
+    for (int i = 0; i < 500; ++i) {
+      string key = randomKey(rng);
+      if (rng() % 3 == 0) {
+        auto found = ref.find(key);
+        ART_CHECK(m.del(key) == (found != ref.end() ? found->second : T()));
+        ref.erase(key);
+      } else {
+        T value = randomValue<T>(rng);
+        m.set(key, value);
+        ref[key] = value;
+      }
+    }
+    if (rng() % 4 != 0)
+      live.emplace_back(m.snapshot(), ref);
+    if (!live.empty() && rng() % 3 == 0)
+      live.erase(live.begin() + rng() % live.size());
+    for (const auto &[snapshot, expected] : live)
+      checkSnapshot(snapshot, expected);
+  }
+
+  auto it = m.begin();
+  for (const auto &[key, value] : ref) {
+    ART_CHECK(it != m.end() && it.key() == key && *it == value);
+    ++it;
+  }
+  ART_CHECK(it == m.end());
+}
+
+/**
+ * Reads a snapshot from another thread while the tree is modified, which
+ * never writes to the nodes shared with the snapshot.
+ */
+void testConcurrentReader() {
+  std::mt19937_64 rng(4);
+  art::Art<uint64_t> m;
+  std::map<string, uint64_t> ref;
+  for (int i = 0; i < 5000; ++i) {
+    string key = randomKey(rng);
+    uint64_t value = randomValue<uint64_t>(rng);
+    m.set(key, value);
+    ref[key] = value;
+  }
+
+  auto snapshot = m.snapshot();
+  std::atomic<bool> done{false};
+  std::thread reader([&] {
+    do {
+      checkSnapshot(snapshot, ref);
+    } while (!done.load());
+  });
+  for (int i = 0; i < 20000; ++i) {
+    string key = randomKey(rng);
+    if (rng() % 2 == 0)
+      m.del(key);
+    else
+      m.set(key, randomValue<uint64_t>(rng));
+  }
+  done = true;
+  reader.join();
+  checkSnapshot(snapshot, ref);
+}
+
+/**
+ * Hands copies of fresh snapshots to reader threads, which read them and
+ * drop them while the tree keeps being modified and reclaims the versions
+ * whose last handle is gone.
+ */
+void testReleaseOnReaders() {
+  std::mt19937_64 rng(5);
+  art::Art<uint64_t> m;
+  std::mutex mutex;
+  std::deque<art::Art<uint64_t>::Snapshot> handed;
+  std::atomic<bool> done{false};
+  std::vector<std::thread> readers;
+  for (int reader = 0; reader < 3; ++reader) {
+    readers.emplace_back([&] {
+      while (true) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (handed.empty()) {
+          lock.unlock();
+          if (done.load())
+            return;
+          std::this_thread::yield();
+          continue;
+        }
+        art::Art<uint64_t>::Snapshot snapshot = handed.front();
+        handed.pop_front();
+        lock.unlock();
+        std::size_t n = 0;
+        for (auto it = snapshot.begin(); it != snapshot.end() && n < 64; ++it)
+          ++n;
+      }
+    });
+  }
+  for (int i = 0; i < 20000; ++i) {
+    string key = randomKey(rng);
+    if (rng() % 2 == 0)
+      m.del(key);
+    else
+      m.set(key, randomValue<uint64_t>(rng));
+    if (i % 16 == 0) {
+      auto snapshot = m.snapshot();
+      std::lock_guard<std::mutex> lock(mutex);
+      handed.push_back(snapshot);
+      handed.push_back(snapshot);
+    }
+  }
+  done = true;
+  for (auto &reader : readers)
+    reader.join();
+}
+
+int main() {
+  testVersions<uint64_t>();
+  testVersions<const uint64_t *>();
+  testConcurrentReader();
+  testReleaseOnReaders();
+  std::cout << "ok" << std::endl;
+  return 0;
+}
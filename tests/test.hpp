@@ -0,0 +1,96 @@
+#ifndef ART_TEST_HPP
+#define ART_TEST_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <random>
+#include <string>
+#include <unistd.h>
+
+/**
+ * Fails the test with the condition's location unless it holds. Unlike
+ * assert(), the check is kept in builds defining NDEBUG.
+ */
+#define ART_CHECK(cond)                                                      \
+  do {                                                                       \
+    if (!(cond)) {                                                           \
+      std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+                   #cond);                                                   \
+      std::abort();                                                          \
+    }                                                                        \
+  } while (false)
+
+/**
+ * Directory of its own under $TMPDIR or /tmp, removed along with the files
+ * in it when destroyed.
+ */
+class tempDir {
+public:
+  tempDir() {
+    const char *tmp = std::getenv("TMPDIR");
+    path_ = std::string(tmp != nullptr ? tmp : "/tmp") + "/art-test-XXXXXX";
+    if (::mkdtemp(&path_[0]) == nullptr) {
+      std::perror("mkdtemp");
+      std::abort();
+    }
+  }
+
+  tempDir(const tempDir &other) = delete;
+  tempDir &operator=(const tempDir &other) = delete;
+
+  ~tempDir() {
+    if (DIR *dir = ::opendir(path_.c_str())) {
+      while (dirent *entry = ::readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name != "." && name != "..")
+          ::unlink((path_ + '/' + name).c_str());
+      }
+      ::closedir(dir);
+    }
+    ::rmdir(path_.c_str());
+  }
+
+  /**
+   * Path of the file with the given name in the directory.
+   */
+  std::string file(const char *name) const { return path_ + '/' + name; }
+
+private:
+  std::string path_;
+};
+
+/**
+ * Random key of up to a few bytes over a small alphabet, including null
+ * bytes, so that keys collide, share prefixes and are prefixes of one
+ * another. One key in eight starts with a run longer than a node's inline
+ * prefix.
+ */
+template <class Rng> std::string randomKey(Rng &rng) {
+  std::string key;
+  if (rng() % 8 == 0)
+    key.assign(10 + rng() % 8, 'p');
+  for (int len = rng() % 6; len > 0; --len)
+    key.push_back(static_cast<char>(rng() % 2 ? 'a' + rng() % 4 : rng() % 256));
+  return key;
+}
+
+/* targets of the pointer values, which are embedded in child slots */
+inline uint64_t targets[256];
+
+/**
+ * Random non-default value, a pointer into targets for pointer types.
+ */
+template <class T> T randomValue(std::mt19937_64 &rng);
+
+template <> inline uint64_t randomValue<uint64_t>(std::mt19937_64 &rng) {
+  return rng() | 1;
+}
+
+template <>
+inline const uint64_t *randomValue<const uint64_t *>(std::mt19937_64 &rng) {
+  return &targets[rng() % 256];
+}
+
+#endif // !ART_TEST_HPP